@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/minigdbstub_bench_condbp.dir/bench/bench_condbp.cpp.o"
+  "CMakeFiles/minigdbstub_bench_condbp.dir/bench/bench_condbp.cpp.o.d"
+  "minigdbstub_bench_condbp"
+  "minigdbstub_bench_condbp.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/minigdbstub_bench_condbp.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/minigdbstub_bench_debugthread.dir/bench/bench_debugthread.cpp.o"
+  "CMakeFiles/minigdbstub_bench_debugthread.dir/bench/bench_debugthread.cpp.o.d"
+  "minigdbstub_bench_debugthread"
+  "minigdbstub_bench_debugthread.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/minigdbstub_bench_debugthread.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
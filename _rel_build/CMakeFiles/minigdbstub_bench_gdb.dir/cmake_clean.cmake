@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/minigdbstub_bench_gdb.dir/bench/bench_gdb.cpp.o"
+  "CMakeFiles/minigdbstub_bench_gdb.dir/bench/bench_gdb.cpp.o.d"
+  "minigdbstub_bench_gdb"
+  "minigdbstub_bench_gdb.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/minigdbstub_bench_gdb.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/minigdbstub_bench_profile.dir/bench/bench_profile.cpp.o"
+  "CMakeFiles/minigdbstub_bench_profile.dir/bench/bench_profile.cpp.o.d"
+  "minigdbstub_bench_profile"
+  "minigdbstub_bench_profile.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/minigdbstub_bench_profile.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/minigdbstub_bench_reconnect.dir/bench/bench_reconnect.cpp.o"
+  "CMakeFiles/minigdbstub_bench_reconnect.dir/bench/bench_reconnect.cpp.o.d"
+  "minigdbstub_bench_reconnect"
+  "minigdbstub_bench_reconnect.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/minigdbstub_bench_reconnect.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
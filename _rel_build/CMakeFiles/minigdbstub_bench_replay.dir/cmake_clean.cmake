@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/minigdbstub_bench_replay.dir/bench/bench_replay.cpp.o"
+  "CMakeFiles/minigdbstub_bench_replay.dir/bench/bench_replay.cpp.o.d"
+  "minigdbstub_bench_replay"
+  "minigdbstub_bench_replay.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/minigdbstub_bench_replay.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
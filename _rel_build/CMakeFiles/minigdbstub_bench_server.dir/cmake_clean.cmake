@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/minigdbstub_bench_server.dir/bench/bench_server.cpp.o"
+  "CMakeFiles/minigdbstub_bench_server.dir/bench/bench_server.cpp.o.d"
+  "minigdbstub_bench_server"
+  "minigdbstub_bench_server.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/minigdbstub_bench_server.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
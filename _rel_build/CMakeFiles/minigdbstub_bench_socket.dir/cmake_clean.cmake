@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/minigdbstub_bench_socket.dir/bench/bench_socket.cpp.o"
+  "CMakeFiles/minigdbstub_bench_socket.dir/bench/bench_socket.cpp.o.d"
+  "minigdbstub_bench_socket"
+  "minigdbstub_bench_socket.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/minigdbstub_bench_socket.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/minigdbstub_rv32i.dir/examples/rv32i/rv32i_server.cpp.o"
+  "CMakeFiles/minigdbstub_rv32i.dir/examples/rv32i/rv32i_server.cpp.o.d"
+  "minigdbstub_rv32i"
+  "minigdbstub_rv32i.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/minigdbstub_rv32i.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,37 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/tests/test_breakpoint.cpp" "CMakeFiles/minigdbstub_tests.dir/tests/test_breakpoint.cpp.o" "gcc" "CMakeFiles/minigdbstub_tests.dir/tests/test_breakpoint.cpp.o.d"
+  "/root/repo/tests/test_coredump.cpp" "CMakeFiles/minigdbstub_tests.dir/tests/test_coredump.cpp.o" "gcc" "CMakeFiles/minigdbstub_tests.dir/tests/test_coredump.cpp.o.d"
+  "/root/repo/tests/test_debugthread.cpp" "CMakeFiles/minigdbstub_tests.dir/tests/test_debugthread.cpp.o" "gcc" "CMakeFiles/minigdbstub_tests.dir/tests/test_debugthread.cpp.o.d"
+  "/root/repo/tests/test_detach.cpp" "CMakeFiles/minigdbstub_tests.dir/tests/test_detach.cpp.o" "gcc" "CMakeFiles/minigdbstub_tests.dir/tests/test_detach.cpp.o.d"
+  "/root/repo/tests/test_mem.cpp" "CMakeFiles/minigdbstub_tests.dir/tests/test_mem.cpp.o" "gcc" "CMakeFiles/minigdbstub_tests.dir/tests/test_mem.cpp.o.d"
+  "/root/repo/tests/test_memmap.cpp" "CMakeFiles/minigdbstub_tests.dir/tests/test_memmap.cpp.o" "gcc" "CMakeFiles/minigdbstub_tests.dir/tests/test_memmap.cpp.o.d"
+  "/root/repo/tests/test_nonstop.cpp" "CMakeFiles/minigdbstub_tests.dir/tests/test_nonstop.cpp.o" "gcc" "CMakeFiles/minigdbstub_tests.dir/tests/test_nonstop.cpp.o.d"
+  "/root/repo/tests/test_profile.cpp" "CMakeFiles/minigdbstub_tests.dir/tests/test_profile.cpp.o" "gcc" "CMakeFiles/minigdbstub_tests.dir/tests/test_profile.cpp.o.d"
+  "/root/repo/tests/test_recv.cpp" "CMakeFiles/minigdbstub_tests.dir/tests/test_recv.cpp.o" "gcc" "CMakeFiles/minigdbstub_tests.dir/tests/test_recv.cpp.o.d"
+  "/root/repo/tests/test_regcache.cpp" "CMakeFiles/minigdbstub_tests.dir/tests/test_regcache.cpp.o" "gcc" "CMakeFiles/minigdbstub_tests.dir/tests/test_regcache.cpp.o.d"
+  "/root/repo/tests/test_regs.cpp" "CMakeFiles/minigdbstub_tests.dir/tests/test_regs.cpp.o" "gcc" "CMakeFiles/minigdbstub_tests.dir/tests/test_regs.cpp.o.d"
+  "/root/repo/tests/test_replay.cpp" "CMakeFiles/minigdbstub_tests.dir/tests/test_replay.cpp.o" "gcc" "CMakeFiles/minigdbstub_tests.dir/tests/test_replay.cpp.o.d"
+  "/root/repo/tests/test_rv32i.cpp" "CMakeFiles/minigdbstub_tests.dir/tests/test_rv32i.cpp.o" "gcc" "CMakeFiles/minigdbstub_tests.dir/tests/test_rv32i.cpp.o.d"
+  "/root/repo/tests/test_send.cpp" "CMakeFiles/minigdbstub_tests.dir/tests/test_send.cpp.o" "gcc" "CMakeFiles/minigdbstub_tests.dir/tests/test_send.cpp.o.d"
+  "/root/repo/tests/test_snapshot.cpp" "CMakeFiles/minigdbstub_tests.dir/tests/test_snapshot.cpp.o" "gcc" "CMakeFiles/minigdbstub_tests.dir/tests/test_snapshot.cpp.o.d"
+  "/root/repo/tests/test_socket.cpp" "CMakeFiles/minigdbstub_tests.dir/tests/test_socket.cpp.o" "gcc" "CMakeFiles/minigdbstub_tests.dir/tests/test_socket.cpp.o.d"
+  "/root/repo/tests/test_stub_cpp.cpp" "CMakeFiles/minigdbstub_tests.dir/tests/test_stub_cpp.cpp.o" "gcc" "CMakeFiles/minigdbstub_tests.dir/tests/test_stub_cpp.cpp.o.d"
+  "/root/repo/tests/test_trace.cpp" "CMakeFiles/minigdbstub_tests.dir/tests/test_trace.cpp.o" "gcc" "CMakeFiles/minigdbstub_tests.dir/tests/test_trace.cpp.o.d"
+  "/root/repo/tests/test_tracepoint.cpp" "CMakeFiles/minigdbstub_tests.dir/tests/test_tracepoint.cpp.o" "gcc" "CMakeFiles/minigdbstub_tests.dir/tests/test_tracepoint.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,47 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_breakpoint.cpp.o"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_breakpoint.cpp.o.d"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_coredump.cpp.o"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_coredump.cpp.o.d"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_debugthread.cpp.o"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_debugthread.cpp.o.d"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_detach.cpp.o"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_detach.cpp.o.d"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_mem.cpp.o"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_mem.cpp.o.d"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_memmap.cpp.o"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_memmap.cpp.o.d"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_nonstop.cpp.o"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_nonstop.cpp.o.d"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_profile.cpp.o"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_profile.cpp.o.d"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_recv.cpp.o"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_recv.cpp.o.d"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_regcache.cpp.o"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_regcache.cpp.o.d"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_regs.cpp.o"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_regs.cpp.o.d"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_replay.cpp.o"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_replay.cpp.o.d"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_rv32i.cpp.o"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_rv32i.cpp.o.d"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_send.cpp.o"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_send.cpp.o.d"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_snapshot.cpp.o"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_snapshot.cpp.o.d"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_socket.cpp.o"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_socket.cpp.o.d"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_stub_cpp.cpp.o"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_stub_cpp.cpp.o.d"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_trace.cpp.o"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_trace.cpp.o.d"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_tracepoint.cpp.o"
+  "CMakeFiles/minigdbstub_tests.dir/tests/test_tracepoint.cpp.o.d"
+  "minigdbstub_tests"
+  "minigdbstub_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/minigdbstub_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,258 @@
+// Conditional breakpoint benchmark - a hot loop hits a breakpoint whose condition is only true on
+// the last iteration. Compares hits/sec when the stub evaluates the condition (agent expression
+// bytecode) against GDB-side evaluation, where every hit is a stop reply plus 'g', 'm' and 'c'
+// round trips over loopback TCP. A third run collects a trace frame (registers plus the counter)
+// on every hit through a tracepoint instead of stopping.
+//
+// Usage: minigdbstub_bench_condbp [target-side hits] [gdb-side hits]
+
+#include <signal.h>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#define MGDB_SOCK_CONN(usrData) ((mgdbSockConn *)(usrData))
+#include "minigdbstub_socket.h"
+
+#define BENCH_REG_COUNT 33
+#define BENCH_BP_ADDR 0x1000
+#define BENCH_COUNTER_ADDR 0x100
+
+enum
+{
+    BENCH_GDB_SIDE,
+    BENCH_TARGET_SIDE,
+    BENCH_TRACEPOINT
+};
+
+typedef struct
+{
+    mgdbSockConn conn;  // Must be first (MGDB_SOCK_CONN)
+    unsigned int regs[BENCH_REG_COUNT];
+    unsigned char mem[0x200];
+    int killed;
+} benchTarget;
+
+// ====================================================================================================================
+// Target hooks - transport hooks come from minigdbstub_socket.h
+// ====================================================================================================================
+static void minigdbstubUsrWriteMem(size_t addr, unsigned char data, void *usrData)
+{
+    ((benchTarget *)usrData)->mem[addr % sizeof(((benchTarget *)usrData)->mem)] = data;
+}
+
+static unsigned char minigdbstubUsrReadMem(size_t addr, void *usrData)
+{
+    return ((benchTarget *)usrData)->mem[addr % sizeof(((benchTarget *)usrData)->mem)];
+}
+
+static void minigdbstubUsrContinue(void *usrData) {}
+
+static void minigdbstubUsrStep(void *usrData) {}
+
+static void minigdbstubUsrProcessBreakpoint(int type, size_t addr, void *usrData) {}
+
+static void minigdbstubUsrKillSession(void *usrData)
+{
+    ((benchTarget *)usrData)->killed = 1;
+}
+
+// ====================================================================================================================
+// GDB side
+// ====================================================================================================================
+static std::string buildPkt(const std::string &payload)
+{
+    char checksum[8];
+    minigdbstubComputeChecksum(const_cast<char *>(payload.c_str()), payload.size(), checksum);
+    return "$" + payload + "#" + checksum[0] + checksum[1];
+}
+
+typedef struct
+{
+    int fd;
+    std::string rx;
+} benchGdb;
+
+// Wait for the next "$payload#xx" packet, skipping acks
+static std::string gdbWaitPacket(benchGdb *gdb)
+{
+    char buf[4096];
+    while (1)
+    {
+        size_t start = gdb->rx.find('$');
+        size_t hash  = gdb->rx.find('#', (start == std::string::npos) ? 0 : start);
+        if ((start != std::string::npos) && (hash != std::string::npos) &&
+            (gdb->rx.size() >= hash + 3))
+        {
+            std::string payload = gdb->rx.substr(start + 1, hash - start - 1);
+            gdb->rx.erase(0, hash + 3);
+            return payload;
+        }
+        ssize_t n = read(gdb->fd, buf, sizeof(buf));
+        if (n <= 0)
+        {
+            return "";
+        }
+        gdb->rx.append(buf, n);
+    }
+}
+
+static void gdbSend(benchGdb *gdb, const std::string &payload)
+{
+    std::string pkt = buildPkt(payload);
+    if (write(gdb->fd, pkt.c_str(), pkt.size()) != (ssize_t)pkt.size())
+    {
+        perror("write");
+    }
+}
+
+static std::string gdbRequest(benchGdb *gdb, const std::string &payload)
+{
+    gdbSend(gdb, payload);
+    return gdbWaitPacket(gdb);
+}
+
+static void gdbRun(int port, unsigned int hits, int mode)
+{
+    benchGdb gdb;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons((unsigned short)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    gdb.fd               = socket(AF_INET, SOCK_STREAM, 0);
+    int one              = 1;
+    setsockopt(gdb.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(gdb.fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        perror("connect");
+        return;
+    }
+
+    if (mode == BENCH_TARGET_SIDE)
+    {
+        // counter == hits: const16 0x100, ref32, const32 hits, equal, end
+        char cond[64];
+        snprintf(cond, sizeof(cond), "Z0,%x,4;Xb,2301001924%08x1327", BENCH_BP_ADDR, hits);
+        gdbRequest(&gdb, cond);
+        gdbSend(&gdb, "c");
+        gdbWaitPacket(&gdb);  // The one stop that matters
+    }
+    else if (mode == BENCH_TRACEPOINT)
+    {
+        char tp[64];
+        gdbRequest(&gdb, "QTinit");
+        snprintf(tp, sizeof(tp), "QTDP:1:%x:E:0:0-", BENCH_BP_ADDR);
+        gdbRequest(&gdb, tp);
+        snprintf(tp, sizeof(tp), "QTDP:-1:%x:R1-", BENCH_BP_ADDR);
+        gdbRequest(&gdb, tp);
+        snprintf(tp, sizeof(tp), "QTDP:-1:%x:M-1,%x,4", BENCH_BP_ADDR, BENCH_COUNTER_ADDR);
+        gdbRequest(&gdb, tp);
+        gdbRequest(&gdb, "QTStart");
+        gdbSend(&gdb, "c");
+        gdbWaitPacket(&gdb);  // The target stops by itself after the last hit
+        gdbRequest(&gdb, "QTStop");
+        gdbRequest(&gdb, "QTFrame:0");
+    }
+    else
+    {
+        char bp[32];
+        snprintf(bp, sizeof(bp), "Z0,%x,4", BENCH_BP_ADDR);
+        gdbRequest(&gdb, bp);
+        gdbSend(&gdb, "c");
+        while (1)
+        {
+            gdbWaitPacket(&gdb);  // Stop reply
+            gdbRequest(&gdb, "g");
+            std::string counter = gdbRequest(&gdb, "m100,4");
+            unsigned int value  = 0;
+            for (int i = 3; i >= 0; --i)
+            {
+                value = (value << 8) | (unsigned int)strtoul(counter.substr(i * 2, 2).c_str(),
+                                                              NULL, 16);
+            }
+            if (value == hits)
+            {
+                break;
+            }
+            gdbSend(&gdb, "c");
+        }
+    }
+    gdbSend(&gdb, "k");
+    close(gdb.fd);
+}
+
+// ====================================================================================================================
+// Harness
+// ====================================================================================================================
+static void runScenario(const char *name, unsigned int hits, int mode)
+{
+    mgdbSockServer server;
+    if (minigdbstubSockListenTcp(&server, "127.0.0.1", 0) != MGDB_SUCCESS)
+    {
+        fprintf(stderr, "%s: failed to listen\n", name);
+        return;
+    }
+    std::thread gdb(gdbRun, server.port, hits, mode);
+
+    static benchTarget target;
+    memset(&target, 0, sizeof(target));
+    minigdbstubSockAccept(&server, &target.conn);
+
+    mgdbBreakpoint entries[4];
+    mgdbBreakpointTable table;
+    minigdbstubBreakpointInit(&table, entries, 4);
+    static mgdbTracepoint defs[2];
+    static unsigned char frames[1 << 16];
+    mgdbTracepoints tracepoints;
+    minigdbstubTracepointInit(&tracepoints, defs, 2, frames, sizeof(frames));
+    mgdbProcObj mgdbObj = {0};
+    mgdbObj.regs        = (char *)target.regs;
+    mgdbObj.regsSize    = sizeof(target.regs);
+    mgdbObj.regsCount   = BENCH_REG_COUNT;
+    mgdbObj.usrData     = &target;
+    mgdbObj.breakpoints = &table;
+    mgdbObj.tracepoints = &tracepoints;
+    mgdbObj.signalNum   = SIGTRAP;
+
+    // Z0 (or the trace run) + 'c'
+    minigdbstubProcess(&mgdbObj);
+
+    // for (counter = 1; ; ++counter) { <breakpoint> } - the trace run ends after 'hits' iterations
+    unsigned int lastHit = (mode == BENCH_TRACEPOINT) ? hits : 0;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int counter = 1; !target.killed; ++counter)
+    {
+        memcpy(&target.mem[BENCH_COUNTER_ADDR], &counter, sizeof(counter));
+        target.regs[0]  = counter;
+        target.regs[32] = BENCH_BP_ADDR;
+        if (minigdbstubBreakpointHit(&mgdbObj, BENCH_BP_ADDR) || (counter == lastHit))
+        {
+            mgdbObj.opts.o_signalOnEntry = 1;
+            minigdbstubProcess(&mgdbObj);
+        }
+        if (target.conn.err != MGDB_SUCCESS)
+        {
+            break;
+        }
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    gdb.join();
+
+    printf("%-22s %8zu hits %8zu stops %9.4f s %12.0f hits/s\n", name, table.hits, table.stops,
+           secs, table.hits / secs);
+    minigdbstubSockClose(&server, &target.conn);
+    minigdbstubSockServerClose(&server);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int targetHits = (argc > 1) ? (unsigned int)atoi(argv[1]) : 1000000;
+    unsigned int gdbHits    = (argc > 2) ? (unsigned int)atoi(argv[2]) : 20000;
+    signal(SIGPIPE, SIG_IGN);
+
+    runScenario("target-side condition", targetHits, BENCH_TARGET_SIDE);
+    runScenario("gdb-side condition", gdbHits, BENCH_GDB_SIDE);
+    runScenario("tracepoint", targetHits, BENCH_TRACEPOINT);
+    return 0;
+}
@@ -0,0 +1,284 @@
+// Debug thread benchmark - handoff latency between the target thread and the stub's debug thread
+// (minigdbstub_debugthread.h):
+//   - handoff: step command -> stop event round trips through the SPSC queues, with the waiting
+//     side spinning first (default) or sleeping on its eventfd right away
+//   - stepi: 's' round trips from a GDB client over loopback TCP, with the stub called on the
+//     target thread (synchronous) vs. on its own debug thread
+//   - safe point: cost of a minigdbstubDebugPoll call per emulated instruction
+//
+// Usage: minigdbstub_bench_debugthread [handoffs] [steps]
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define MGDB_SOCK_CONN(usrData) ((mgdbSockConn *)(usrData))
+#include "minigdbstub_socket.h"
+
+#include "minigdbstub_debugthread.h"
+
+#define BENCH_REG_COUNT 33
+#define BENCH_INSNS 200000000UL
+
+typedef struct
+{
+    mgdbSockConn conn;    // Must be first (MGDB_SOCK_CONN)
+    mgdbDebugLink *link;  // NULL - the stub runs on the target thread
+    int killed;
+    unsigned int regs[BENCH_REG_COUNT];
+    unsigned char mem[256];
+} benchTarget;
+
+// ====================================================================================================================
+// Target hooks - transport hooks come from minigdbstub_socket.h
+// ====================================================================================================================
+static void minigdbstubUsrWriteMem(size_t addr, unsigned char data, void *usrData)
+{
+    ((benchTarget *)usrData)->mem[addr & 0xff] = data;
+}
+
+static unsigned char minigdbstubUsrReadMem(size_t addr, void *usrData)
+{
+    return ((benchTarget *)usrData)->mem[addr & 0xff];
+}
+
+static void minigdbstubUsrContinue(void *usrData)
+{
+    benchTarget *target = (benchTarget *)usrData;
+    if (target->link)
+    {
+        minigdbstubDebugCommand(target->link, MGDB_DEBUG_RESUME);
+    }
+}
+
+static void minigdbstubUsrStep(void *usrData)
+{
+    benchTarget *target = (benchTarget *)usrData;
+    if (target->link)
+    {
+        minigdbstubDebugCommand(target->link, MGDB_DEBUG_STEP);
+    }
+}
+
+static void minigdbstubUsrProcessBreakpoint(int type, size_t addr, void *usrData) {}
+
+static void minigdbstubUsrKillSession(void *usrData)
+{
+    benchTarget *target = (benchTarget *)usrData;
+    target->killed      = 1;
+    if (target->link)
+    {
+        minigdbstubDebugCommand(target->link, MGDB_DEBUG_KILL);
+    }
+}
+
+// ====================================================================================================================
+// Handoff
+// ====================================================================================================================
+static void handoffTarget(mgdbDebugLink *link)
+{
+    while (minigdbstubDebugStopped(link, SIGTRAP) != MGDB_DEBUG_KILL)
+    {
+    }
+}
+
+static void runHandoff(const char *name, size_t rounds, int spin)
+{
+    mgdbDebugLink link;
+    minigdbstubDebugLinkInit(&link, -1);
+    link.spin = spin;
+    std::thread target(handoffTarget, &link);
+
+    mgdbDebugMsg msg;
+    std::vector<double> samples(rounds);
+    minigdbstubDebugWait(&link, &link.events, link.eventFd, -1, &msg);  // Initial stop
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds; ++i)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        minigdbstubDebugCommand(&link, MGDB_DEBUG_STEP);
+        minigdbstubDebugWait(&link, &link.events, link.eventFd, -1, &msg);
+        samples[i] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0)
+                         .count();
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    minigdbstubDebugCommand(&link, MGDB_DEBUG_KILL);
+    target.join();
+    minigdbstubDebugLinkClose(&link);
+
+    std::sort(samples.begin(), samples.end());
+    printf("%-22s %8zu round trips  avg %8.3f us  p50 %8.3f us  p99 %8.3f us\n", name, rounds,
+           secs * 1e6 / rounds, samples[rounds / 2], samples[rounds * 99 / 100]);
+}
+
+// ====================================================================================================================
+// stepi over TCP
+// ====================================================================================================================
+static std::string buildPkt(const std::string &payload)
+{
+    char checksum[8];
+    minigdbstubComputeChecksum(const_cast<char *>(payload.c_str()), payload.size(), checksum);
+    return "$" + payload + "#" + checksum[0] + checksum[1];
+}
+
+// Send 's' and wait for each stop reply
+static void stepClient(int port, size_t steps)
+{
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons((unsigned short)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd               = socket(AF_INET, SOCK_STREAM, 0);
+    int one              = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        perror("connect");
+        return;
+    }
+
+    std::string step = buildPkt("s"), rx;
+    char buf[256];
+    for (size_t i = 0; i < steps; ++i)
+    {
+        if (write(fd, step.c_str(), step.size()) != (ssize_t)step.size())
+        {
+            break;
+        }
+        // Ack + "$S05#b8"
+        while (rx.find('#') == std::string::npos || rx.size() < rx.find('#') + 3)
+        {
+            ssize_t n = read(fd, buf, sizeof(buf));
+            if (n <= 0)
+            {
+                close(fd);
+                return;
+            }
+            rx.append(buf, n);
+        }
+        rx.erase(0, rx.find('#') + 3);
+        if (write(fd, "+", 1) != 1)
+        {
+            break;
+        }
+    }
+    std::string kill = buildPkt("k");
+    if (write(fd, kill.c_str(), kill.size()) != (ssize_t)kill.size())
+    {
+        perror("write");
+    }
+    close(fd);
+}
+
+static void steppingTarget(benchTarget *target)
+{
+    int cmd = minigdbstubDebugStopped(target->link, SIGTRAP);
+    while (cmd != MGDB_DEBUG_KILL)
+    {
+        ++target->regs[32];  // "Execute" one instruction
+        cmd = minigdbstubDebugStopped(target->link, SIGTRAP);
+    }
+}
+
+static void runStepping(const char *name, size_t steps, int debugThread)
+{
+    mgdbSockServer server;
+    if (minigdbstubSockListenTcp(&server, "127.0.0.1", 0) != MGDB_SUCCESS)
+    {
+        fprintf(stderr, "%s: failed to listen\n", name);
+        return;
+    }
+    std::thread gdb(stepClient, server.port, steps);
+
+    static benchTarget target;
+    memset(&target, 0, sizeof(target));
+    minigdbstubSockAccept(&server, &target.conn);
+    mgdbProcObj mgdbObj = {0};
+    mgdbObj.regs        = (char *)target.regs;
+    mgdbObj.regsSize    = sizeof(target.regs);
+    mgdbObj.regsCount   = BENCH_REG_COUNT;
+    mgdbObj.usrData     = &target;
+    mgdbObj.signalNum   = SIGTRAP;
+
+    auto start = std::chrono::steady_clock::now();
+    if (debugThread)
+    {
+        mgdbDebugLink link;
+        minigdbstubDebugLinkInit(&link, target.conn.fd);
+        link.inputPending = minigdbstubSockInputPending;
+        link.inputData    = &target.conn;
+        target.link       = &link;
+        std::thread targetThread(steppingTarget, &target);
+        minigdbstubDebugServe(&link, &mgdbObj);
+        targetThread.join();
+        minigdbstubDebugLinkClose(&link);
+    }
+    else
+    {
+        minigdbstubProcess(&mgdbObj);
+        while (!target.killed && (target.conn.err == MGDB_SUCCESS))
+        {
+            ++target.regs[32];
+            mgdbObj.opts.o_signalOnEntry = 1;
+            minigdbstubProcess(&mgdbObj);
+        }
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    gdb.join();
+
+    printf("%-22s %8zu steps        avg %8.3f us  %12.0f steps/s\n", name, steps, secs * 1e6 / steps,
+           steps / secs);
+    minigdbstubSockClose(&server, &target.conn);
+    minigdbstubSockServerClose(&server);
+}
+
+// ====================================================================================================================
+// Safe point cost
+// ====================================================================================================================
+static double runInsns(mgdbDebugLink *link)
+{
+    volatile unsigned int sink = 0;
+    unsigned int state         = 1;
+    auto start                 = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < BENCH_INSNS; ++i)
+    {
+        state = state * 1103515245u + 12345u;
+        if (link && (minigdbstubDebugPoll(link) != MGDB_DEBUG_RESUME))
+        {
+            break;
+        }
+    }
+    sink = state;
+    (void)sink;
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+               .count() /
+           BENCH_INSNS;
+}
+
+static void runSafePoint()
+{
+    mgdbDebugLink link;
+    minigdbstubDebugLinkInit(&link, -1);
+    double bare   = runInsns(NULL);
+    double polled = runInsns(&link);
+    minigdbstubDebugLinkClose(&link);
+    printf("%-22s %8.3f ns/insn bare  %8.3f ns/insn polled  +%.3f ns\n", "safe point", bare,
+           polled, polled - bare);
+}
+
+int main(int argc, char **argv)
+{
+    size_t handoffs = (argc > 1) ? (size_t)atol(argv[1]) : 200000;
+    size_t steps    = (argc > 2) ? (size_t)atol(argv[2]) : 20000;
+    signal(SIGPIPE, SIG_IGN);
+
+    runHandoff("handoff (spin)", handoffs, MGDB_DEBUG_SPIN);
+    runHandoff("handoff (sleep)", handoffs / 10, 0);
+    runStepping("stepi (target thread)", steps, 0);
+    runStepping("stepi (debug thread)", steps, 1);
+    runSafePoint();
+    return 0;
+}
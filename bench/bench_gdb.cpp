@@ -0,0 +1,353 @@
+// End-to-end GDB benchmark - drives a real gdb (gdb-multiarch or a gdb with RISC-V support) against
+// the RV32I reference target (examples/rv32i) over loopback TCP and reports wall-clock time per
+// scenario: connect, load, break + continue, 10k stepi, bt, a 64k word x/ and detach + reconnect
+// to the still running target. This is the number protocol-level changes are judged against - it
+// includes GDB's own overhead, unlike the replay benchmark.
+//
+// The demo program is written to an ELF file (with a 128 KiB .data section so 'load' moves a real
+// image), the target is started on a free port and GDB runs a batch script that timestamps every
+// scenario with 'shell date'. Exits successfully without running anything when no suitable GDB is
+// installed.
+//
+// Usage: minigdbstub_bench_gdb [rv32i server binary]
+//   Set MGDB_GDB to pick the GDB binary, otherwise gdb-multiarch then gdb are looked up in PATH.
+
+#include <elf.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "examples/rv32i/rv32i.h"
+
+#ifndef BENCH_RV32I_SERVER
+#    define BENCH_RV32I_SERVER "minigdbstub_rv32i"
+#endif
+
+#define BENCH_DATA_ADDR 0x10000
+#define BENCH_DATA_SIZE 0x20000
+#define BENCH_STEPS 10000
+#define BENCH_X_WORDS 65536
+
+// ====================================================================================================================
+// ELF image of the demo program
+// ====================================================================================================================
+static void put(std::vector<unsigned char> *out, const void *data, size_t len)
+{
+    out->insert(out->end(), (const unsigned char *)data, (const unsigned char *)data + len);
+}
+
+static Elf32_Shdr sectionHeader(Elf32_Word name, Elf32_Word type, Elf32_Word flags, Elf32_Addr addr,
+                                Elf32_Off offset, Elf32_Word size)
+{
+    Elf32_Shdr shdr;
+    memset(&shdr, 0, sizeof(shdr));
+    shdr.sh_name      = name;
+    shdr.sh_type      = type;
+    shdr.sh_flags     = flags;
+    shdr.sh_addr      = addr;
+    shdr.sh_offset    = offset;
+    shdr.sh_size      = size;
+    shdr.sh_addralign = 4;
+    return shdr;
+}
+
+static Elf32_Sym funcSymbol(Elf32_Word name, Elf32_Addr addr, Elf32_Word size)
+{
+    Elf32_Sym sym;
+    memset(&sym, 0, sizeof(sym));
+    sym.st_name  = name;
+    sym.st_value = addr;
+    sym.st_size  = size;
+    sym.st_info  = ELF32_ST_INFO(STB_GLOBAL, STT_FUNC);
+    sym.st_shndx = 1;  // .text
+    return sym;
+}
+
+// Layout: ELF header, 2 program headers, .text, .data, .symtab, .strtab, .shstrtab and the section
+// headers. Returns 0 on success
+static int writeElf(const char *path)
+{
+    uint32_t text[(RV32I_DEMO_END - RV32I_DEMO_BASE) / 4];
+    size_t textSize = rv32iDemoProgram(text) * 4;
+    std::vector<unsigned char> data(BENCH_DATA_SIZE);
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        data[i] = (unsigned char)(i * 7);
+    }
+    const char strtab[]   = "\0_start\0func";
+    const char shstrtab[] = "\0.text\0.data\0.symtab\0.strtab\0.shstrtab";
+    Elf32_Sym symbols[3];
+    memset(&symbols[0], 0, sizeof(symbols[0]));
+    symbols[1] = funcSymbol(1, RV32I_DEMO_BASE, RV32I_DEMO_FUNC - RV32I_DEMO_BASE);
+    symbols[2] = funcSymbol(8, RV32I_DEMO_FUNC, RV32I_DEMO_END - RV32I_DEMO_FUNC);
+
+    Elf32_Off textOff     = sizeof(Elf32_Ehdr) + 2 * sizeof(Elf32_Phdr);
+    Elf32_Off dataOff     = textOff + textSize;
+    Elf32_Off symtabOff   = dataOff + data.size();
+    Elf32_Off strtabOff   = symtabOff + sizeof(symbols);
+    Elf32_Off shstrtabOff = strtabOff + sizeof(strtab);
+    Elf32_Off shdrOff     = (shstrtabOff + sizeof(shstrtab) + 3) & ~3u;
+
+    Elf32_Ehdr ehdr;
+    memset(&ehdr, 0, sizeof(ehdr));
+    memcpy(ehdr.e_ident, ELFMAG, SELFMAG);
+    ehdr.e_ident[EI_CLASS]   = ELFCLASS32;
+    ehdr.e_ident[EI_DATA]    = ELFDATA2LSB;
+    ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+    ehdr.e_type              = ET_EXEC;
+    ehdr.e_machine           = EM_RISCV;
+    ehdr.e_version           = EV_CURRENT;
+    ehdr.e_entry             = RV32I_DEMO_BASE;
+    ehdr.e_phoff             = sizeof(Elf32_Ehdr);
+    ehdr.e_shoff             = shdrOff;
+    ehdr.e_ehsize            = sizeof(Elf32_Ehdr);
+    ehdr.e_phentsize         = sizeof(Elf32_Phdr);
+    ehdr.e_phnum             = 2;
+    ehdr.e_shentsize         = sizeof(Elf32_Shdr);
+    ehdr.e_shnum             = 6;
+    ehdr.e_shstrndx          = 5;
+
+    Elf32_Phdr phdrs[2];
+    memset(phdrs, 0, sizeof(phdrs));
+    phdrs[0].p_type   = PT_LOAD;
+    phdrs[0].p_offset = textOff;
+    phdrs[0].p_vaddr  = phdrs[0].p_paddr = RV32I_DEMO_BASE;
+    phdrs[0].p_filesz = phdrs[0].p_memsz = textSize;
+    phdrs[0].p_flags  = PF_R | PF_X;
+    phdrs[0].p_align  = 4;
+    phdrs[1].p_type   = PT_LOAD;
+    phdrs[1].p_offset = dataOff;
+    phdrs[1].p_vaddr  = phdrs[1].p_paddr = BENCH_DATA_ADDR;
+    phdrs[1].p_filesz = phdrs[1].p_memsz = data.size();
+    phdrs[1].p_flags  = PF_R | PF_W;
+    phdrs[1].p_align  = 4;
+
+    Elf32_Shdr shdrs[6];
+    memset(&shdrs[0], 0, sizeof(shdrs[0]));
+    shdrs[1] = sectionHeader(1, SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, RV32I_DEMO_BASE, textOff,
+                             textSize);
+    shdrs[2] = sectionHeader(7, SHT_PROGBITS, SHF_ALLOC | SHF_WRITE, BENCH_DATA_ADDR, dataOff,
+                             data.size());
+    shdrs[3] = sectionHeader(13, SHT_SYMTAB, 0, 0, symtabOff, sizeof(symbols));
+    shdrs[3].sh_link    = 4;  // .strtab
+    shdrs[3].sh_info    = 1;  // First global symbol
+    shdrs[3].sh_entsize = sizeof(Elf32_Sym);
+    shdrs[4] = sectionHeader(21, SHT_STRTAB, 0, 0, strtabOff, sizeof(strtab));
+    shdrs[5] = sectionHeader(29, SHT_STRTAB, 0, 0, shstrtabOff, sizeof(shstrtab));
+
+    std::vector<unsigned char> image;
+    put(&image, &ehdr, sizeof(ehdr));
+    put(&image, phdrs, sizeof(phdrs));
+    put(&image, text, textSize);
+    put(&image, data.data(), data.size());
+    put(&image, symbols, sizeof(symbols));
+    put(&image, strtab, sizeof(strtab));
+    put(&image, shstrtab, sizeof(shstrtab));
+    image.resize(shdrOff, 0);
+    put(&image, shdrs, sizeof(shdrs));
+
+    FILE *file = fopen(path, "wb");
+    if (!file)
+    {
+        return -1;
+    }
+    size_t written = fwrite(image.data(), 1, image.size(), file);
+    fclose(file);
+    return (written == image.size()) ? 0 : -1;
+}
+
+// ====================================================================================================================
+// Harness
+// ====================================================================================================================
+static std::string findGdb()
+{
+    const char *env = getenv("MGDB_GDB");
+    if (env && *env)
+    {
+        return env;
+    }
+    const char *path          = getenv("PATH");
+    const char *candidates[2] = {"gdb-multiarch", "gdb"};
+    for (size_t i = 0; path && (i < 2); ++i)
+    {
+        std::string dirs = path;
+        size_t start     = 0;
+        while (start <= dirs.size())
+        {
+            size_t end      = dirs.find(':', start);
+            end             = (end == std::string::npos) ? dirs.size() : end;
+            std::string exe = dirs.substr(start, end - start) + "/" + candidates[i];
+            if ((end > start) && (access(exe.c_str(), X_OK) == 0))
+            {
+                return exe;
+            }
+            start = end + 1;
+        }
+    }
+    return "";
+}
+
+// Run a shell command, returning its exit status and combined output
+static int runCommand(const std::string &cmd, std::string *output)
+{
+    FILE *pipe = popen((cmd + " 2>&1").c_str(), "r");
+    if (!pipe)
+    {
+        return -1;
+    }
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), pipe)) > 0)
+    {
+        output->append(buf, n);
+    }
+    return pclose(pipe);
+}
+
+// Start the target on a free port - returns its pid, or -1
+static pid_t startServer(const char *server, int *port)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execl(server, server, "0", (char *)NULL);
+        _exit(127);
+    }
+    close(fds[1]);
+    char line[32] = {0};
+    ssize_t n     = read(fds[0], line, sizeof(line) - 1);
+    close(fds[0]);
+    *port = (n > 0) ? atoi(line) : 0;
+    if ((pid > 0) && (*port == 0))
+    {
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+        return -1;
+    }
+    return pid;
+}
+
+int main(int argc, char **argv)
+{
+    const char *server = (argc > 1) ? argv[1] : BENCH_RV32I_SERVER;
+    std::string gdb    = findGdb();
+    if (gdb.empty())
+    {
+        printf("skipped: no gdb-multiarch or gdb in PATH (set MGDB_GDB to pick one)\n");
+        return 0;
+    }
+    std::string probe;
+    std::string probeCmd = "'" + gdb + "' -batch -nx -ex 'set architecture riscv:rv32'";
+    int probeStatus      = runCommand(probeCmd, &probe);
+    if ((probeStatus != 0) || (probe.find("riscv") == std::string::npos) ||
+        (probe.find("Undefined") != std::string::npos))
+    {
+        printf("skipped: %s has no RISC-V support\n", gdb.c_str());
+        return 0;
+    }
+
+    char dir[] = "/tmp/mgdb_bench_gdbXXXXXX";
+    if (!mkdtemp(dir))
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+    std::string elf = std::string(dir) + "/demo.elf", script = std::string(dir) + "/bench.gdb";
+    if (writeElf(elf.c_str()) != 0)
+    {
+        fprintf(stderr, "failed to write %s\n", elf.c_str());
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    int port;
+    pid_t pid = startServer(server, &port);
+    if (pid < 0)
+    {
+        fprintf(stderr, "failed to start %s\n", server);
+        return 1;
+    }
+
+    // Each scenario ends with a timestamp - the time between two timestamps is the scenario's
+    struct
+    {
+        const char *name;
+        std::string commands;
+        double units;  // For the rate column
+        const char *unit;
+    } scenarios[] = {
+        {"connect", "target remote 127.0.0.1:" + std::to_string(port), 1, "sessions"},
+        {"load", "load", (RV32I_DEMO_END - RV32I_DEMO_BASE + BENCH_DATA_SIZE) / 1024.0, "KiB"},
+        {"break", "break func\ncontinue", 1, "stops"},
+        {"stepi", "stepi " + std::to_string(BENCH_STEPS), BENCH_STEPS, "steps"},
+        {"bt", "bt", 1, "backtraces"},
+        {"x", "x/" + std::to_string(BENCH_X_WORDS) + "xw 0", BENCH_X_WORDS * 4 / 1024.0, "KiB"},
+        {"reconnect", "detach\ntarget remote 127.0.0.1:" + std::to_string(port), 1, "sessions"},
+    };
+    const size_t count = sizeof(scenarios) / sizeof(scenarios[0]);
+    FILE *file         = fopen(script.c_str(), "w");
+    if (!file)
+    {
+        perror("fopen");
+        return 1;
+    }
+    fprintf(file, "set confirm off\nset pagination off\nset height 0\nfile %s\n", elf.c_str());
+    fprintf(file, "shell date +%%s%%N\n");
+    for (size_t i = 0; i < count; ++i)
+    {
+        fprintf(file, "%s\nshell date +%%s%%N\n", scenarios[i].commands.c_str());
+    }
+    fprintf(file, "kill\n");
+    fclose(file);
+
+    std::string output;
+    int status = runCommand("'" + gdb + "' -batch -nx -x '" + script + "'", &output);
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+
+    // Timestamps are the lines that are nothing but a nanosecond count
+    std::vector<double> stamps;
+    size_t start = 0;
+    while (start < output.size())
+    {
+        size_t end       = output.find('\n', start);
+        end              = (end == std::string::npos) ? output.size() : end;
+        std::string line = output.substr(start, end - start);
+        if ((line.size() >= 18) && (line.find_first_not_of("0123456789") == std::string::npos))
+        {
+            stamps.push_back(strtod(line.c_str(), NULL) / 1e9);
+        }
+        start = end + 1;
+    }
+    if ((status != 0) || (stamps.size() != count + 1))
+    {
+        size_t tail = (output.size() > 4096) ? output.size() - 4096 : 0;
+        fprintf(stderr, "%s failed (status %d, %zu timestamps), output:\n%s\n", gdb.c_str(), status,
+                stamps.size(), output.substr(tail).c_str());
+        return 1;
+    }
+
+    printf("%s against %s\n", gdb.c_str(), server);
+    for (size_t i = 0; i < count; ++i)
+    {
+        double secs = stamps[i + 1] - stamps[i];
+        printf("%-9s %9.4f s %12.1f %s/s\n", scenarios[i].name, secs, scenarios[i].units / secs,
+               scenarios[i].unit);
+    }
+    unlink(elf.c_str());
+    unlink(script.c_str());
+    rmdir(dir);
+    return 0;
+}
@@ -0,0 +1,111 @@
+// Profiler benchmark - cost of minigdbstubProfileTick per emulated instruction, running the rv32i
+// demo program (examples/rv32i/rv32i.h):
+//   - bare: the interpreter alone
+//   - idle: a tick per instruction with profiling stopped
+//   - every N: profiling with a sample every N instructions
+// followed by the hottest addresses of the last run.
+//
+// Usage: minigdbstub_bench_profile [instructions]
+
+#include <chrono>
+#include <string>
+
+#include "minigdbstub.h"
+
+#include "examples/rv32i/rv32i.h"
+
+#define BENCH_PROFILE_ENTRIES 4096
+
+// clang-format off
+#define BENCH_X(n) MGDB_REG_DESC(rv32iRegs, x[n], "x" #n, MGDB_REG_LITTLE_ENDIAN, "int", "general")
+static const mgdbRegDesc benchRegDescs[] = {
+    BENCH_X(0),  BENCH_X(1),  BENCH_X(2),  BENCH_X(3),  BENCH_X(4),  BENCH_X(5),  BENCH_X(6),
+    BENCH_X(7),  BENCH_X(8),  BENCH_X(9),  BENCH_X(10), BENCH_X(11), BENCH_X(12), BENCH_X(13),
+    BENCH_X(14), BENCH_X(15), BENCH_X(16), BENCH_X(17), BENCH_X(18), BENCH_X(19), BENCH_X(20),
+    BENCH_X(21), BENCH_X(22), BENCH_X(23), BENCH_X(24), BENCH_X(25), BENCH_X(26), BENCH_X(27),
+    BENCH_X(28), BENCH_X(29), BENCH_X(30), BENCH_X(31),
+    MGDB_REG_DESC(rv32iRegs, pc, "pc", MGDB_REG_LITTLE_ENDIAN, "code_ptr", "general"),
+};
+// clang-format on
+static const mgdbRegLayout benchLayout = MGDB_REG_LAYOUT("riscv:rv32", "org.gnu.gdb.riscv.cpu",
+                                                         benchRegDescs);
+
+// Returns ns per instruction - tick: call minigdbstubProfileTick, interval: 0 leaves profiling off
+static double runInsns(rv32iCpu *cpu, mgdbProcObj *mgdbObj, unsigned long insns, int tick,
+                       size_t interval)
+{
+    rv32iReset(cpu);
+    if (interval)
+    {
+        minigdbstubProfileStart(mgdbObj, interval);
+    }
+    else
+    {
+        mgdbObj->profile->running = 0;
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < insns; ++i)
+    {
+        if (tick)
+        {
+            minigdbstubProfileTick(mgdbObj);
+        }
+        if (rv32iStep(cpu) != RV32I_OK)
+        {
+            fprintf(stderr, "rv32i trapped at 0x%x\n", cpu->regs.pc);
+            break;
+        }
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+               .count() /
+           insns;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long insns = (argc > 1) ? (unsigned long)atol(argv[1]) : 100000000UL;
+
+    static rv32iCpu cpu;
+    static mgdbProfileEntry entries[BENCH_PROFILE_ENTRIES];
+    mgdbProfile prof;
+    minigdbstubProfileInit(&prof, entries, BENCH_PROFILE_ENTRIES);
+    mgdbProcObj mgdbObj = {0};
+    mgdbObj.regs        = (char *)&cpu.regs;
+    mgdbObj.regsCount   = benchLayout.count;
+    mgdbObj.regLayout   = &benchLayout;
+    mgdbObj.profile     = &prof;
+
+    double bare = runInsns(&cpu, &mgdbObj, insns, 0, 0);
+    printf("%-14s %8.3f ns/insn\n", "bare", bare);
+    double idle = runInsns(&cpu, &mgdbObj, insns, 1, 0);
+    printf("%-14s %8.3f ns/insn  +%.3f ns\n", "idle", idle, idle - bare);
+    static const size_t intervals[] = {10000, 1000, 100, 1};
+    for (size_t interval : intervals)
+    {
+        double sampled   = runInsns(&cpu, &mgdbObj, insns, 1, interval);
+        std::string name = "every " + std::to_string(interval);
+        printf("%-14s %8.3f ns/insn  +%.3f ns  (%zu samples)\n", name.c_str(), sampled,
+               sampled - bare, prof.samples);
+    }
+
+    // The demo spends most of its time in func's countdown loop
+    printf("\nhottest addresses (every 1):\n");
+    for (int top = 0; top < 5; ++top)
+    {
+        mgdbProfileEntry *best = NULL;
+        for (size_t i = 0; i < BENCH_PROFILE_ENTRIES; ++i)
+        {
+            if (entries[i].pc && (!best || (entries[i].count > best->count)))
+            {
+                best = &entries[i];
+            }
+        }
+        if (!best)
+        {
+            break;
+        }
+        printf("  0x%zx %5.1f%%\n", best->pc - 1, (100.0 * best->count) / prof.samples);
+        best->pc = 0;
+    }
+    return 0;
+}
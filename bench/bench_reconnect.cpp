@@ -0,0 +1,208 @@
+// Reconnect benchmark - time from connect() until a new GDB has its first stop, against the RV32I
+// reference target (examples/rv32i) over loopback TCP. Each round connects, sends the packets GDB
+// sends when it attaches (qSupported, target description, '?', thread queries, registers) and
+// leaves again:
+//   - detach: 'D', the program runs on until the next connection halts it
+//   - hang-up: the connection just drops, which the stub treats as a detach
+//   - kill: 'k', the next connection finds a freshly loaded program - the cold path
+// The first connection (target halted at startup) is reported on its own.
+//
+// Usage: minigdbstub_bench_reconnect [rounds] [rv32i server binary]
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "minigdbstub.h"
+
+#ifndef BENCH_RV32I_SERVER
+#    define BENCH_RV32I_SERVER "minigdbstub_rv32i"
+#endif
+
+// Start the target on a free port - returns its pid, or -1
+static pid_t startServer(const char *server, int *port)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execl(server, server, "0", (char *)NULL);
+        _exit(127);
+    }
+    close(fds[1]);
+    char line[32] = {0};
+    ssize_t n     = read(fds[0], line, sizeof(line) - 1);
+    close(fds[0]);
+    *port = (n > 0) ? atoi(line) : 0;
+    if ((pid > 0) && (*port == 0))
+    {
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+        return -1;
+    }
+    return pid;
+}
+
+static int clientConnect(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons((unsigned short)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int one              = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Send a packet and return the payload of its reply ("" if the connection failed)
+static std::string clientTransact(int fd, const std::string &payload)
+{
+    char checksum[8];
+    minigdbstubComputeChecksum(const_cast<char *>(payload.c_str()), payload.size(), checksum);
+    std::string pkt = "$" + payload + "#" + checksum[0] + checksum[1];
+    if (write(fd, pkt.c_str(), pkt.size()) != (ssize_t)pkt.size())
+    {
+        return "";
+    }
+    std::string reply;
+    char buf[4096];
+    size_t start, hash;
+    while (((start = reply.find('$')) == std::string::npos) ||
+           ((hash = reply.find('#', start)) == std::string::npos) || (reply.size() < hash + 3))
+    {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0)
+        {
+            return "";
+        }
+        reply.append(buf, n);
+    }
+    return reply.substr(start + 1, hash - start - 1);
+}
+
+// GDB's attach sequence - returns 0 once it has the first stop and the registers to show it.
+// Packets the stub doesn't support get empty replies, so only the stop reply is checked
+static int clientAttach(int fd)
+{
+    static const char *const pkts[] = {
+        "qSupported:multiprocess+;swbreak+;hwbreak+;qRelocInsn+;vContSupported+;no-resumed+",
+        "vMustReplyEmpty", "Hg0", "qTStatus", "?", "qfThreadInfo", "qAttached", "Hc-1", "qC",
+        "qOffsets",
+    };
+    int stopped = 0;
+    for (const char *pkt : pkts)
+    {
+        std::string reply = clientTransact(fd, pkt);
+        stopped |= (strcmp(pkt, "?") == 0) && !reply.empty();
+    }
+    if (!stopped)
+    {
+        return -1;
+    }
+    // Target description, in as many chunks as it takes
+    for (size_t offset = 0;;)
+    {
+        std::string chunk =
+            clientTransact(fd, "qXfer:features:read:target.xml:" + std::to_string(offset) + ",ffb");
+        if (chunk.empty() || (chunk[0] != 'm'))
+        {
+            break;
+        }
+        offset += chunk.size() - 1;
+    }
+    return clientTransact(fd, "g").empty() ? -1 : 0;
+}
+
+// Connect, attach and leave - returns the microseconds from connect() to the registers, or -1
+static double clientRound(int port, const char *leave)
+{
+    auto start = std::chrono::steady_clock::now();
+    int fd     = clientConnect(port);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    int err = clientAttach(fd);
+    double us =
+        std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    if (leave)
+    {
+        clientTransact(fd, leave);
+    }
+    close(fd);
+    return (err == 0) ? us : -1;
+}
+
+int main(int argc, char **argv)
+{
+    int rounds         = (argc > 1) ? atoi(argv[1]) : 200;
+    const char *server = (argc > 2) ? argv[2] : BENCH_RV32I_SERVER;
+    signal(SIGPIPE, SIG_IGN);
+    int port;
+    pid_t pid = startServer(server, &port);
+    if (pid < 0)
+    {
+        fprintf(stderr, "failed to start %s\n", server);
+        return 1;
+    }
+
+    double first = clientRound(port, "D");
+    printf("%-10s %8.1f us\n", "first", first);
+    struct
+    {
+        const char *name;
+        const char *leave;
+    } scenarios[] = {{"detach", "D"}, {"hang-up", NULL}, {"kill", "k"}};
+    int failed = first < 0;
+    for (auto &scenario : scenarios)
+    {
+        std::vector<double> samples;
+        for (int i = 0; i < rounds; ++i)
+        {
+            usleep(2000);  // Let the target run between sessions
+            double us = clientRound(port, scenario.leave);
+            if (us < 0)
+            {
+                fprintf(stderr, "%s: round %d failed\n", scenario.name, i);
+                failed = 1;
+                break;
+            }
+            samples.push_back(us);
+        }
+        if (samples.empty())
+        {
+            continue;
+        }
+        std::sort(samples.begin(), samples.end());
+        size_t n = samples.size();
+        printf("%-10s %8zu rounds  p50 %8.1f us  p99 %8.1f us  max %8.1f us\n", scenario.name, n,
+               samples[n / 2], samples[(n * 99) / 100], samples[n - 1]);
+    }
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    return failed;
+}
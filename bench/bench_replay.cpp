@@ -0,0 +1,327 @@
+// Replay benchmark - records synthetic GDB workloads through the stub's transport tap, then replays
+// them against a mocked target as fast as possible, checking the output byte for byte.
+//
+// Usage: minigdbstub_bench_replay [recording.rec ...]
+//   With no arguments the built-in workloads are recorded to the temp dir and replayed. Stepping is
+//   replayed a second time with the registers described by a register layout ("stepping/layout"),
+//   which encodes 'g' replies register by register instead of as one flat block.
+//   Recordings given on the command line are replayed against the same mock target.
+
+#include <signal.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "minigdbstub.h"
+#include "minigdbstub_replay.h"
+
+#define BENCH_MEM_SIZE (1 << 20)
+#define BENCH_REG_COUNT 33  // x0-x31 + pc
+#define BENCH_PC_REG 32
+#define BENCH_REPEAT 5
+
+typedef struct
+{
+    std::vector<unsigned char> mem;
+    unsigned int regs[BENCH_REG_COUNT];
+    const DynCharBuffer *input;  // Recording phase input
+    size_t inPos;
+    mgdbReplay *replay;            // Replay phase
+    const mgdbRegLayout *layout;  // Registers described per register instead of as a flat block
+} benchTarget;
+
+// The same register file as a layout - host byte order, so the replies don't change
+typedef struct
+{
+    unsigned int x[BENCH_REG_COUNT];
+} benchRegFile;
+
+// clang-format off
+#define BENCH_X(n) MGDB_REG_DESC(benchRegFile, x[n], "x" #n, MGDB_REG_HOST_ORDER, "int", "general")
+static const mgdbRegDesc benchRegDescs[] = {
+    BENCH_X(0),  BENCH_X(1),  BENCH_X(2),  BENCH_X(3),  BENCH_X(4),  BENCH_X(5),  BENCH_X(6),
+    BENCH_X(7),  BENCH_X(8),  BENCH_X(9),  BENCH_X(10), BENCH_X(11), BENCH_X(12), BENCH_X(13),
+    BENCH_X(14), BENCH_X(15), BENCH_X(16), BENCH_X(17), BENCH_X(18), BENCH_X(19), BENCH_X(20),
+    BENCH_X(21), BENCH_X(22), BENCH_X(23), BENCH_X(24), BENCH_X(25), BENCH_X(26), BENCH_X(27),
+    BENCH_X(28), BENCH_X(29), BENCH_X(30), BENCH_X(31), BENCH_X(32),
+};
+// clang-format on
+static const mgdbRegLayout benchLayout = MGDB_REG_LAYOUT(NULL, "org.test.cpu", benchRegDescs);
+
+static void benchTargetReset(benchTarget *target)
+{
+    target->mem.assign(BENCH_MEM_SIZE, 0);
+    for (size_t i = 0; i < target->mem.size(); ++i)
+    {
+        target->mem[i] = (unsigned char)(i * 31);
+    }
+    for (int i = 0; i < BENCH_REG_COUNT; ++i)
+    {
+        target->regs[i] = i * 0x100;
+    }
+    target->regs[BENCH_PC_REG] = 0x1000;
+    target->inPos              = 0;
+    target->layout             = NULL;
+}
+
+// ====================================================================================================================
+// Mock target hooks
+// ====================================================================================================================
+static void minigdbstubUsrPutchar(char data, void *usrData)
+{
+    benchTarget *target = (benchTarget *)usrData;
+    if (target->replay)
+    {
+        minigdbstubReplayPutchar(target->replay, data);
+    }
+}
+
+static char minigdbstubUsrGetchar(void *usrData)
+{
+    benchTarget *target = (benchTarget *)usrData;
+    if (target->replay)
+    {
+        return minigdbstubReplayGetchar(target->replay);
+    }
+    return target->input->buffer[target->inPos++];
+}
+
+static void minigdbstubUsrWriteMem(size_t addr, unsigned char data, void *usrData)
+{
+    ((benchTarget *)usrData)->mem[addr % BENCH_MEM_SIZE] = data;
+}
+
+static unsigned char minigdbstubUsrReadMem(size_t addr, void *usrData)
+{
+    return ((benchTarget *)usrData)->mem[addr % BENCH_MEM_SIZE];
+}
+
+static void minigdbstubUsrContinue(void *usrData) {}
+
+static void minigdbstubUsrStep(void *usrData)
+{
+    ((benchTarget *)usrData)->regs[BENCH_PC_REG] += 4;
+}
+
+static void minigdbstubUsrProcessBreakpoint(int type, size_t addr, void *usrData) {}
+
+static void minigdbstubUsrKillSession(void *usrData) {}
+
+// ====================================================================================================================
+// Workloads
+// ====================================================================================================================
+static void appendPacket(DynCharBuffer *buf, const char *payload)
+{
+    minigdbstubReplayAppendPacket(buf, payload);
+    insertDynCharBuffer(buf, '+');  // GDB acks every reply
+}
+
+// 'load' of 1 MiB through 256-byte M packets
+static void buildLoad(DynCharBuffer *buf)
+{
+    std::string pkt;
+    char hdr[32];
+    for (size_t addr = 0; addr < BENCH_MEM_SIZE; addr += 256)
+    {
+        snprintf(hdr, sizeof(hdr), "M%zx,100:", addr);
+        pkt = hdr;
+        for (size_t i = 0; i < 256; ++i)
+        {
+            char hex[3];
+            snprintf(hex, sizeof(hex), "%02x", (unsigned char)((addr + i) * 7));
+            pkt += hex;
+        }
+        appendPacket(buf, pkt.c_str());
+    }
+    minigdbstubReplayAppendPacket(buf, "k");
+}
+
+// 10k 'stepi' - each stop GDB reads the register file and the instruction at pc
+static void buildStepping(DynCharBuffer *buf)
+{
+    char pkt[32];
+    size_t pc = 0x1000;
+    insertDynCharBuffer(buf, '+');  // Ack for the stop reply on entry
+    for (int i = 0; i < 10000; ++i)
+    {
+        appendPacket(buf, "g");
+        snprintf(pkt, sizeof(pkt), "m%zx,4", pc);
+        appendPacket(buf, pkt);
+        appendPacket(buf, "s");
+        insertDynCharBuffer(buf, '+');
+        pc += 4;
+    }
+    minigdbstubReplayAppendPacket(buf, "k");
+}
+
+// 'bt' storm - walk 2000 frames reading the saved fp/ra pair and pc each time
+static void buildBacktrace(DynCharBuffer *buf)
+{
+    char pkt[32];
+    for (int rep = 0; rep < 20; ++rep)
+    {
+        appendPacket(buf, "p20");
+        size_t fp = 0x80000;
+        for (int frame = 0; frame < 100; ++frame)
+        {
+            snprintf(pkt, sizeof(pkt), "m%zx,8", fp - 16);
+            appendPacket(buf, pkt);
+            snprintf(pkt, sizeof(pkt), "m%zx,4", fp - 0x400);
+            appendPacket(buf, pkt);
+            fp -= 0x40;
+        }
+    }
+    minigdbstubReplayAppendPacket(buf, "k");
+}
+
+// ====================================================================================================================
+// Harness
+// ====================================================================================================================
+static void runStub(benchTarget *target, int (*done)(benchTarget *), mgdbSessionRecorder *rec)
+{
+    mgdbProcObj mgdbObj = {0};
+    if (rec)
+    {
+        mgdbObj.ioTap     = minigdbstubRecorderTap;
+        mgdbObj.ioTapData = rec;
+    }
+    while (!done(target))
+    {
+        mgdbObj.regs                 = (char *)target->regs;
+        mgdbObj.regsSize             = sizeof(target->regs);
+        mgdbObj.regsCount            = BENCH_REG_COUNT;
+        mgdbObj.regLayout            = target->layout;
+        mgdbObj.signalNum            = SIGTRAP;
+        mgdbObj.opts.o_signalOnEntry = 1;
+        mgdbObj.opts.o_enableLogging = 0;
+        mgdbObj.usrData              = target;
+        minigdbstubProcess(&mgdbObj);
+        if (mgdbObj.err != MGDB_SUCCESS)
+        {
+            fprintf(stderr, "stub error %d\n", mgdbObj.err);
+            return;
+        }
+    }
+}
+
+static int recordDone(benchTarget *target)
+{
+    return target->inPos >= target->input->used;
+}
+
+static int replayDone(benchTarget *target)
+{
+    return minigdbstubReplayDone(target->replay);
+}
+
+static int recordWorkload(const char *path, void (*build)(DynCharBuffer *))
+{
+    DynCharBuffer input;
+    if (initDynCharBuffer(&input, 1 << 16) != MGDB_SUCCESS)
+    {
+        return MGDB_ALLOC_FAILED;
+    }
+    build(&input);
+
+    benchTarget target;
+    benchTargetReset(&target);
+    target.input  = &input;
+    target.replay = NULL;
+
+    mgdbSessionRecorder rec;
+    int err = minigdbstubRecorderOpen(&rec, path);
+    if (err == MGDB_SUCCESS)
+    {
+        runStub(&target, recordDone, &rec);
+        err = minigdbstubRecorderClose(&rec);
+    }
+    freeDynCharBuffer(&input);
+    return err;
+}
+
+static int replayRecording(const char *name, const char *path,
+                           const mgdbRegLayout *layout = NULL)
+{
+    mgdbSessionLog log;
+    int err = minigdbstubSessionLoad(&log, path);
+    if (err != MGDB_SUCCESS)
+    {
+        fprintf(stderr, "%s: failed to load '%s' (%d)\n", name, path, err);
+        return err;
+    }
+    size_t packets = 0;
+    for (size_t i = 0; i < log.input.used; ++i)
+    {
+        packets += (log.input.buffer[i] == '$');
+    }
+
+    double best = 1e30;
+    int matched = 1;
+    benchTarget target;
+    mgdbReplay replay;
+    for (int rep = 0; rep < BENCH_REPEAT; ++rep)
+    {
+        benchTargetReset(&target);
+        minigdbstubReplayInit(&replay, &log);
+        target.replay = &replay;
+        target.layout = layout;
+
+        auto start = std::chrono::steady_clock::now();
+        runStub(&target, replayDone, NULL);
+        auto end = std::chrono::steady_clock::now();
+
+        double secs = std::chrono::duration<double>(end - start).count();
+        best        = (secs < best) ? secs : best;
+        matched &= minigdbstubReplayMatched(&replay);
+    }
+
+    double mbytes = (double)(log.input.used + log.output.used) / (1024.0 * 1024.0);
+    printf("%-16s %8zu pkts %10.2f KiB %9.4f s %12.0f pkts/s %9.2f MiB/s  recorded %8.3f s  %s\n",
+           name, packets, mbytes * 1024.0, best, packets / best, mbytes / best,
+           log.durationUs / 1e6, matched ? "match" : "MISMATCH");
+    if (!matched)
+    {
+        fprintf(stderr, "%s: first mismatch at output offset %zu\n", name, replay.mismatchOffset);
+    }
+    minigdbstubSessionFree(&log);
+    return matched ? MGDB_SUCCESS : MGDB_BAD_FORMAT;
+}
+
+int main(int argc, char **argv)
+{
+    int failed = 0;
+    if (argc > 1)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            failed |= (replayRecording(argv[i], argv[i]) != MGDB_SUCCESS);
+        }
+        return failed;
+    }
+
+    struct
+    {
+        const char *name;
+        void (*build)(DynCharBuffer *);
+    } workloads[] = {{"load", buildLoad}, {"stepping", buildStepping}, {"backtrace", buildBacktrace}};
+
+    for (auto &workload : workloads)
+    {
+        std::string path = std::string("/tmp/mgdb_bench_") + workload.name + ".rec";
+        if (recordWorkload(path.c_str(), workload.build) != MGDB_SUCCESS)
+        {
+            fprintf(stderr, "%s: failed to record\n", workload.name);
+            failed = 1;
+            continue;
+        }
+        failed |= (replayRecording(workload.name, path.c_str()) != MGDB_SUCCESS);
+        if (workload.build == buildStepping)
+        {
+            // Same replies, encoded from the layout - the cost of describing each register
+            failed |= (replayRecording("stepping/layout", path.c_str(), &benchLayout) !=
+                       MGDB_SUCCESS);
+        }
+        remove(path.c_str());
+    }
+    return failed;
+}
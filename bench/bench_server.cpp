@@ -0,0 +1,271 @@
+// Multi-session server load test - hosts many independent stub sessions in one process with
+// mgdbSockMux and measures aggregate packets/sec with a mix of idle and active GDB connections.
+//
+// Usage: minigdbstub_bench_server [idle] [active] [seconds] [workers]
+//   Defaults: 1000 idle, 100 active, 3 seconds, 1 worker thread. Workers each run their own mux on
+//   the same port (SO_REUSEPORT).
+
+#include <signal.h>
+#include <sys/resource.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define MGDB_SOCK_CONN(usrData) ((mgdbSockConn *)(usrData))
+#include "minigdbstub_socket.h"
+
+#define BENCH_REG_COUNT 33
+#define BENCH_MEM_SIZE 4096
+
+typedef struct
+{
+    mgdbSockConn conn;  // Must be first (MGDB_SOCK_CONN)
+    mgdbProcObj mgdbObj;
+    unsigned int regs[BENCH_REG_COUNT];
+    unsigned char mem[BENCH_MEM_SIZE];
+} benchSession;
+
+typedef struct
+{
+    std::vector<benchSession> sessions;
+    std::vector<benchSession *> freeList;
+} benchPool;
+
+// ====================================================================================================================
+// Target hooks - transport hooks come from minigdbstub_socket.h
+// ====================================================================================================================
+static void minigdbstubUsrWriteMem(size_t addr, unsigned char data, void *usrData)
+{
+    ((benchSession *)usrData)->mem[addr % BENCH_MEM_SIZE] = data;
+}
+
+static unsigned char minigdbstubUsrReadMem(size_t addr, void *usrData)
+{
+    return ((benchSession *)usrData)->mem[addr % BENCH_MEM_SIZE];
+}
+
+static void minigdbstubUsrContinue(void *usrData) {}
+
+static void minigdbstubUsrStep(void *usrData) {}
+
+static void minigdbstubUsrProcessBreakpoint(int type, size_t addr, void *usrData) {}
+
+static void minigdbstubUsrKillSession(void *usrData) {}
+
+// ====================================================================================================================
+// Server side
+// ====================================================================================================================
+static mgdbSockConn *poolAccept(void *ctx)
+{
+    benchPool *pool = (benchPool *)ctx;
+    if (pool->freeList.empty())
+    {
+        return NULL;
+    }
+    benchSession *session = pool->freeList.back();
+    pool->freeList.pop_back();
+    memset(&session->mgdbObj, 0, sizeof(session->mgdbObj));
+    session->mgdbObj.regs      = (char *)session->regs;
+    session->mgdbObj.regsSize  = sizeof(session->regs);
+    session->mgdbObj.regsCount = BENCH_REG_COUNT;
+    session->mgdbObj.usrData   = session;
+    session->conn.mgdbObj      = &session->mgdbObj;
+    return &session->conn;
+}
+
+static void poolClose(mgdbSockConn *conn, void *ctx)
+{
+    ((benchPool *)ctx)->freeList.push_back((benchSession *)conn);
+}
+
+static void serverWorker(mgdbSockMux *mux, std::atomic<int> *stop)
+{
+    while (!stop->load())
+    {
+        minigdbstubMuxPoll(mux, 10);
+    }
+}
+
+// ====================================================================================================================
+// GDB side
+// ====================================================================================================================
+static std::string buildPkt(const std::string &payload)
+{
+    char checksum[8];
+    minigdbstubComputeChecksum(const_cast<char *>(payload.c_str()), payload.size(), checksum);
+    return "$" + payload + "#" + checksum[0] + checksum[1];
+}
+
+static int clientConnect(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons((unsigned short)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+typedef struct
+{
+    int fd;
+    std::string rx;
+} benchClient;
+
+// Drive the active connections with back-to-back requests, one outstanding per connection
+static size_t clientLoad(std::vector<benchClient> &clients, double seconds)
+{
+    const std::string requests[] = {buildPkt("g"), buildPkt("m100,40"), buildPkt("p20")};
+    int epollFd = epoll_create1(0);
+    for (size_t i = 0; i < clients.size(); ++i)
+    {
+        struct epoll_event ev;
+        ev.events   = EPOLLIN;
+        ev.data.u64 = i;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, clients[i].fd, &ev);
+        if (write(clients[i].fd, requests[0].c_str(), requests[0].size()) < 0)
+        {
+            perror("write");
+        }
+    }
+
+    size_t completed = 0;
+    char buf[4096];
+    auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+    while (std::chrono::steady_clock::now() < end)
+    {
+        struct epoll_event events[128];
+        int count = epoll_wait(epollFd, events, 128, 10);
+        for (int e = 0; e < count; ++e)
+        {
+            benchClient &client = clients[events[e].data.u64];
+            ssize_t n           = read(client.fd, buf, sizeof(buf));
+            if (n <= 0)
+            {
+                continue;
+            }
+            client.rx.append(buf, n);
+            size_t hash = client.rx.find('#');
+            if (hash != std::string::npos && client.rx.size() >= hash + 3)
+            {
+                client.rx.erase(0, hash + 3);
+                const std::string &req = requests[completed % 3];
+                ++completed;
+                if (write(client.fd, req.c_str(), req.size()) < 0)
+                {
+                    perror("write");
+                }
+            }
+        }
+    }
+    close(epollFd);
+    return completed;
+}
+
+int main(int argc, char **argv)
+{
+    int idle       = (argc > 1) ? atoi(argv[1]) : 1000;
+    int active     = (argc > 2) ? atoi(argv[2]) : 100;
+    double seconds = (argc > 3) ? atof(argv[3]) : 3.0;
+    int workers    = (argc > 4) ? atoi(argv[4]) : 1;
+    signal(SIGPIPE, SIG_IGN);
+
+    // Both ends of every connection live in this process
+    struct rlimit lim;
+    getrlimit(RLIMIT_NOFILE, &lim);
+    lim.rlim_cur = lim.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &lim);
+
+    std::vector<mgdbSockMux> muxes(workers);
+    std::vector<benchPool> pools(workers);
+    int port = 0;
+    for (int w = 0; w < workers; ++w)
+    {
+        pools[w].sessions.resize(idle + active);
+        for (auto &session : pools[w].sessions)
+        {
+            pools[w].freeList.push_back(&session);
+        }
+        memset(&muxes[w], 0, sizeof(mgdbSockMux));
+        if (minigdbstubSockListenTcp(&muxes[w].server, "127.0.0.1", port) != MGDB_SUCCESS)
+        {
+            fprintf(stderr, "failed to listen\n");
+            return 1;
+        }
+        port              = muxes[w].server.port;
+        muxes[w].onAccept = poolAccept;
+        muxes[w].onClose  = poolClose;
+        muxes[w].ctx      = &pools[w];
+    }
+
+    std::atomic<int> stop(0);
+    std::vector<std::thread> threads;
+    for (int w = 0; w < workers; ++w)
+    {
+        threads.emplace_back(serverWorker, &muxes[w], &stop);
+    }
+
+    std::vector<int> idleFds;
+    for (int i = 0; i < idle; ++i)
+    {
+        int fd = clientConnect(port);
+        if (fd >= 0)
+        {
+            idleFds.push_back(fd);
+        }
+    }
+    std::vector<benchClient> clients;
+    for (int i = 0; i < active; ++i)
+    {
+        benchClient client;
+        client.fd = clientConnect(port);
+        if (client.fd >= 0)
+        {
+            clients.push_back(client);
+        }
+    }
+
+    auto start       = std::chrono::steady_clock::now();
+    size_t completed = clientLoad(clients, seconds);
+    double elapsed   = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t sessions = 0, packets = 0;
+    for (auto &mux : muxes)
+    {
+        sessions += mux.sessions;
+    }
+    for (auto fd : idleFds)
+    {
+        close(fd);
+    }
+    for (auto &client : clients)
+    {
+        close(client.fd);
+    }
+    stop = 1;
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    for (auto &mux : muxes)
+    {
+        packets += mux.packets;
+        minigdbstubSockServerClose(&mux.server);
+    }
+
+    printf("workers %d  sessions %zu (idle %zu, active %zu)  %zu round trips in %.2f s  %.0f pkts/s\n",
+           workers, sessions, idleFds.size(), clients.size(), completed, elapsed,
+           completed / elapsed);
+    printf("server handled %zu packets total\n", packets);
+    return 0;
+}
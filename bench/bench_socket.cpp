@@ -0,0 +1,221 @@
+// Socket transport latency benchmark - measures GDB-side round-trip latency of small request/reply
+// packets over loopback TCP and Unix sockets, comparing the minigdbstub_socket.h transport against
+// a naive per-character send() transport (Nagle left on).
+//
+// Usage: minigdbstub_bench_socket [iterations]
+
+#include <signal.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "minigdbstub_socket.h"
+
+#define BENCH_REG_COUNT 33
+#define BENCH_NAIVE_ITERATIONS 50
+
+typedef struct
+{
+    mgdbSockConn conn;
+    int naive;  // Write every char with its own send()
+    unsigned int regs[BENCH_REG_COUNT];
+    unsigned char mem[256];
+} benchTarget;
+
+// ====================================================================================================================
+// Target hooks
+// ====================================================================================================================
+static void minigdbstubUsrPutchar(char data, void *usrData)
+{
+    benchTarget *target = (benchTarget *)usrData;
+    if (target->naive)
+    {
+        if (send(target->conn.fd, &data, 1, MSG_NOSIGNAL) != 1)
+        {
+            target->conn.err = MGDB_IO_FAILED;
+        }
+        ++target->conn.writes;
+        return;
+    }
+    minigdbstubSockPutchar(&target->conn, data);
+}
+
+static char minigdbstubUsrGetchar(void *usrData)
+{
+    return minigdbstubSockGetchar(&((benchTarget *)usrData)->conn);
+}
+
+static void minigdbstubUsrFlush(void *usrData)
+{
+    minigdbstubSockFlush(&((benchTarget *)usrData)->conn);
+}
+
+static void minigdbstubUsrWriteMem(size_t addr, unsigned char data, void *usrData)
+{
+    ((benchTarget *)usrData)->mem[addr & 0xff] = data;
+}
+
+static unsigned char minigdbstubUsrReadMem(size_t addr, void *usrData)
+{
+    return ((benchTarget *)usrData)->mem[addr & 0xff];
+}
+
+static void minigdbstubUsrContinue(void *usrData) {}
+
+static void minigdbstubUsrStep(void *usrData) {}
+
+static void minigdbstubUsrProcessBreakpoint(int type, size_t addr, void *usrData) {}
+
+static void minigdbstubUsrKillSession(void *usrData) {}
+
+// ====================================================================================================================
+// GDB-side client
+// ====================================================================================================================
+static std::string buildPkt(const std::string &payload)
+{
+    char checksum[8];
+    minigdbstubComputeChecksum(const_cast<char *>(payload.c_str()), payload.size(), checksum);
+    return "$" + payload + "#" + checksum[0] + checksum[1];
+}
+
+static int clientConnect(int port, const char *path)
+{
+    if (path)
+    {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, path);
+        return (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) ? fd : -1;
+    }
+    int fd  = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons((unsigned short)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) ? fd : -1;
+}
+
+// Send a request and wait for "+$...#xx"
+static void clientTransact(int fd, const std::string &pkt)
+{
+    char buf[1024];
+    size_t got = 0, hash = 0;
+    int seenHash = 0;
+    if (write(fd, pkt.c_str(), pkt.size()) != (ssize_t)pkt.size())
+    {
+        return;
+    }
+    while (!seenHash || got < hash + 3)
+    {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0)
+        {
+            return;
+        }
+        for (ssize_t i = 0; i < n && !seenHash; ++i)
+        {
+            if (buf[i] == '#')
+            {
+                seenHash = 1;
+                hash     = got + i;
+            }
+        }
+        got += (size_t)n;
+    }
+}
+
+static void clientRun(int port, const char *path, int iterations, std::vector<double> *latencies)
+{
+    int fd = clientConnect(port, path);
+    if (fd < 0)
+    {
+        return;
+    }
+    std::string pkt = buildPkt("p20");
+    for (int i = 0; i < iterations; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        clientTransact(fd, pkt);
+        auto end = std::chrono::steady_clock::now();
+        latencies->push_back(std::chrono::duration<double, std::micro>(end - start).count());
+    }
+    std::string kill = buildPkt("k");
+    if (write(fd, kill.c_str(), kill.size()) < 0)
+    {
+        perror("write");
+    }
+    close(fd);
+}
+
+static void runScenario(const char *name, const char *unixPath, int naive, int iterations)
+{
+    mgdbSockServer server;
+    int err = unixPath ? minigdbstubSockListenUnix(&server, unixPath)
+                       : minigdbstubSockListenTcp(&server, "127.0.0.1", 0);
+    if (err != MGDB_SUCCESS)
+    {
+        fprintf(stderr, "%s: failed to listen\n", name);
+        return;
+    }
+
+    std::vector<double> latencies;
+    std::thread client(clientRun, server.port, unixPath, iterations, &latencies);
+
+    static benchTarget target;
+    memset(&target, 0, sizeof(target));
+    target.naive = naive;
+    minigdbstubSockAccept(&server, &target.conn);
+    if (naive && !unixPath)
+    {
+        // Hand-written transports rarely disable Nagle
+        int zero = 0;
+        setsockopt(target.conn.fd, IPPROTO_TCP, TCP_NODELAY, &zero, sizeof(zero));
+    }
+    mgdbProcObj mgdbObj = {0};
+    mgdbObj.regs        = (char *)target.regs;
+    mgdbObj.regsSize    = sizeof(target.regs);
+    mgdbObj.regsCount   = BENCH_REG_COUNT;
+    mgdbObj.usrData     = &target;
+    minigdbstubProcess(&mgdbObj);
+    client.join();
+
+    std::sort(latencies.begin(), latencies.end());
+    double total = 0;
+    for (double l : latencies)
+    {
+        total += l;
+    }
+    size_t n = latencies.size();
+    if (n > 0)
+    {
+        printf("%-20s %7zu round trips  avg %9.2f us  p50 %9.2f us  p99 %9.2f us  writes/pkt %.2f\n",
+               name, n, total / n, latencies[n / 2], latencies[(n * 99) / 100],
+               (double)target.conn.writes / (n + 1));
+    }
+    minigdbstubSockClose(&server, &target.conn);
+    minigdbstubSockServerClose(&server);
+    if (unixPath)
+    {
+        unlink(unixPath);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int iterations       = (argc > 1) ? atoi(argv[1]) : 20000;
+    const char *unixPath = "/tmp/mgdb_bench.sock";
+    signal(SIGPIPE, SIG_IGN);
+
+    runScenario("tcp batched", NULL, 0, iterations);
+    runScenario("unix batched", unixPath, 0, iterations);
+    runScenario("tcp naive per-char", NULL, 1, BENCH_NAIVE_ITERATIONS);
+    runScenario("unix naive per-char", unixPath, 1, BENCH_NAIVE_ITERATIONS);
+    return 0;
+}
@@ -0,0 +1,341 @@
+#pragma once
+
+// Minimal RV32I interpreter - the reference target served by rv32i_server.cpp and driven by the
+// end-to-end GDB benchmark (bench/bench_gdb.cpp).
+//
+// Base integer ISA only: no M/A/C extensions, no CSRs and no privilege levels. FENCE is a no-op,
+// ECALL and EBREAK stop the hart with pc left on the instruction. Memory is a flat RAM at 0.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef RV32I_MEM_SIZE
+#    define RV32I_MEM_SIZE (1 << 20)
+#endif
+#ifndef RV32I_BEFORE_STORE
+#    define RV32I_BEFORE_STORE(cpu, addr, len)  // Called before each store, e.g. to snapshot memory
+#endif
+
+// rv32iStep results
+enum
+{
+    RV32I_OK,
+    RV32I_EBREAK,
+    RV32I_ECALL,
+    RV32I_ILLEGAL,  // Unknown or unsupported instruction
+    RV32I_FAULT     // Fetch, load or store outside of RAM
+};
+
+// Register file in GDB's riscv register order (x0-x31, pc)
+typedef struct
+{
+    uint32_t x[32];
+    uint32_t pc;
+} rv32iRegs;
+
+typedef struct
+{
+    rv32iRegs regs;
+    uint8_t mem[RV32I_MEM_SIZE];
+} rv32iCpu;
+
+// ====================================================================================================================
+// Memory
+// ====================================================================================================================
+static int rv32iInRange(uint32_t addr, uint32_t len)
+{
+    return (addr < RV32I_MEM_SIZE) && (len <= RV32I_MEM_SIZE - addr);
+}
+
+static uint32_t rv32iLoad(const rv32iCpu *cpu, uint32_t addr, uint32_t len)
+{
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < len; ++i)
+    {
+        value |= (uint32_t)cpu->mem[addr + i] << (i * 8);
+    }
+    return value;
+}
+
+static void rv32iStore(rv32iCpu *cpu, uint32_t addr, uint32_t len, uint32_t value)
+{
+    for (uint32_t i = 0; i < len; ++i)
+    {
+        cpu->mem[addr + i] = (uint8_t)(value >> (i * 8));
+    }
+}
+
+// ====================================================================================================================
+// Decode / execute
+// ====================================================================================================================
+#define RV32I_RD(insn) (((insn) >> 7) & 0x1f)
+#define RV32I_RS1(insn) (((insn) >> 15) & 0x1f)
+#define RV32I_RS2(insn) (((insn) >> 20) & 0x1f)
+#define RV32I_FUNCT3(insn) (((insn) >> 12) & 0x7)
+#define RV32I_FUNCT7(insn) ((insn) >> 25)
+
+static int32_t rv32iImmI(uint32_t insn)
+{
+    return (int32_t)insn >> 20;
+}
+
+static int32_t rv32iImmS(uint32_t insn)
+{
+    return ((int32_t)(insn & 0xfe000000) >> 20) | (int32_t)((insn >> 7) & 0x1f);
+}
+
+static int32_t rv32iImmB(uint32_t insn)
+{
+    return ((int32_t)(insn & 0x80000000) >> 19) | (int32_t)((insn & 0x80) << 4) |
+           (int32_t)((insn >> 20) & 0x7e0) | (int32_t)((insn >> 7) & 0x1e);
+}
+
+static int32_t rv32iImmJ(uint32_t insn)
+{
+    return ((int32_t)(insn & 0x80000000) >> 11) | (int32_t)(insn & 0xff000) |
+           (int32_t)((insn >> 9) & 0x800) | (int32_t)((insn >> 20) & 0x7fe);
+}
+
+// OP and OP-IMM arithmetic - 'alt' selects SUB/SRA
+static uint32_t rv32iAlu(uint32_t funct3, int alt, uint32_t a, uint32_t b)
+{
+    switch (funct3)
+    {
+        case 0:
+            return alt ? a - b : a + b;
+        case 1:
+            return a << (b & 0x1f);
+        case 2:
+            return (int32_t)a < (int32_t)b;
+        case 3:
+            return a < b;
+        case 4:
+            return a ^ b;
+        case 5:
+            return alt ? (uint32_t)((int32_t)a >> (b & 0x1f)) : a >> (b & 0x1f);
+        case 6:
+            return a | b;
+        default:
+            return a & b;
+    }
+}
+
+// Execute the instruction at pc - pc only moves on when RV32I_OK is returned
+static int rv32iStep(rv32iCpu *cpu)
+{
+    rv32iRegs *r = &cpu->regs;
+    if ((r->pc & 3) || !rv32iInRange(r->pc, 4))
+    {
+        return RV32I_FAULT;
+    }
+    uint32_t insn   = rv32iLoad(cpu, r->pc, 4);
+    uint32_t rd     = RV32I_RD(insn);
+    uint32_t a      = r->x[RV32I_RS1(insn)];
+    uint32_t b      = r->x[RV32I_RS2(insn)];
+    uint32_t funct3 = RV32I_FUNCT3(insn);
+    uint32_t nextPc = r->pc + 4;
+    uint32_t result = 0;
+    int writeRd     = 1;
+
+    switch (insn & 0x7f)
+    {
+        case 0x37:  // LUI
+            result = insn & 0xfffff000;
+            break;
+        case 0x17:  // AUIPC
+            result = r->pc + (insn & 0xfffff000);
+            break;
+        case 0x6f:  // JAL
+            result = nextPc;
+            nextPc = r->pc + rv32iImmJ(insn);
+            break;
+        case 0x67:  // JALR
+            result = nextPc;
+            nextPc = (a + rv32iImmI(insn)) & ~1u;
+            break;
+        case 0x63:  // BEQ/BNE/BLT/BGE/BLTU/BGEU
+        {
+            int taken;
+            switch (funct3)
+            {
+                case 0:
+                    taken = (a == b);
+                    break;
+                case 1:
+                    taken = (a != b);
+                    break;
+                case 4:
+                    taken = ((int32_t)a < (int32_t)b);
+                    break;
+                case 5:
+                    taken = ((int32_t)a >= (int32_t)b);
+                    break;
+                case 6:
+                    taken = (a < b);
+                    break;
+                case 7:
+                    taken = (a >= b);
+                    break;
+                default:
+                    return RV32I_ILLEGAL;
+            }
+            nextPc  = taken ? r->pc + rv32iImmB(insn) : nextPc;
+            writeRd = 0;
+            break;
+        }
+        case 0x03:  // LB/LH/LW/LBU/LHU
+        {
+            uint32_t addr = a + rv32iImmI(insn);
+            uint32_t len  = 1u << (funct3 & 3);
+            if ((funct3 == 3) || (funct3 > 5))
+            {
+                return RV32I_ILLEGAL;
+            }
+            if (!rv32iInRange(addr, len))
+            {
+                return RV32I_FAULT;
+            }
+            result = rv32iLoad(cpu, addr, len);
+            if ((funct3 == 0) || (funct3 == 1))
+            {  // Sign extend
+                uint32_t shift = 32 - (len * 8);
+                result         = (uint32_t)((int32_t)(result << shift) >> shift);
+            }
+            break;
+        }
+        case 0x23:  // SB/SH/SW
+        {
+            uint32_t addr = a + rv32iImmS(insn);
+            uint32_t len  = 1u << funct3;
+            if (funct3 > 2)
+            {
+                return RV32I_ILLEGAL;
+            }
+            if (!rv32iInRange(addr, len))
+            {
+                return RV32I_FAULT;
+            }
+            RV32I_BEFORE_STORE(cpu, addr, len);
+            rv32iStore(cpu, addr, len, b);
+            writeRd = 0;
+            break;
+        }
+        case 0x13:  // OP-IMM
+        {
+            int alt = (funct3 == 5) && (insn & 0x40000000);
+            result  = rv32iAlu(funct3, alt, a, (uint32_t)rv32iImmI(insn));
+            break;
+        }
+        case 0x33:  // OP
+            if (RV32I_FUNCT7(insn) & ~0x20u)
+            {
+                return RV32I_ILLEGAL;  // M extension
+            }
+            result = rv32iAlu(funct3, (insn & 0x40000000) != 0, a, b);
+            break;
+        case 0x0f:  // FENCE
+            writeRd = 0;
+            break;
+        case 0x73:  // ECALL/EBREAK
+            if (insn == 0x00100073)
+            {
+                return RV32I_EBREAK;
+            }
+            return (insn == 0x00000073) ? RV32I_ECALL : RV32I_ILLEGAL;
+        default:
+            return RV32I_ILLEGAL;
+    }
+
+    if (writeRd && rd)
+    {
+        r->x[rd] = result;
+    }
+    r->pc = nextPc;
+    return RV32I_OK;
+}
+
+// ====================================================================================================================
+// Demo program
+// ====================================================================================================================
+static uint32_t rv32iEncI(uint32_t op, uint32_t rd, uint32_t funct3, uint32_t rs1, int32_t imm)
+{
+    return ((uint32_t)imm << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | op;
+}
+
+static uint32_t rv32iEncS(uint32_t funct3, uint32_t rs1, uint32_t rs2, int32_t imm)
+{
+    return (((uint32_t)imm & 0xfe0) << 20) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) |
+           (((uint32_t)imm & 0x1f) << 7) | 0x23;
+}
+
+static uint32_t rv32iEncB(uint32_t funct3, uint32_t rs1, uint32_t rs2, int32_t imm)
+{
+    uint32_t u = (uint32_t)imm;
+    return ((u & 0x1000) << 19) | ((u & 0x7e0) << 20) | (rs2 << 20) | (rs1 << 15) |
+           (funct3 << 12) | ((u & 0x1e) << 7) | ((u & 0x800) >> 4) | 0x63;
+}
+
+static uint32_t rv32iEncJ(uint32_t rd, int32_t imm)
+{
+    uint32_t u = (uint32_t)imm;
+    return ((u & 0x100000) << 11) | ((u & 0x7fe) << 20) | ((u & 0x800) << 9) | (u & 0xff000) |
+           (rd << 7) | 0x6f;
+}
+
+#define RV32I_DEMO_BASE 0x1000        // _start
+#define RV32I_DEMO_FUNC 0x1014        // func
+#define RV32I_DEMO_END 0x1048         // End of the program
+#define RV32I_DEMO_DATA 0x100         // Word written by func
+#define RV32I_DEMO_STACK_TOP 0x40000  // Initial sp
+
+// _start: calls func(a0) forever with an incrementing a0. func sets up a frame, spins a small
+// countdown loop and stores a0 * 2 to RV32I_DEMO_DATA. Returns the program in words
+static size_t rv32iDemoProgram(uint32_t *words)
+{
+    enum
+    {
+        ZERO = 0,
+        RA   = 1,
+        SP   = 2,
+        T0   = 5,
+        S0   = 8,
+        A0   = 10,
+        A1   = 11
+    };
+    size_t n = 0;
+    // _start
+    words[n++] = (RV32I_DEMO_STACK_TOP & 0xfffff000) | (SP << 7) | 0x37;  // lui sp, 0x40
+    words[n++] = rv32iEncI(0x13, A0, 0, ZERO, 0);                         // li a0, 0
+    words[n++] = rv32iEncJ(RA, RV32I_DEMO_FUNC - (RV32I_DEMO_BASE + 8));  // loop: jal func
+    words[n++] = rv32iEncI(0x13, A0, 0, A0, 1);                           // addi a0, a0, 1
+    words[n++] = rv32iEncJ(ZERO, -8);                                     // j loop
+    // func
+    words[n++] = rv32iEncI(0x13, SP, 0, SP, -16);                         // addi sp, sp, -16
+    words[n++] = rv32iEncS(2, SP, RA, 12);                                // sw ra, 12(sp)
+    words[n++] = rv32iEncS(2, SP, S0, 8);                                 // sw s0, 8(sp)
+    words[n++] = rv32iEncI(0x13, S0, 0, SP, 16);                          // addi s0, sp, 16
+    words[n++] = (A0 << 20) | (A0 << 15) | (A1 << 7) | 0x33;              // add a1, a0, a0
+    words[n++] = rv32iEncI(0x13, T0, 0, ZERO, 4);                         // li t0, 4
+    words[n++] = rv32iEncI(0x13, T0, 0, T0, -1);                          // 1: addi t0, t0, -1
+    words[n++] = rv32iEncB(1, T0, ZERO, -4);                              // bnez t0, 1b
+    words[n++] = rv32iEncS(2, ZERO, A1, RV32I_DEMO_DATA);                 // sw a1, 0x100(zero)
+    words[n++] = rv32iEncI(0x03, S0, 2, SP, 8);                           // lw s0, 8(sp)
+    words[n++] = rv32iEncI(0x03, RA, 2, SP, 12);                          // lw ra, 12(sp)
+    words[n++] = rv32iEncI(0x13, SP, 0, SP, 16);                          // addi sp, sp, 16
+    words[n++] = rv32iEncI(0x67, ZERO, 0, RA, 0);                         // ret
+    return n;
+}
+
+// Clear the hart and RAM and load the demo program at RV32I_DEMO_BASE
+static void rv32iReset(rv32iCpu *cpu)
+{
+    uint32_t words[(RV32I_DEMO_END - RV32I_DEMO_BASE) / 4];
+    size_t count = rv32iDemoProgram(words);
+    memset(cpu, 0, sizeof(*cpu));
+    for (size_t i = 0; i < count; ++i)
+    {
+        rv32iStore(cpu, RV32I_DEMO_BASE + (uint32_t)(i * 4), 4, words[i]);
+    }
+    cpu->regs.pc = RV32I_DEMO_BASE;
+}
@@ -0,0 +1,275 @@
+// RV32I reference target - the interpreter in rv32i.h served to GDB over TCP with the socket
+// transport. Registers are described with a layout, so GDB picks up riscv:rv32 from the target
+// description without being told. The demo program is loaded at startup and after every 'kill', and
+// GDB's 'load' overwrites it. Sessions are served one after the other until the process is killed.
+// When GDB detaches (or its connection drops) the program runs on, and the next GDB to connect
+// finds it where it got to, with the breakpoints, recorded history and profile of the previous
+// session still in place. Execution is recorded, so reverse-step/reverse-continue work within the
+// last RV32I_SNAP_ARENA bytes of history, and 'monitor dump-core <path>' writes a core file GDB can
+// open later. 'monitor profile start', 'stop' and 'dump' sample the pc while the program runs.
+//
+// Usage: minigdbstub_rv32i [port]  (0 picks a free port - the port is printed on stdout)
+//     gdb-multiarch -ex "target remote 127.0.0.1:<port>"
+
+#include <signal.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MGDB_SOCK_CONN(usrData) ((mgdbSockConn *)(usrData))
+#include "minigdbstub_socket.h"
+
+#define RV32I_BEFORE_STORE(cpu, addr, len) rv32iBeforeStore(cpu, addr, len)
+static void rv32iBeforeStore(void *cpu, uint32_t addr, uint32_t len);
+#include "rv32i.h"
+
+#define RV32I_MAX_BREAKPOINTS 32
+#define RV32I_POLL_MASK 0xffff          // Check for a GDB interrupt every 64k instructions
+#define RV32I_DETACHED_POLL_MASK 0xfff  // ... or a GDB connecting every 4k - it waits on the halt
+#define RV32I_SNAP_ARENA (16 << 20)     // Recorded history
+#define RV32I_SNAP_INTERVAL (1 << 16)   // Instructions between checkpoints
+#define RV32I_PROFILE_ENTRIES 4096      // Distinct addresses the profiler keeps count of
+
+typedef struct
+{
+    mgdbSockConn conn;  // Must be first (MGDB_SOCK_CONN)
+    rv32iCpu cpu;
+    int step;
+    int killed;
+    int listenFd;  // Watched instead of the connection while no GDB is attached
+    mgdbProcObj mgdbObj;
+    mgdbBreakpoint breakpoints[RV32I_MAX_BREAKPOINTS];
+    mgdbBreakpointTable breakpointTable;
+    mgdbSnapshots snap;
+    unsigned char snapBits[MGDB_SNAP_BITS_SIZE(RV32I_MEM_SIZE)];
+    unsigned char snapArena[RV32I_SNAP_ARENA];
+    mgdbProfile profile;
+    mgdbProfileEntry profileEntries[RV32I_PROFILE_ENTRIES];
+} rv32iTarget;
+
+// clang-format off
+#define RV32I_X(n, name) \
+    MGDB_REG_DESC(rv32iRegs, x[n], name, MGDB_REG_LITTLE_ENDIAN, "int", "general")
+static const mgdbRegDesc rv32iRegDescs[] = {
+    RV32I_X(0, "zero"), RV32I_X(1, "ra"),   RV32I_X(2, "sp"),   RV32I_X(3, "gp"),
+    RV32I_X(4, "tp"),   RV32I_X(5, "t0"),   RV32I_X(6, "t1"),   RV32I_X(7, "t2"),
+    RV32I_X(8, "fp"),   RV32I_X(9, "s1"),   RV32I_X(10, "a0"),  RV32I_X(11, "a1"),
+    RV32I_X(12, "a2"),  RV32I_X(13, "a3"),  RV32I_X(14, "a4"),  RV32I_X(15, "a5"),
+    RV32I_X(16, "a6"),  RV32I_X(17, "a7"),  RV32I_X(18, "s2"),  RV32I_X(19, "s3"),
+    RV32I_X(20, "s4"),  RV32I_X(21, "s5"),  RV32I_X(22, "s6"),  RV32I_X(23, "s7"),
+    RV32I_X(24, "s8"),  RV32I_X(25, "s9"),  RV32I_X(26, "s10"), RV32I_X(27, "s11"),
+    RV32I_X(28, "t3"),  RV32I_X(29, "t4"),  RV32I_X(30, "t5"),  RV32I_X(31, "t6"),
+    MGDB_REG_DESC(rv32iRegs, pc, "pc", MGDB_REG_LITTLE_ENDIAN, "code_ptr", "general"),
+};
+// clang-format on
+static const mgdbRegLayout rv32iRegLayout =
+    MGDB_REG_LAYOUT("riscv:rv32", "org.gnu.gdb.riscv.cpu", rv32iRegDescs);
+
+// GDB stops backtraces and 'x' at the end of RAM instead of reading past it
+static const mgdbMemRegion rv32iMemRegions[] = {{0, RV32I_MEM_SIZE, MGDB_MEM_RAM}};
+static const mgdbMemMap rv32iMemMap          = MGDB_MEM_MAP(rv32iMemRegions);
+
+// 'monitor dump-core' - GDB's riscv Linux gregset: pc in place of x0, then x1-x31
+static const int rv32iCoreRegs[] = {32, 1,  2,  3,  4,  5,  6,  7,  8,  9,  10,
+                                    11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21,
+                                    22, 23, 24, 25, 26, 27, 28, 29, 30, 31};
+static const mgdbCoreInfo rv32iCoreInfo = {243, 0, 0, rv32iCoreRegs, 32, 4};  // EM_RISCV
+
+// ====================================================================================================================
+// Target hooks - transport hooks come from minigdbstub_socket.h
+// ====================================================================================================================
+static void minigdbstubUsrWriteMem(size_t addr, unsigned char data, void *usrData)
+{
+    rv32iCpu *cpu = &((rv32iTarget *)usrData)->cpu;
+    if (addr < RV32I_MEM_SIZE)
+    {
+        cpu->mem[addr] = data;
+    }
+}
+
+static unsigned char minigdbstubUsrReadMem(size_t addr, void *usrData)
+{
+    rv32iCpu *cpu = &((rv32iTarget *)usrData)->cpu;
+    return (addr < RV32I_MEM_SIZE) ? cpu->mem[addr] : 0;
+}
+
+static void minigdbstubUsrContinue(void *usrData)
+{
+    ((rv32iTarget *)usrData)->step = 0;
+}
+
+static void minigdbstubUsrStep(void *usrData)
+{
+    ((rv32iTarget *)usrData)->step = 1;
+}
+
+// Breakpoints live in the stub's table (mgdbProcObj.breakpoints) - nothing is patched into memory
+static void minigdbstubUsrProcessBreakpoint(int type, size_t addr, void *usrData) {}
+
+static void minigdbstubUsrKillSession(void *usrData)
+{
+    ((rv32iTarget *)usrData)->killed = 1;
+}
+
+// ====================================================================================================================
+// Execution
+// ====================================================================================================================
+static int rv32iSignal(int status)
+{
+    switch (status)
+    {
+        case RV32I_ILLEGAL:
+            return SIGILL;
+        case RV32I_FAULT:
+            return SIGSEGV;
+        default:
+            return SIGTRAP;
+    }
+}
+
+// Save the page(s) a store is about to change - the interpreter only ever sees its own cpu
+static void rv32iBeforeStore(void *cpu, uint32_t addr, uint32_t len)
+{
+    rv32iTarget *target = (rv32iTarget *)((char *)cpu - offsetof(rv32iTarget, cpu));
+    minigdbstubSnapshotWrite(&target->mgdbObj, addr, len);
+}
+
+// GDB sends ^C (or anything else) while the target runs - the stub skips the interrupt byte when it
+// looks for the next packet. While detached, a GDB connecting is the interrupt
+static int rv32iInterruptPending(rv32iTarget *target)
+{
+    struct pollfd pfd;
+    pfd.fd     = target->mgdbObj.detached ? target->listenFd : target->conn.fd;
+    pfd.events = POLLIN;
+    return (!target->mgdbObj.detached && (target->conn.rxHead != target->conn.rxTail)) ||
+           (poll(&pfd, 1, 0) > 0);
+}
+
+// Run until a breakpoint, a trap or an interrupt from GDB - returns the signal to report. The
+// instruction at the resume pc always executes, so continuing from a breakpoint moves past it
+static int rv32iRun(rv32iTarget *target, mgdbProcObj *mgdbObj)
+{
+    rv32iCpu *cpu          = &target->cpu;
+    unsigned long pollMask = mgdbObj->detached ? RV32I_DETACHED_POLL_MASK : RV32I_POLL_MASK;
+    for (unsigned long n = 0;; ++n)
+    {
+        uint32_t pc = cpu->regs.pc;
+        if ((n > 0) && minigdbstubBreakpointFind(mgdbObj->breakpoints, pc) &&
+            minigdbstubBreakpointHit(mgdbObj, pc))
+        {
+            return SIGTRAP;
+        }
+        if (((n & pollMask) == pollMask) && rv32iInterruptPending(target))
+        {
+            return SIGINT;
+        }
+        int snap = minigdbstubSnapshotStep(mgdbObj, pc);
+        if (snap != MGDB_SNAP_RUN)
+        {
+            if (snap == MGDB_SNAP_STOP)
+            {
+                return SIGTRAP;  // Reverse step/continue done
+            }
+            continue;  // Rewound - pc changed
+        }
+        minigdbstubProfileTick(mgdbObj);
+        int status = rv32iStep(cpu);
+        if (status != RV32I_OK)
+        {
+            return rv32iSignal(status);
+        }
+    }
+}
+
+// Load the demo program and start over with empty breakpoint, history and profile tables - at
+// startup and after GDB kills the program
+static void rv32iInit(rv32iTarget *target)
+{
+    mgdbProcObj *mgdbObj = &target->mgdbObj;
+    memset(mgdbObj, 0, sizeof(*mgdbObj));
+    rv32iReset(&target->cpu);
+    target->step   = 0;
+    target->killed = 0;
+
+    minigdbstubBreakpointInit(&target->breakpointTable, target->breakpoints,
+                              RV32I_MAX_BREAKPOINTS);
+    mgdbObj->regs        = (char *)&target->cpu.regs;
+    mgdbObj->regsCount   = rv32iRegLayout.count;
+    mgdbObj->regLayout   = &rv32iRegLayout;
+    mgdbObj->usrData     = target;
+    mgdbObj->breakpoints = &target->breakpointTable;
+    mgdbObj->memMap      = &rv32iMemMap;
+    mgdbObj->snapshots   = &target->snap;
+    mgdbObj->coreInfo    = &rv32iCoreInfo;
+    mgdbObj->profile     = &target->profile;
+    mgdbObj->signalNum   = SIGTRAP;
+    minigdbstubSnapshotInit(&target->snap, target->snapArena, RV32I_SNAP_ARENA, target->snapBits,
+                            RV32I_MEM_SIZE, RV32I_SNAP_INTERVAL);
+    target->snap.mem = target->cpu.mem;
+    minigdbstubProfileInit(&target->profile, target->profileEntries, RV32I_PROFILE_ENTRIES);
+}
+
+// Serve one GDB connection - returns once GDB kills the program, detaches or hangs up
+static void rv32iServe(rv32iTarget *target)
+{
+    mgdbProcObj *mgdbObj = &target->mgdbObj;
+    target->step         = 0;
+
+    // Halted until GDB resumes us - GDB asks why with '?' when it connects
+    mgdbObj->opts.o_signalOnEntry = 0;
+    minigdbstubProcess(mgdbObj);
+    while (!target->killed && !mgdbObj->detached && (target->conn.err == MGDB_SUCCESS))
+    {
+        if (target->step)
+        {
+            minigdbstubSnapshotStep(mgdbObj, target->cpu.regs.pc);  // Always RUN going forward
+            int status         = rv32iStep(&target->cpu);
+            mgdbObj->signalNum = (status == RV32I_OK) ? SIGTRAP : rv32iSignal(status);
+        }
+        else
+        {
+            mgdbObj->signalNum = rv32iRun(target, mgdbObj);
+        }
+        mgdbObj->opts.o_signalOnEntry = 1;
+        minigdbstubProcess(mgdbObj);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int port = (argc > 1) ? atoi(argv[1]) : 1234;
+    signal(SIGPIPE, SIG_IGN);
+
+    mgdbSockServer server;
+    if (minigdbstubSockListenTcp(&server, "127.0.0.1", port) != MGDB_SUCCESS)
+    {
+        fprintf(stderr, "failed to listen on port %d\n", port);
+        return 1;
+    }
+    printf("%d\n", server.port);
+    fflush(stdout);
+
+    static rv32iTarget target;
+    target.listenFd = server.listenFd;
+    rv32iInit(&target);
+    while (1)
+    {
+        if (target.mgdbObj.detached)
+        {
+            // No GDB - run until the next one connects (or the program stops by itself)
+            target.mgdbObj.signalNum = rv32iRun(&target, &target.mgdbObj);
+        }
+        if (minigdbstubSockAccept(&server, &target.conn) != MGDB_SUCCESS)
+        {
+            break;
+        }
+        rv32iServe(&target);
+        minigdbstubSockClose(&server, &target.conn);
+        if (target.killed)
+        {
+            rv32iInit(&target);
+        }
+    }
+    minigdbstubSockServerClose(&server);
+    return 0;
+}
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 // Basic packets
 #define MGDB_ACK_PACKET "+"
@@ -15,18 +17,55 @@
 #    define MGDB_PKT_SIZE 256
 #endif
 
+// Log levels - logs above MGDB_LOG_LEVEL are compiled out entirely
+#define MGDB_LOG_LEVEL_NONE 0
+#define MGDB_LOG_LEVEL_ERROR 1
+#define MGDB_LOG_LEVEL_WARN 2
+#define MGDB_LOG_LEVEL_INFO 3
+#define MGDB_LOG_LEVEL_TRACE 4
+
+#ifndef MGDB_LOG_LEVEL
+#    define MGDB_LOG_LEVEL MGDB_LOG_LEVEL_TRACE
+#endif
+
+// Log sink - define before including this header to redirect logs (default is stdout)
+#ifndef MGDB_LOG_SINK
+#    define MGDB_LOG_SINK(level, ...) printf(__VA_ARGS__)
+#endif
+
 // Log/trace/debug macros
 #define MGDB_FILENAME (strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__)
-#define MGDB_LOG_I(msg, ...)                                                                  \
-    printf("[minigdbstub] INFO  [ %12s:%-6d ]%20s : " msg, MGDB_FILENAME, __LINE__, __func__, \
-           ##__VA_ARGS__)
-#define MGDB_LOG_W(msg, ...)                                                                  \
-    printf("[minigdbstub] WARN  [ %12s:%-6d ]%20s : " msg, MGDB_FILENAME, __LINE__, __func__, \
-           ##__VA_ARGS__)
-#define MGDB_LOG_E(msg, ...)                                                                  \
-    printf("[minigdbstub] ERROR [ %12s:%-6d ]%20s : " msg, MGDB_FILENAME, __LINE__, __func__, \
-           ##__VA_ARGS__)
-#define MGDB_LOG_TRACE(msg, ...) printf("[minigdbstub] : " msg, ##__VA_ARGS__)
+#define MGDB_LOG_NOOP() \
+    do                  \
+    {                   \
+    } while (0)
+#if MGDB_LOG_LEVEL >= MGDB_LOG_LEVEL_INFO
+#    define MGDB_LOG_I(msg, ...)                                                            \
+        MGDB_LOG_SINK(MGDB_LOG_LEVEL_INFO, "[minigdbstub] INFO  [ %12s:%-6d ]%20s : " msg, \
+                      MGDB_FILENAME, __LINE__, __func__, ##__VA_ARGS__)
+#else
+#    define MGDB_LOG_I(msg, ...) MGDB_LOG_NOOP()
+#endif
+#if MGDB_LOG_LEVEL >= MGDB_LOG_LEVEL_WARN
+#    define MGDB_LOG_W(msg, ...)                                                            \
+        MGDB_LOG_SINK(MGDB_LOG_LEVEL_WARN, "[minigdbstub] WARN  [ %12s:%-6d ]%20s : " msg, \
+                      MGDB_FILENAME, __LINE__, __func__, ##__VA_ARGS__)
+#else
+#    define MGDB_LOG_W(msg, ...) MGDB_LOG_NOOP()
+#endif
+#if MGDB_LOG_LEVEL >= MGDB_LOG_LEVEL_ERROR
+#    define MGDB_LOG_E(msg, ...)                                                             \
+        MGDB_LOG_SINK(MGDB_LOG_LEVEL_ERROR, "[minigdbstub] ERROR [ %12s:%-6d ]%20s : " msg, \
+                      MGDB_FILENAME, __LINE__, __func__, ##__VA_ARGS__)
+#else
+#    define MGDB_LOG_E(msg, ...) MGDB_LOG_NOOP()
+#endif
+#if MGDB_LOG_LEVEL >= MGDB_LOG_LEVEL_TRACE
+#    define MGDB_LOG_TRACE(msg, ...) \
+        MGDB_LOG_SINK(MGDB_LOG_LEVEL_TRACE, "[minigdbstub] : " msg, ##__VA_ARGS__)
+#else
+#    define MGDB_LOG_TRACE(msg, ...) MGDB_LOG_NOOP()
+#endif
 #define MGDB_SEND "GDB <--- MGDB_STUB"
 #define MGDB_RECV "GDB ---> MGDB_STUB"
 
@@ -45,10 +84,57 @@
         }                                 \
     } while (0)
 
+// Minimal size_t atomics (used by the lock-free structures below)
+#if defined(_MSC_VER) && !defined(__clang__)
+#    include <intrin.h>
+#    define MGDB_ATOMIC_LOAD(ptr) (*(volatile size_t *)(ptr))
+#    define MGDB_ATOMIC_STORE(ptr, val) (*(volatile size_t *)(ptr) = (val))
+#    if defined(_WIN64)
+#        define MGDB_ATOMIC_FETCH_ADD(ptr, val) \
+            ((size_t)_InterlockedExchangeAdd64((volatile __int64 *)(ptr), (__int64)(val)))
+#        define MGDB_ATOMIC_CAS(ptr, expected, desired)                                   \
+            (_InterlockedCompareExchange64((volatile __int64 *)(ptr), (__int64)(desired), \
+                                           (__int64)(expected)) == (__int64)(expected))
+#        define MGDB_ATOMIC_FENCE() __faststorefence()
+#    else
+#        define MGDB_ATOMIC_FETCH_ADD(ptr, val) \
+            ((size_t)_InterlockedExchangeAdd((volatile long *)(ptr), (long)(val)))
+#        define MGDB_ATOMIC_CAS(ptr, expected, desired)                           \
+            (_InterlockedCompareExchange((volatile long *)(ptr), (long)(desired), \
+                                         (long)(expected)) == (long)(expected))
+#        define MGDB_ATOMIC_FENCE() _mm_mfence()
+#    endif
+#else
+#    define MGDB_ATOMIC_LOAD(ptr) __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#    define MGDB_ATOMIC_STORE(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
+#    define MGDB_ATOMIC_FETCH_ADD(ptr, val) __atomic_fetch_add(ptr, val, __ATOMIC_ACQ_REL)
+#    define MGDB_ATOMIC_CAS(ptr, expected, desired) \
+        __sync_bool_compare_and_swap(ptr, expected, desired)
+#    define MGDB_ATOMIC_FENCE() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
+// Monotonic timestamp in nanoseconds - define before including this header to use another clock
+#ifndef MGDB_TIMESTAMP
+#    define MGDB_TIMESTAMP() minigdbstubTimestampNs()
+#endif
+
+static unsigned long long minigdbstubTimestampNs(void)
+{
+    struct timespec ts;
+#if defined(_WIN32)
+    timespec_get(&ts, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return ((unsigned long long)ts.tv_sec * 1000000000ULL) + (unsigned long long)ts.tv_nsec;
+}
+
 enum
 {
     MGDB_SUCCESS,
-    MGDB_ALLOC_FAILED
+    MGDB_ALLOC_FAILED,
+    MGDB_IO_FAILED,
+    MGDB_BAD_FORMAT
 };
 
 // Basic dynamic char array utility for reading GDB packets
@@ -61,32 +147,61 @@ typedef struct
 
 static int initDynCharBuffer(DynCharBuffer *buf, size_t startSize)
 {
-    buf->buffer = (char *)malloc(startSize * sizeof(char));
+    // Never start empty - doubling a zero sized buffer would never make room
+    buf->used   = 0;
+    buf->size   = startSize ? startSize : 1;
+    buf->buffer = (char *)malloc(buf->size * sizeof(char));
     if (buf->buffer == NULL)
     {
+        buf->size = 0;
         MGDB_LOG_E("Failed to alloc memory!\n");
         return MGDB_ALLOC_FAILED;
     }
-    buf->used = 0;
-    buf->size = startSize;
     return MGDB_SUCCESS;
 }
-static int insertDynCharBuffer(DynCharBuffer *buf, char item)
+// Make room for count more items - for writing directly at &buf->buffer[buf->used]
+static int reserveDynCharBuffer(DynCharBuffer *buf, size_t count)
 {
-    // Realloc if buffer is full - double the array size
-    if (buf->used == buf->size)
+    size_t size = buf->size ? buf->size : 1;
+    char *buffer;
+    while (buf->used + count > size)
+    {
+        size *= 2;
+    }
+    if (size != buf->size)
     {
-        buf->size *= 2;
-        buf->buffer = (char *)realloc(buf->buffer, buf->size);
-        if (buf->buffer == NULL)
+        // Keep the old block on failure - it is still owned by buf and released on free
+        buffer = (char *)realloc(buf->buffer, size);
+        if (buffer == NULL)
         {
             MGDB_LOG_E("Failed to realloc memory!\n");
             return MGDB_ALLOC_FAILED;
         }
+        buf->buffer = buffer;
+        buf->size   = size;
     }
-    buf->buffer[buf->used++] = item;
     return MGDB_SUCCESS;
 }
+static int insertDynCharBuffer(DynCharBuffer *buf, char item)
+{
+    // Realloc if buffer is full - double the array size
+    int err = reserveDynCharBuffer(buf, 1);
+    if (err == MGDB_SUCCESS)
+    {
+        buf->buffer[buf->used++] = item;
+    }
+    return err;
+}
+static int appendDynCharBuffer(DynCharBuffer *buf, const char *data, size_t len)
+{
+    int err = reserveDynCharBuffer(buf, len);
+    if (err == MGDB_SUCCESS)
+    {
+        memcpy(&buf->buffer[buf->used], data, len);
+        buf->used += len;
+    }
+    return err;
+}
 static void freeDynCharBuffer(DynCharBuffer *buf)
 {
     free(buf->buffer);
@@ -109,484 +224,3928 @@ typedef struct
     unsigned int o_enableLogging : 1;
 } mgdbOpts;
 
+// Packet trace ring buffer - fixed-size records, oldest entries are overwritten
+#ifndef MGDB_TRACE_RECORD_SIZE
+#    define MGDB_TRACE_RECORD_SIZE 64
+#endif
+
 enum
 {
-    MGDB_SOFT_BREAKPOINT = (1 << 0),
-    MGDB_HARD_BREAKPOINT = (1 << 1),
-
-    MGDB_SET_BREAKPOINT   = (1 << 2),
-    MGDB_CLEAR_BREAKPOINT = (1 << 3)
+    MGDB_TRACE_RECV,
+    MGDB_TRACE_SEND
 };
 
-// minigdbstub process call object
 typedef struct
 {
-    char *regs;        // Pointer to register array
-    size_t regsSize;   // Size of register array in bytes
-    size_t regsCount;  // Total number of registers
-    int signalNum;     // Signal that can be sent to GDB on certain operations
-    mgdbOpts opts;     // Options bitfield
-    int err;           // Return-error code
-    void *usrData;     // Optional handle to opaque user data
-} mgdbProcObj;
-
-// ====================================================================================================================
-// User stubs
-// ====================================================================================================================
-static void minigdbstubUsrPutchar(char data, void *usrData);
-static char minigdbstubUsrGetchar(void *usrData);
-static void minigdbstubUsrWriteMem(size_t addr, unsigned char data, void *usrData);
-static unsigned char minigdbstubUsrReadMem(size_t addr, void *usrData);
-static void minigdbstubUsrContinue(void *usrData);
-static void minigdbstubUsrStep(void *usrData);
-static void minigdbstubUsrProcessBreakpoint(int type, size_t addr, void *usrData);
-static void minigdbstubUsrKillSession(void *usrData);
-// ====================================================================================================================
+    size_t seq;                         // (Record index + 1) * 2 once written, odd while writing
+    unsigned long long timestamp;       // MGDB_TIMESTAMP() at the time of the record
+    size_t length;                      // Full packet length (data may be truncated)
+    int dir;                            // MGDB_TRACE_RECV or MGDB_TRACE_SEND
+    char data[MGDB_TRACE_RECORD_SIZE];  // Raw packet bytes (not NUL-terminated)
+} mgdbTraceRecord;
 
-static void minigdbstubComputeChecksum(char *buffer, size_t len, char *outBuf)
+typedef struct
 {
-    unsigned int checksum = 0;
-    for (size_t i = 0; i < len; ++i)
-    {
-        checksum = (checksum + buffer[i]) % 256;
-    }
-    MGDB_HEX_ENCODE_ASCII(checksum, 3, outBuf);
+    mgdbTraceRecord *records;  // Caller-owned record storage
+    size_t capacity;           // Number of records (must be a power of 2)
+    size_t head;               // Total number of records ever written
+} mgdbTraceRing;
 
-    // If the value is single digit
-    if (outBuf[1] == 0)
-    {
-        outBuf[1] = outBuf[0];
-        outBuf[0] = '0';
-    }
-}
+typedef void (*mgdbTraceDumpFn)(const mgdbTraceRecord *record, void *ctx);
+
+// Per-byte transport tap - dir is MGDB_TRACE_RECV or MGDB_TRACE_SEND
+typedef void (*mgdbIoTapFn)(int dir, char data, void *tapData);
 
-static void minigdbstubSend(const char *data, mgdbProcObj *mgdbObj)
+static void minigdbstubTraceInit(mgdbTraceRing *ring, mgdbTraceRecord *records, size_t capacity)
 {
-    size_t len = strlen(data);
-    if (mgdbObj->opts.o_enableLogging)
-    {
-        MGDB_LOG_TRACE(MGDB_SEND " : packet = %s\n", data);
-    }
-    for (size_t i = 0; i < len; ++i)
-    {
-        minigdbstubUsrPutchar(data[i], mgdbObj->usrData);
-    }
+    memset(records, 0, capacity * sizeof(mgdbTraceRecord));
+    ring->records  = records;
+    ring->capacity = capacity;
+    ring->head     = 0;
 }
 
-static void minigdbstubRecv(mgdbProcObj *mgdbObj, gdbPacket *gdbPkt)
+static void minigdbstubTraceRecord(mgdbTraceRing *ring, int dir, const char *data, size_t len)
 {
-    int currentOffset = 0;
-    char c;
-    while (1)
+    // Claim a slot - writers never wait on readers, and on each other only when lapped mid-write
+    size_t index         = MGDB_ATOMIC_FETCH_ADD(&ring->head, 1);
+    mgdbTraceRecord *rec = &ring->records[index & (ring->capacity - 1)];
+    size_t claim         = ((index + 1) * 2) - 1;  // Odd while writing, +1 once written
+    size_t seq;
+    do
     {
-        // Get the beginning of the packet data '$'
-        while (1)
-        {
-            c = minigdbstubUsrGetchar(mgdbObj->usrData);
-            if (c == '$')
-            {
-                break;
-            }
-        }
-
-        // Read packet data until the end '#' - then read the remaining 2 checksum digits
-        while (1)
-        {
-            c = minigdbstubUsrGetchar(mgdbObj->usrData);
-            if (c == '#')
-            {
-                gdbPkt->checksum[0] = minigdbstubUsrGetchar(mgdbObj->usrData);
-                gdbPkt->checksum[1] = minigdbstubUsrGetchar(mgdbObj->usrData);
-                gdbPkt->checksum[2] = 0;
-                MGDB_CHECK_RET(insertDynCharBuffer(&gdbPkt->pktData, 0), mgdbObj);
-                break;
-            }
-            MGDB_CHECK_RET(insertDynCharBuffer(&gdbPkt->pktData, c), mgdbObj);
-            ++currentOffset;
-        }
-
-        // Compute checksum and compare with expected checksum
-        // Request retransmission if checksum verification fails
-        char actualChecksum[8] = {0, 0, 0, 0, 0, 0, 0, 0};
-        minigdbstubComputeChecksum(gdbPkt->pktData.buffer, currentOffset, actualChecksum);
-        if (strcmp(gdbPkt->checksum, actualChecksum) != 0)
+        seq = MGDB_ATOMIC_LOAD(&rec->seq);
+        if (seq > claim)
         {
-            gdbPkt->pktData.used = 0;
-            minigdbstubSend(MGDB_RESEND_PACKET, mgdbObj);
-            continue;
+            return;  // A later lap already owns the slot - this record is overwritten anyway
         }
+    } while ((seq & 1) || !MGDB_ATOMIC_CAS(&rec->seq, seq, claim));
 
-        gdbPkt->commandType = gdbPkt->pktData.buffer[0];
-        if (mgdbObj->opts.o_enableLogging)
-        {
-            MGDB_LOG_TRACE(MGDB_RECV " : packet = $%s#%s\n", gdbPkt->pktData.buffer,
-                           gdbPkt->checksum);
-        }
-        minigdbstubSend(MGDB_ACK_PACKET, mgdbObj);
-        return;
-    }
+    size_t copyLen = (len < MGDB_TRACE_RECORD_SIZE) ? len : MGDB_TRACE_RECORD_SIZE;
+    memcpy(rec->data, data, copyLen);
+    rec->timestamp = MGDB_TIMESTAMP();
+    rec->length    = len;
+    rec->dir       = dir;
+    MGDB_ATOMIC_STORE(&rec->seq, claim + 1);
 }
 
-static void minigdbstubWriteRegs(mgdbProcObj *mgdbObj, gdbPacket *recvPkt)
+// Walk the ring oldest to newest - records being overwritten concurrently are skipped
+static void minigdbstubTraceDump(mgdbTraceRing *ring, mgdbTraceDumpFn dumpFn, void *ctx)
 {
-    char tmpBuf[8];
-    int decodedHex;
-    for (size_t i = 0; i < recvPkt->pktData.size - 1; ++i)
+    size_t head  = MGDB_ATOMIC_LOAD(&ring->head);
+    size_t start = (head > ring->capacity) ? head - ring->capacity : 0;
+    for (size_t i = start; i < head; ++i)
     {
-        tmpBuf[i % 2] = recvPkt->pktData.buffer[i];
-        if ((i % 2) != 0)
+        mgdbTraceRecord *rec = &ring->records[i & (ring->capacity - 1)];
+        mgdbTraceRecord snapshot;
+        if (MGDB_ATOMIC_LOAD(&rec->seq) != (i + 1) * 2)
+        {
+            continue;
+        }
+        memcpy(&snapshot, rec, sizeof(snapshot));
+        MGDB_ATOMIC_FENCE();  // The copy above must complete before seq is checked again
+        if (MGDB_ATOMIC_LOAD(&rec->seq) != (i + 1) * 2)
         {
-            MGDB_HEX_DECODE_ASCII(tmpBuf, decodedHex);
-            mgdbObj->regs[i / 2] = (char)decodedHex;
+            continue;
         }
+        dumpFn(&snapshot, ctx);
     }
 }
 
-static void minigdbstubWriteReg(mgdbProcObj *mgdbObj, gdbPacket *recvPkt)
+// Register layout - one descriptor per GDB register number, usually a static const (constexpr in
+// C++) table built with MGDB_REG_DESC from the target's register file struct. Widths, offsets and
+// byte order are fixed at compile time; without a layout every register is regsSize / regsCount
+// bytes wide and sent in host byte order
+enum
 {
-    int index, valOffset = 0;
-    size_t regWidth = mgdbObj->regsSize / mgdbObj->regsCount;
-    for (int i = 0; recvPkt->pktData.buffer[i] != 0; ++i)
-    {
-        if (recvPkt->pktData.buffer[i] == '=')
-        {
-            recvPkt->pktData.buffer[i] = 0;
-            ++valOffset;
-            break;
-        }
-        ++valOffset;
-    }
-    MGDB_HEX_DECODE_ASCII(&recvPkt->pktData.buffer[1], index);
+    MGDB_REG_LITTLE_ENDIAN,
+    MGDB_REG_BIG_ENDIAN
+};
 
-    mgdbProcObj tmpProcObj = *mgdbObj;
-    tmpProcObj.regsCount   = 1;
-    tmpProcObj.regs        = &mgdbObj->regs[index * regWidth];
-    tmpProcObj.regsSize    = regWidth;
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#    define MGDB_REG_HOST_ORDER MGDB_REG_BIG_ENDIAN
+#else
+#    define MGDB_REG_HOST_ORDER MGDB_REG_LITTLE_ENDIAN
+#endif
 
-    gdbPacket tmpRecPkt      = *recvPkt;
-    tmpRecPkt.pktData.buffer = &recvPkt->pktData.buffer[valOffset];
+typedef struct
+{
+    const char *name;   // Register name in the target XML
+    size_t bitsize;     // Register width in bits (multiple of 8)
+    size_t offset;      // Byte offset in mgdbProcObj.regs
+    int byteOrder;      // Target byte order - swapped on the wire if it differs from the host
+    const char *type;   // Target XML type, e.g. "int", "code_ptr", "ieee_double", "vec128"
+    const char *group;  // Optional target XML group, e.g. "general", "float", "vector"
+} mgdbRegDesc;
 
-    minigdbstubWriteRegs(&tmpProcObj, &tmpRecPkt);
-    if (tmpProcObj.err != MGDB_SUCCESS)
-    {
-        mgdbObj->err = tmpProcObj.err;
+// Describe the register file member 'member' of struct 'regFileType'
+#define MGDB_REG_DESC(regFileType, member, name, byteOrder, type, group)                        \
+    {                                                                                            \
+        name, sizeof(((regFileType *)0)->member) * 8, offsetof(regFileType, member), byteOrder, \
+            type, group                                                                          \
     }
-}
 
-static void minigdbstubSendRegs(mgdbProcObj *mgdbObj)
+typedef struct
 {
-    DynCharBuffer sendPkt;
-    MGDB_CHECK_RET(initDynCharBuffer(&sendPkt, 512), mgdbObj);
-    MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, '$'), mgdbObj);
-
-    for (size_t i = 0; i < mgdbObj->regsSize; ++i)
-    {
-        char itoaBuff[8];
-        MGDB_HEX_ENCODE_ASCII((unsigned char)mgdbObj->regs[i], 3, itoaBuff);
-
-        // Swap if single digit
-        if (itoaBuff[1] == 0)
-        {
-            itoaBuff[1] = itoaBuff[0];
-            itoaBuff[0] = '0';
-        }
+    const char *arch;         // Optional <architecture> in the target XML, e.g. "riscv:rv32"
+    const char *feature;      // Target XML feature name, e.g. "org.gnu.gdb.riscv.cpu"
+    const mgdbRegDesc *regs;  // Descriptor table, indexed by GDB register number
+    size_t count;             // Number of descriptors
+} mgdbRegLayout;
 
-        MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, itoaBuff[0]), mgdbObj);
-        MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, itoaBuff[1]), mgdbObj);
+#define MGDB_REG_LAYOUT(arch, feature, descTable)                          \
+    {                                                                      \
+        arch, feature, descTable, sizeof(descTable) / sizeof(descTable[0]) \
     }
 
-    // Compute and append the checksum
-    char checksum[8];
-    size_t len = sendPkt.used - 1;
-    minigdbstubComputeChecksum(&sendPkt.buffer[1], len, checksum);
-    MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, '#'), mgdbObj);
-    MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, checksum[0]), mgdbObj);
-    MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, checksum[1]), mgdbObj);
-    MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, 0), mgdbObj);
+// Memory map - the regions GDB may access, served as qXfer:memory-map:read so GDB doesn't probe
+// anything else. Packets outside every region (or writing ROM) are answered with an error without
+// reaching the memory hooks
+enum
+{
+    MGDB_MEM_RAM,
+    MGDB_MEM_ROM
+};
 
-    minigdbstubSend((const char *)sendPkt.buffer, mgdbObj);
-    freeDynCharBuffer(&sendPkt);
-}
+#define MGDB_MEM_ERROR 1  // Error number replied ("E01") for accesses outside the memory map
 
-static void minigdbstubSendReg(mgdbProcObj *mgdbObj, gdbPacket *recvPkt)
+typedef struct
 {
-    int index;
-    size_t regWidth = mgdbObj->regsSize / mgdbObj->regsCount;
-    MGDB_HEX_DECODE_ASCII(&recvPkt->pktData.buffer[2], index);
+    size_t start;
+    size_t length;
+    int type;  // MGDB_MEM_RAM or MGDB_MEM_ROM
+} mgdbMemRegion;
 
-    mgdbProcObj tmpProcObj = *mgdbObj;
-    tmpProcObj.regsCount   = 1;
-    tmpProcObj.regs        = &mgdbObj->regs[index * regWidth];
-    tmpProcObj.regsSize    = regWidth;
+typedef struct
+{
+    const mgdbMemRegion *regions;
+    size_t count;
+} mgdbMemMap;
 
-    minigdbstubSendRegs(&tmpProcObj);
-    if (tmpProcObj.err != MGDB_SUCCESS)
-    {
-        mgdbObj->err = tmpProcObj.err;
+#define MGDB_MEM_MAP(regionTable)                                 \
+    {                                                             \
+        regionTable, sizeof(regionTable) / sizeof(regionTable[0]) \
     }
-}
 
-static void minigdbstubWriteMem(mgdbProcObj *mgdbObj, gdbPacket *recvPkt)
-{
-    size_t address, length;
-    int lengthOffset = 0;
-    int valOffset    = 0;
+// Byte -> two lowercase hex digits
+static const char minigdbstubHexPairs[] =
+    "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+    "202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+    "404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+    "606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+    "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+    "a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+    "c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+    "e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
 
-    // Grab the length offset
-    for (int i = 0; recvPkt->pktData.buffer[i] != 0; ++i)
+static int minigdbstubHexVal(char c)
+{
+    if (c >= '0' && c <= '9')
     {
-        if ((recvPkt->pktData.buffer[i] == ',') || (recvPkt->pktData.buffer[i] == ';') ||
-            (recvPkt->pktData.buffer[i] == ':'))
-        {
-            recvPkt->pktData.buffer[i] = 0;
-            ++lengthOffset;
-            valOffset = lengthOffset;
-            break;
-        }
-        ++lengthOffset;
+        return c - '0';
     }
-    // Grab the data value offset
-    for (int i = 0; recvPkt->pktData.buffer[i] != 0; ++i)
+    if (c >= 'a' && c <= 'f')
     {
-        if ((recvPkt->pktData.buffer[i] == ',') || (recvPkt->pktData.buffer[i] == ';') ||
-            (recvPkt->pktData.buffer[i] == ':'))
-        {
-            recvPkt->pktData.buffer[i] = 0;
-            ++valOffset;
-            break;
-        }
-        ++valOffset;
+        return c - 'a' + 10;
     }
-    MGDB_HEX_DECODE_ASCII(&recvPkt->pktData.buffer[1], address);
-    MGDB_HEX_DECODE_ASCII(&recvPkt->pktData.buffer[lengthOffset], length);
-
-    // Call user write memory handler
-    for (size_t i = 0; i < length; ++i)
+    if (c >= 'A' && c <= 'F')
     {
-        int decodedVal;
-        char atoiBuf[8];
-        atoiBuf[0] = recvPkt->pktData.buffer[valOffset + (i * 2)];
-        atoiBuf[1] = recvPkt->pktData.buffer[valOffset + (i * 2) + 1];
-        MGDB_HEX_DECODE_ASCII(atoiBuf, decodedVal);
-        minigdbstubUsrWriteMem(address + i, (unsigned char)decodedVal, mgdbObj->usrData);
+        return c - 'A' + 10;
     }
+    return -1;
+}
 
-    // Send ACK to GDB
-    minigdbstubSend(MGDB_ACK_PACKET, mgdbObj);
+// Hex-encode 'bytes' register bytes into out (2 chars each), reversed if swap is set
+static void minigdbstubEncodeRegBytes(char *out, const char *src, size_t bytes, int swap)
+{
+    const unsigned char *in = (const unsigned char *)(swap ? &src[bytes - 1] : src);
+    ptrdiff_t step          = swap ? -1 : 1;
+    for (size_t i = 0; i < bytes; ++i, in += step)
+    {
+        memcpy(&out[i * 2], &minigdbstubHexPairs[*in * 2], 2);
+    }
 }
 
-static void minigdbstubReadMem(mgdbProcObj *mgdbObj, gdbPacket *recvPkt)
+// Decode up to 'bytes' bytes of hex into dst, reversed if swap is set - returns the bytes decoded
+static size_t minigdbstubDecodeRegBytes(char *dst, const char *hex, size_t bytes, int swap)
 {
-    size_t address, length;
-    int valOffset = 0;
-    for (int i = 0; recvPkt->pktData.buffer[i] != 0; ++i)
+    char *out      = swap ? &dst[bytes - 1] : dst;
+    ptrdiff_t step = swap ? -1 : 1;
+    size_t i       = 0;
+    for (; i < bytes; ++i, out += step)
     {
-        if ((recvPkt->pktData.buffer[i] == ',') || (recvPkt->pktData.buffer[i] == ';') ||
-            (recvPkt->pktData.buffer[i] == ':'))
+        int hi = minigdbstubHexVal(hex[i * 2]);
+        int lo = (hi < 0) ? -1 : minigdbstubHexVal(hex[(i * 2) + 1]);
+        if (lo < 0)
         {
-            recvPkt->pktData.buffer[i] = 0;
-            ++valOffset;
             break;
         }
-        ++valOffset;
+        *out = (char)((hi << 4) | lo);
     }
-    MGDB_HEX_DECODE_ASCII(&recvPkt->pktData.buffer[1], address);
-    MGDB_HEX_DECODE_ASCII(&recvPkt->pktData.buffer[valOffset], length);
+    return i;
+}
 
-    // Alloc a packet w/ the requested data to send as a response to GDB
-    DynCharBuffer memBuf;
-    MGDB_CHECK_RET(initDynCharBuffer(&memBuf, length), mgdbObj);
-    MGDB_CHECK_RET(insertDynCharBuffer(&memBuf, '$'), mgdbObj);
+enum
+{
+    MGDB_SOFT_BREAKPOINT = (1 << 0),
+    MGDB_HARD_BREAKPOINT = (1 << 1),
 
-    // Call user read memory handler
-    for (size_t i = 0; i < length; ++i)
-    {
-        char itoaBuff[8];
-        unsigned char c = minigdbstubUsrReadMem(address + i, mgdbObj->usrData);
-        MGDB_HEX_ENCODE_ASCII(c, 3, itoaBuff);
+    MGDB_SET_BREAKPOINT   = (1 << 2),
+    MGDB_CLEAR_BREAKPOINT = (1 << 3),
+    MGDB_TRACEPOINT       = (1 << 4)  // Planted for a trace run rather than a GDB breakpoint
+};
 
-        // Swap if single digit
-        if (itoaBuff[1] == 0)
-        {
-            itoaBuff[1] = itoaBuff[0];
-            itoaBuff[0] = '0';
-        }
+// Breakpoint table - lets the stub evaluate GDB's breakpoint conditions (agent expression bytecode)
+// on the target side. User-provided storage, persists across minigdbstubProcess calls and GDB
+// sessions: a GDB that reconnects re-sends its breakpoints, and the ones the table still holds
+// aren't planted again. Entries the new GDB doesn't re-send are removed when it first resumes
+#ifndef MGDB_BP_COND_SIZE
+#    define MGDB_BP_COND_SIZE 64  // Bytecode bytes per breakpoint, all of its conditions together
+#endif
+#ifndef MGDB_BP_MAX_CONDS
+#    define MGDB_BP_MAX_CONDS 4
+#endif
 
-        MGDB_CHECK_RET(insertDynCharBuffer(&memBuf, itoaBuff[0]), mgdbObj);
-        MGDB_CHECK_RET(insertDynCharBuffer(&memBuf, itoaBuff[1]), mgdbObj);
-    }
+typedef struct
+{
+    size_t addr;
+    int type;                                   // MGDB_SOFT_BREAKPOINT / MGDB_HARD_BREAKPOINT
+    size_t condCount;                           // Stop if any condition is true (or there are none)
+    unsigned short condLen[MGDB_BP_MAX_CONDS];  // Length of each condition in bytecode
+    unsigned char bytecode[MGDB_BP_COND_SIZE];  // Conditions back to back
+    size_t generation;                          // Table generation of its last Z packet
+} mgdbBreakpoint;
 
-    // Compute and append the checksum
-    char checksum[8];
-    size_t len = memBuf.used - 1;
-    minigdbstubComputeChecksum(&memBuf.buffer[1], len, checksum);
-    MGDB_CHECK_RET(insertDynCharBuffer(&memBuf, '#'), mgdbObj);
-    MGDB_CHECK_RET(insertDynCharBuffer(&memBuf, checksum[0]), mgdbObj);
-    MGDB_CHECK_RET(insertDynCharBuffer(&memBuf, checksum[1]), mgdbObj);
-    MGDB_CHECK_RET(insertDynCharBuffer(&memBuf, 0), mgdbObj);
+typedef struct
+{
+    mgdbBreakpoint *entries;
+    size_t capacity;
+    size_t count;
+    size_t hits;        // minigdbstubBreakpointHit calls
+    size_t stops;       // ... that stopped the target
+    size_t generation;  // Bumped when a GDB attaches after a detach
+} mgdbBreakpointTable;
 
-    minigdbstubSend((const char *)memBuf.buffer, mgdbObj);
-    freeDynCharBuffer(&memBuf);
+static void minigdbstubBreakpointInit(mgdbBreakpointTable *table, mgdbBreakpoint *entries,
+                                      size_t capacity)
+{
+    memset(table, 0, sizeof(*table));
+    table->entries  = entries;
+    table->capacity = capacity;
 }
 
-static void minigdbstubSendSignal(mgdbProcObj *mgdbObj)
+static mgdbBreakpoint *minigdbstubBreakpointFind(mgdbBreakpointTable *table, size_t addr)
 {
-    DynCharBuffer sendPkt;
+    for (size_t i = 0; i < table->count; ++i)
+    {
+        if (table->entries[i].addr == addr)
+        {
+            return &table->entries[i];
+        }
+    }
+    return NULL;
+}
+
+// Tracepoints - GDB's QTDP definitions plus a circular buffer of trace frames, so the target can
+// record registers and memory at a location without stopping. User-provided storage, persists
+// across minigdbstubProcess calls
+#ifndef MGDB_TP_MAX_MEM
+#    define MGDB_TP_MAX_MEM 8  // 'M' memory ranges per tracepoint
+#endif
+#ifndef MGDB_TP_MAX_EXPRS
+#    define MGDB_TP_MAX_EXPRS 4  // 'X' collection expressions per tracepoint
+#endif
+#ifndef MGDB_TP_BYTECODE_SIZE
+#    define MGDB_TP_BYTECODE_SIZE 128  // Condition and collection expressions together
+#endif
+
+typedef struct
+{
+    int baseReg;  // Register holding the base address, -1 for an absolute address
+    size_t offset;
+    size_t len;
+} mgdbTraceMemRange;
+
+typedef struct
+{
+    unsigned int number;                        // GDB's number - one entry per location
+    size_t addr;
+    int enabled;
+    int breakpoint;                             // GDB has a Z0/Z1 here too (no breakpoint table)
+    size_t passCount;                           // Stop the run after this many frames
+    size_t hits;                                // Frames collected in the current run
+    int collectRegs;                            // 'R' action - the whole register file
+    size_t memCount;
+    mgdbTraceMemRange mem[MGDB_TP_MAX_MEM];
+    size_t exprCount;
+    unsigned short condLen;                     // Condition length in bytecode (0 = none)
+    unsigned short exprLen[MGDB_TP_MAX_EXPRS];  // Expression lengths, after the condition
+    size_t bytecodeUsed;
+    unsigned char bytecode[MGDB_TP_BYTECODE_SIZE];
+} mgdbTracepoint;
+
+enum
+{
+    MGDB_TP_NOT_RUN,
+    MGDB_TP_RUNNING,
+    MGDB_TP_STOPPED,   // QTStop
+    MGDB_TP_PASSCOUNT  // A tracepoint reached its pass count
+};
+
+typedef struct
+{
+    mgdbTracepoint *defs;
+    size_t defCapacity;
+    size_t defCount;
+    unsigned char *frames;  // Circular frame storage
+    size_t framesSize;
+    size_t head, tail;      // Stored frames occupy byte positions [tail, head) modulo framesSize
+    size_t firstFrame;      // Number of the oldest stored frame - older ones were overwritten
+    size_t frameCount;      // Frames stored
+    size_t frameStart;      // Position of the frame being collected
+    int collecting;         // A frame is open - trace opcodes in 'X' expressions record into it
+    int status;             // MGDB_TP_*
+    unsigned int stopTp;    // Tracepoint that reached its pass count
+    long selected;          // Frame selected by QTFrame, -1 for the live target
+} mgdbTracepoints;
+
+// A stored frame is a header followed by blocks, each a block header plus len bytes of data
+typedef struct
+{
+    size_t size;  // Header and blocks
+    size_t addr;
+    unsigned int number;
+} mgdbTraceFrameHdr;
+
+typedef struct
+{
+    char type;  // 'R' - register file, 'M' - memory at addr
+    size_t addr;
+    size_t len;
+} mgdbTraceBlock;
+
+static void minigdbstubTracepointInit(mgdbTracepoints *tp, mgdbTracepoint *defs, size_t defCapacity,
+                                      unsigned char *frames, size_t framesSize)
+{
+    memset(tp, 0, sizeof(*tp));
+    tp->defs        = defs;
+    tp->defCapacity = defCapacity;
+    tp->frames      = frames;
+    tp->framesSize  = framesSize;
+    tp->selected    = -1;
+}
+
+// Copy len bytes to (write) or from byte position pos of a circular buffer
+static void minigdbstubRingCopy(unsigned char *ring, size_t ringSize, size_t pos, void *data,
+                                size_t len, int write)
+{
+    unsigned char *bytes = (unsigned char *)data;
+    while (len > 0)
+    {
+        size_t at    = pos % ringSize;
+        size_t chunk = ringSize - at;
+        chunk        = (chunk > len) ? len : chunk;
+        if (write)
+        {
+            memcpy(&ring[at], bytes, chunk);
+        }
+        else
+        {
+            memcpy(bytes, &ring[at], chunk);
+        }
+        pos += chunk;
+        bytes += chunk;
+        len -= chunk;
+    }
+}
+
+// Copy len bytes to (write) or from byte position pos of the frame storage
+static void minigdbstubTraceCopy(mgdbTracepoints *tp, size_t pos, void *data, size_t len, int write)
+{
+    minigdbstubRingCopy(tp->frames, tp->framesSize, pos, data, len, write);
+}
+
+// Make room for len more bytes of the open frame by dropping the oldest frames - returns 0 (and
+// abandons the frame) if it can't fit
+static int minigdbstubTraceReserve(mgdbTracepoints *tp, size_t len)
+{
+    if (!tp->collecting)
+    {
+        return 0;
+    }
+    while (tp->head + len - tp->tail > tp->framesSize)
+    {
+        if (tp->tail == tp->frameStart)
+        {
+            tp->head       = tp->frameStart;
+            tp->collecting = 0;
+            return 0;
+        }
+        mgdbTraceFrameHdr hdr;
+        minigdbstubTraceCopy(tp, tp->tail, &hdr, sizeof(hdr), 0);
+        tp->tail += hdr.size;
+        ++tp->firstFrame;
+        --tp->frameCount;
+    }
+    return 1;
+}
+
+static void minigdbstubTraceAppend(mgdbTracepoints *tp, const void *data, size_t len)
+{
+    minigdbstubTraceCopy(tp, tp->head, (void *)data, len, 1);
+    tp->head += len;
+}
+
+// Drop all frames and go back to the live target
+static void minigdbstubTraceClear(mgdbTracepoints *tp)
+{
+    tp->head       = 0;
+    tp->tail       = 0;
+    tp->firstFrame = 0;
+    tp->frameCount = 0;
+    tp->collecting = 0;
+    tp->selected   = -1;
+}
+
+// Snapshots - reverse execution (bs/bc) by restoring a checkpoint and replaying forward. A
+// circular arena of user-provided storage holds two kinds of records: checkpoints (instruction
+// count and register file, every 'interval' instructions) and the contents a page had at the
+// newest checkpoint, saved the first time it's written after it. Capture cost and memory scale
+// with the pages that actually change; a per-page bit remembers which ones were saved already
+#ifndef MGDB_SNAP_PAGE_SHIFT
+#    define MGDB_SNAP_PAGE_SHIFT 12  // 4 KiB pages
+#endif
+
+// Bytes of page bits for memSize bytes of target memory
+#define MGDB_SNAP_BITS_SIZE(memSize) \
+    (((((memSize) + ((size_t)1 << MGDB_SNAP_PAGE_SHIFT) - 1) >> MGDB_SNAP_PAGE_SHIFT) + 7) / 8)
+
+enum
+{
+    MGDB_SNAP_RECORDING,  // Running forward, taking checkpoints
+    MGDB_SNAP_REPLAYING,  // Re-executing up to replayTo after a rewind
+    MGDB_SNAP_SCANNING    // Re-executing up to replayTo looking for the last breakpoint hit (bc)
+};
+
+// minigdbstubSnapshotStep results
+enum
+{
+    MGDB_SNAP_RUN,     // Execute the instruction
+    MGDB_SNAP_STOP,    // Stop here and report SIGTRAP (end of a reverse step/continue)
+    MGDB_SNAP_REWOUND  // Registers and memory were rewound - re-read the pc and call again
+};
+
+typedef struct
+{
+    size_t size;                // Header and data
+    size_t prev;                // Position of the previous record
+    size_t addr;                // 'P': page address, 'C': position of the previous checkpoint
+    unsigned long long icount;  // 'C': instructions executed before the checkpoint
+    char type;                  // 'C' - checkpoint + register file, 'P' - page contents
+} mgdbSnapRecord;
+
+typedef struct
+{
+    unsigned char *arena;         // Circular record storage
+    size_t arenaSize;
+    size_t head, tail;            // Records occupy byte positions [tail, head) modulo arenaSize
+    size_t last;                  // Position of the newest record
+    size_t lastCheckpoint;        // Position of the newest checkpoint
+    size_t checkpoints;           // Checkpoints stored
+    unsigned char *pageBits;      // MGDB_SNAP_BITS_SIZE(memSize) bytes - page saved since the
+                                  // newest checkpoint
+    size_t memSize;               // Target memory tracked, from address 0
+    unsigned char *mem;           // Optional flat target memory - NULL goes through the mem hooks
+    unsigned long long interval;  // Instructions between checkpoints
+    unsigned long long icount;    // Instructions executed - the position in the recorded history
+    unsigned long long nextCheckpoint;
+    int mode;                     // MGDB_SNAP_RECORDING/REPLAYING/SCANNING
+    unsigned long long replayTo;  // Replaying/scanning stops before this instruction
+    unsigned long long scanFrom;  // Scanning: checkpoint the scan started at
+    unsigned long long scanHit;   // Scanning: last breakpoint hit so far (~0ULL: none)
+    int atBegin;                  // Stopped at the oldest checkpoint (replaylog:begin)
+    size_t pagesSaved;            // Page records written
+    size_t pagesRestored;         // Page records applied by rewinds
+} mgdbSnapshots;
+
+static void minigdbstubSnapshotInit(mgdbSnapshots *snap, unsigned char *arena, size_t arenaSize,
+                                    unsigned char *pageBits, size_t memSize,
+                                    unsigned long long interval)
+{
+    memset(snap, 0, sizeof(*snap));
+    memset(pageBits, 0, MGDB_SNAP_BITS_SIZE(memSize));
+    snap->arena     = arena;
+    snap->arenaSize = arenaSize;
+    snap->pageBits  = pageBits;
+    snap->memSize   = memSize;
+    snap->interval  = interval ? interval : 1;
+}
+
+// Core dumps - 'monitor dump-core <path>' writes an ELF core of the stopped target from inside the
+// stub: the registers as an NT_PRSTATUS note laid out the way GDB reads it for the architecture,
+// and every memory map region read MGDB_CORE_BLOCK bytes at a time
+#ifndef MGDB_CORE_BLOCK
+#    define MGDB_CORE_BLOCK 4096  // Bytes read at a time - all-zero blocks take no file space
+#endif
+
+typedef struct
+{
+    unsigned short machine;  // ELF e_machine, e.g. 243 (EM_RISCV)
+    int is64;                // ELFCLASS64 (otherwise ELFCLASS32)
+    unsigned int flags;      // ELF e_flags, e.g. the RISC-V float ABI
+    const int *gregMap;      // GDB register number for each pr_reg slot (-1: always zero)
+    size_t gregCount;        // pr_reg slots
+    size_t gregSize;         // Bytes per pr_reg slot (at most 8)
+} mgdbCoreInfo;
+
+// Profiler - 'monitor profile start [interval]' samples the pc every 'interval' instructions into a
+// histogram keyed by address, 'monitor profile dump' prints it hottest first. The target calls
+// minigdbstubProfileTick once per instruction: a countdown decrement until a sample is due, cheap
+// enough to leave in the run loop at full speed. The histogram is open-addressed user storage
+// claimed with compare-and-swap, so several target threads (or a timer calling
+// minigdbstubProfileSample) can share it without a lock
+#ifndef MGDB_PROFILE_INTERVAL
+#    define MGDB_PROFILE_INTERVAL 1000  // Instructions between samples unless 'start' names one
+#endif
+
+typedef struct
+{
+    size_t pc;     // Sampled address + 1 (0: free slot)
+    size_t count;  // Samples taken at pc
+} mgdbProfileEntry;
+
+typedef struct
+{
+    mgdbProfileEntry *entries;  // Caller-owned histogram
+    size_t capacity;            // Number of entries (must be a power of 2)
+    size_t interval;            // Instructions between samples
+    size_t countdown;           // Instructions until the next sample - target thread only
+    size_t running;             // Between 'profile start' and 'profile stop'
+    int pcReg;                  // Register minigdbstubProfileTick samples (-1: "pc" or the first
+                                // code_ptr of the register layout)
+    size_t pcOffset, pcBytes;   // Where the pc sits in mgdbObj->regs - set by 'profile start'
+    int pcSwap;                 // The pc isn't in host byte order
+    size_t samples;             // Samples taken since 'profile start'
+    size_t dropped;             // Samples lost to a full histogram
+} mgdbProfile;
+
+static void minigdbstubProfileInit(mgdbProfile *prof, mgdbProfileEntry *entries, size_t capacity)
+{
+    memset(prof, 0, sizeof(*prof));
+    memset(entries, 0, capacity * sizeof(mgdbProfileEntry));
+    prof->entries   = entries;
+    prof->capacity  = capacity;
+    prof->interval  = MGDB_PROFILE_INTERVAL;
+    prof->countdown = MGDB_PROFILE_INTERVAL;
+    prof->pcReg     = -1;
+}
+
+// Threads - run state and register files for thread packets and non-stop mode. User-provided
+// storage (fill in id and regs before minigdbstubThreadInit), persists across minigdbstubProcess
+// calls
+typedef struct
+{
+    size_t id;        // GDB thread id, non-zero
+    char *regs;       // Register file (laid out like mgdbObj->regs) - NULL shares mgdbObj->regs
+    int running;
+    int signalNum;    // Signal reported for the last stop
+    int pendingStop;  // Stop GDB hasn't acknowledged with vStopped yet (non-stop mode)
+    size_t stopSeq;   // Report order of pending stops
+} mgdbThread;
+
+typedef struct
+{
+    mgdbThread *threads;
+    size_t count;
+    size_t current;  // Index of the thread selected by Hg or reported by the last stop
+    int nonStop;     // QNonStop:1 - threads stop and resume independently
+    int notified;    // A stop notification (or non-stop '?' reply) awaits vStopped
+    size_t nextSeq;
+} mgdbThreadTable;
+
+static void minigdbstubThreadInit(mgdbThreadTable *table, mgdbThread *threads, size_t count)
+{
+    memset(table, 0, sizeof(*table));
+    table->threads = threads;
+    table->count   = count;
+    for (size_t i = 0; i < count; ++i)
+    {
+        threads[i].running     = 0;
+        threads[i].pendingStop = 0;
+        threads[i].signalNum   = 0;
+    }
+}
+
+static mgdbThread *minigdbstubThreadFind(mgdbThreadTable *table, size_t id)
+{
+    for (size_t i = 0; i < table->count; ++i)
+    {
+        if (table->threads[i].id == id)
+        {
+            return &table->threads[i];
+        }
+    }
+    return NULL;
+}
+
+// Lazy registers - with mgdbProcObj.regCache set, mgdbObj->regs is only a cache of the target's
+// registers: each one is fetched with the ReadReg hook the first time a packet needs it during a
+// stop, and the ones GDB wrote go back through the WriteReg hook right before the target resumes
+enum
+{
+    MGDB_REG_CACHED = 1,  // Fetched (or written by GDB) during this stop
+    MGDB_REG_DIRTY  = 2   // Written by GDB, not passed to the WriteReg hook yet
+};
+
+typedef struct
+{
+    unsigned char *state;  // Caller-owned - one MGDB_REG_* flag byte per register
+    size_t count;          // Number of registers (regLayout->count or regsCount)
+    size_t fetches;        // ReadReg hook calls
+    size_t writebacks;     // WriteReg hook calls
+} mgdbRegCache;
+
+static void minigdbstubRegCacheInit(mgdbRegCache *cache, unsigned char *state, size_t count)
+{
+    memset(cache, 0, sizeof(*cache));
+    memset(state, 0, count);
+    cache->state = state;
+    cache->count = count;
+}
+
+// minigdbstub process call object
+typedef struct
+{
+    char *regs;                        // Pointer to register array
+    size_t regsSize;                   // Size of register array in bytes
+    size_t regsCount;                  // Total number of registers
+    int signalNum;                     // Signal that can be sent to GDB on certain operations
+    mgdbOpts opts;                     // Options bitfield
+    int err;                           // Return-error code
+    void *usrData;                     // Optional handle to opaque user data
+    mgdbTraceRing *traceRing;          // Optional packet trace ring buffer
+    mgdbIoTapFn ioTap;                 // Optional transport tap (e.g. session recorder)
+    void *ioTapData;                   // Opaque data forwarded to ioTap
+    const mgdbRegLayout *regLayout;    // Optional per-register widths/offsets/byte order
+    const mgdbRegLayout *sizedLayout;  // regLayout that regLayoutSize was measured for
+    size_t regLayoutSize;              // Register file bytes sizedLayout spans
+    mgdbBreakpointTable *breakpoints;  // Optional - enables target-side breakpoint conditions
+    mgdbTracepoints *tracepoints;      // Optional - enables tracepoints and trace frames
+    mgdbThreadTable *threads;          // Optional - enables thread packets and non-stop mode
+    mgdbRegCache *regCache;            // Optional - fetch registers lazily (ReadReg/WriteReg hooks)
+    const mgdbMemMap *memMap;          // Optional - qXfer:memory-map:read, unmapped accesses fail
+    mgdbSnapshots *snapshots;          // Optional - enables reverse execution (bs/bc)
+    const mgdbCoreInfo *coreInfo;      // Optional - enables 'monitor dump-core' (needs memMap)
+    mgdbProfile *profile;              // Optional - enables 'monitor profile' (pc sampling)
+    int detached;                      // GDB detached ('D' or a dropped connection) - the next
+                                       // packet starts a new session
+    size_t reattaches;                 // Sessions started after a detach (stat)
+} mgdbProcObj;
+
+// ====================================================================================================================
+// User stubs
+// ====================================================================================================================
+#ifndef MGDB_NO_USR_HOOKS  // C++ only - for TUs that only use mgdb::Stub<Target> (minigdbstub.hpp)
+static void minigdbstubUsrPutchar(char data, void *usrData);
+static char minigdbstubUsrGetchar(void *usrData);
+static void minigdbstubUsrWriteMem(size_t addr, unsigned char data, void *usrData);
+static unsigned char minigdbstubUsrReadMem(size_t addr, void *usrData);
+static void minigdbstubUsrContinue(void *usrData);
+static void minigdbstubUsrStep(void *usrData);
+static void minigdbstubUsrProcessBreakpoint(int type, size_t addr, void *usrData);
+static void minigdbstubUsrKillSession(void *usrData);
+#    ifdef MGDB_USR_FLUSH
+// Optional - called at reply boundaries so buffered transports can write a whole packet at once
+static void minigdbstubUsrFlush(void *usrData);
+#    endif
+#    ifdef MGDB_USR_THREADS
+// Optional - resume (step != 0: single-step) or interrupt one thread of mgdbObj->threads. Without
+// them the whole target continues/steps and threads can't be interrupted
+static void minigdbstubUsrResumeThread(size_t threadId, int step, void *usrData);
+static void minigdbstubUsrStopThread(size_t threadId, void *usrData);
+#    endif
+#    ifdef MGDB_USR_REG_CALLBACKS
+// Optional - with mgdbProcObj.regCache set, copy register 'index' of the stopped (or selected)
+// thread from/to the target in host byte order. value is the register's slot in mgdbObj->regs
+static void minigdbstubUsrReadReg(size_t index, char *value, void *usrData);
+static void minigdbstubUsrWriteReg(size_t index, const char *value, void *usrData);
+#    endif
+#    ifdef MGDB_USR_MEM_CHECK
+// Optional - called once per memory packet before the ReadMem/WriteMem hooks. Returns 0 if len
+// bytes at addr can be read (write == 0) or written, otherwise an error number (1-255) for GDB
+static int minigdbstubUsrCheckMem(size_t addr, size_t len, int write, void *usrData);
+#    endif
+#endif
+// ====================================================================================================================
+
+// Hook binding - C calls the minigdbstubUsr* stubs directly. In C++ every function that reaches a
+// hook is a template over a hooks class whose static members are called instead, so targets can be
+// bound (and inlined) per type. The default hooks class forwards to the minigdbstubUsr* stubs,
+// which keeps the plain C API a thin instantiation of the same code
+#ifdef __cplusplus
+#    ifndef MGDB_NO_USR_HOOKS
+// A template so the stubs above are only required once the C API is actually instantiated, and in
+// an unnamed namespace since every translation unit has its own static stubs
+namespace
+{
+template <int Unused = 0>
+struct mgdbUsrHooks
+{
+    static void Putchar(char data, void *usrData) { minigdbstubUsrPutchar(data, usrData); }
+    static char Getchar(void *usrData) { return minigdbstubUsrGetchar(usrData); }
+    static void WriteMem(size_t addr, unsigned char data, void *usrData)
+    {
+        minigdbstubUsrWriteMem(addr, data, usrData);
+    }
+    static unsigned char ReadMem(size_t addr, void *usrData)
+    {
+        return minigdbstubUsrReadMem(addr, usrData);
+    }
+    static void Continue(void *usrData) { minigdbstubUsrContinue(usrData); }
+    static void Step(void *usrData) { minigdbstubUsrStep(usrData); }
+    static void ProcessBreakpoint(int type, size_t addr, void *usrData)
+    {
+        minigdbstubUsrProcessBreakpoint(type, addr, usrData);
+    }
+    static void KillSession(void *usrData) { minigdbstubUsrKillSession(usrData); }
+#        ifdef MGDB_USR_FLUSH
+    static void Flush(void *usrData) { minigdbstubUsrFlush(usrData); }
+#        else
+    static void Flush(void *usrData) {}
+#        endif
+#        ifdef MGDB_USR_THREADS
+    static void ResumeThread(size_t threadId, int step, void *usrData)
+    {
+        minigdbstubUsrResumeThread(threadId, step, usrData);
+    }
+    static void StopThread(size_t threadId, void *usrData)
+    {
+        minigdbstubUsrStopThread(threadId, usrData);
+    }
+#        else
+    static void ResumeThread(size_t threadId, int step, void *usrData)
+    {
+        step ? minigdbstubUsrStep(usrData) : minigdbstubUsrContinue(usrData);
+    }
+    static void StopThread(size_t threadId, void *usrData) {}
+#        endif
+#        ifdef MGDB_USR_REG_CALLBACKS
+    static void ReadReg(size_t index, char *value, void *usrData)
+    {
+        minigdbstubUsrReadReg(index, value, usrData);
+    }
+    static void WriteReg(size_t index, const char *value, void *usrData)
+    {
+        minigdbstubUsrWriteReg(index, value, usrData);
+    }
+#        else
+    static void ReadReg(size_t index, char *value, void *usrData) {}
+    static void WriteReg(size_t index, const char *value, void *usrData) {}
+#        endif
+#        ifdef MGDB_USR_MEM_CHECK
+    static int CheckMem(size_t addr, size_t len, int write, void *usrData)
+    {
+        return minigdbstubUsrCheckMem(addr, len, write, usrData);
+    }
+#        else
+    static int CheckMem(size_t addr, size_t len, int write, void *usrData) { return 0; }
+#        endif
+};
+}  // namespace
+#        define MGDB_TPL template <class MgdbHooks = mgdbUsrHooks<> >
+#    else
+#        define MGDB_TPL template <class MgdbHooks>
+#    endif
+#    define MGDB_T <MgdbHooks>
+#    define MGDB_USR_CALL(hook) MgdbHooks::hook
+#else
+#    define MGDB_TPL
+#    define MGDB_T
+#    define MGDB_USR_CALL(hook) minigdbstubUsr##hook
+#endif
+
+// Transport layer - all stub I/O goes through these
+MGDB_TPL static void minigdbstubPutchar(char data, mgdbProcObj *mgdbObj)
+{
+    if (mgdbObj->ioTap)
+    {
+        mgdbObj->ioTap(MGDB_TRACE_SEND, data, mgdbObj->ioTapData);
+    }
+    MGDB_USR_CALL(Putchar)(data, mgdbObj->usrData);
+}
+
+MGDB_TPL static char minigdbstubGetchar(mgdbProcObj *mgdbObj)
+{
+    char data = MGDB_USR_CALL(Getchar)(mgdbObj->usrData);
+    if (mgdbObj->ioTap)
+    {
+        mgdbObj->ioTap(MGDB_TRACE_RECV, data, mgdbObj->ioTapData);
+    }
+    return data;
+}
+
+MGDB_TPL static void minigdbstubFlush(mgdbProcObj *mgdbObj)
+{
+#if defined(__cplusplus) || defined(MGDB_USR_FLUSH)
+    MGDB_USR_CALL(Flush)(mgdbObj->usrData);
+#else
+    (void)mgdbObj;
+#endif
+}
+
+MGDB_TPL static void minigdbstubResumeThread(mgdbProcObj *mgdbObj, size_t threadId, int step)
+{
+#if defined(__cplusplus) || defined(MGDB_USR_THREADS)
+    MGDB_USR_CALL(ResumeThread)(threadId, step, mgdbObj->usrData);
+#else
+    (void)threadId;
+    if (step)
+    {
+        MGDB_USR_CALL(Step)(mgdbObj->usrData);
+    }
+    else
+    {
+        MGDB_USR_CALL(Continue)(mgdbObj->usrData);
+    }
+#endif
+}
+
+MGDB_TPL static void minigdbstubStopThread(mgdbProcObj *mgdbObj, size_t threadId)
+{
+#if defined(__cplusplus) || defined(MGDB_USR_THREADS)
+    MGDB_USR_CALL(StopThread)(threadId, mgdbObj->usrData);
+#else
+    (void)mgdbObj;
+    (void)threadId;
+#endif
+}
+
+static void minigdbstubComputeChecksum(char *buffer, size_t len, char *outBuf)
+{
+    unsigned int checksum = 0;
+    for (size_t i = 0; i < len; ++i)
+    {
+        checksum = (checksum + buffer[i]) % 256;
+    }
+    MGDB_HEX_ENCODE_ASCII(checksum, 3, outBuf);
+
+    // If the value is single digit
+    if (outBuf[1] == 0)
+    {
+        outBuf[1] = outBuf[0];
+        outBuf[0] = '0';
+    }
+}
+
+MGDB_TPL static void minigdbstubSend(const char *data, mgdbProcObj *mgdbObj)
+{
+    size_t len = strlen(data);
+    if (mgdbObj->opts.o_enableLogging)
+    {
+        MGDB_LOG_TRACE(MGDB_SEND " : packet = %s\n", data);
+    }
+    if (mgdbObj->traceRing)
+    {
+        minigdbstubTraceRecord(mgdbObj->traceRing, MGDB_TRACE_SEND, data, len);
+    }
+    for (size_t i = 0; i < len; ++i)
+    {
+        minigdbstubPutchar MGDB_T(data[i], mgdbObj);
+    }
+}
+
+// Append the checksum to a packet built as "$<data>" and send it
+MGDB_TPL static void minigdbstubSendPkt(DynCharBuffer *pkt, mgdbProcObj *mgdbObj)
+{
+    char checksum[8];
+    minigdbstubComputeChecksum(&pkt->buffer[1], pkt->used - 1, checksum);
+    MGDB_CHECK_RET(reserveDynCharBuffer(pkt, 4), mgdbObj);
+    pkt->buffer[pkt->used++] = '#';
+    pkt->buffer[pkt->used++] = checksum[0];
+    pkt->buffer[pkt->used++] = checksum[1];
+    pkt->buffer[pkt->used]   = 0;
+    minigdbstubSend MGDB_T((const char *)pkt->buffer, mgdbObj);
+}
+
+// Frame and send a short reply payload
+MGDB_TPL static void minigdbstubSendPayload(const char *payload, size_t len, mgdbProcObj *mgdbObj)
+{
+    DynCharBuffer sendPkt = {0};
+    MGDB_CHECK_RET(initDynCharBuffer(&sendPkt, len + 8), mgdbObj);
+    MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, '$'), mgdbObj);
+    MGDB_CHECK_RET(appendDynCharBuffer(&sendPkt, payload, len), mgdbObj);
+    minigdbstubSendPkt MGDB_T(&sendPkt, mgdbObj);
+    freeDynCharBuffer(&sendPkt);
+}
+
+MGDB_TPL static void minigdbstubRecv(mgdbProcObj *mgdbObj, gdbPacket *gdbPkt)
+{
+    int currentOffset = 0;
+    char c;
+
+    // Push out any pending reply before blocking on the next packet
+    minigdbstubFlush MGDB_T(mgdbObj);
+    while (1)
+    {
+        // Get the beginning of the packet data '$'
+        while (1)
+        {
+            c = minigdbstubGetchar MGDB_T(mgdbObj);
+            if (c == '$')
+            {
+                break;
+            }
+        }
+
+        // Read packet data until the end '#' - then read the remaining 2 checksum digits
+        while (1)
+        {
+            c = minigdbstubGetchar MGDB_T(mgdbObj);
+            if (c == '#')
+            {
+                gdbPkt->checksum[0] = minigdbstubGetchar MGDB_T(mgdbObj);
+                gdbPkt->checksum[1] = minigdbstubGetchar MGDB_T(mgdbObj);
+                gdbPkt->checksum[2] = 0;
+                MGDB_CHECK_RET(insertDynCharBuffer(&gdbPkt->pktData, 0), mgdbObj);
+                break;
+            }
+            MGDB_CHECK_RET(insertDynCharBuffer(&gdbPkt->pktData, c), mgdbObj);
+            ++currentOffset;
+        }
+
+        // Compute checksum and compare with expected checksum
+        // Request retransmission if checksum verification fails
+        char actualChecksum[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+        minigdbstubComputeChecksum(gdbPkt->pktData.buffer, currentOffset, actualChecksum);
+        if (strcmp(gdbPkt->checksum, actualChecksum) != 0)
+        {
+            gdbPkt->pktData.used = 0;
+            minigdbstubSend MGDB_T(MGDB_RESEND_PACKET, mgdbObj);
+            minigdbstubFlush MGDB_T(mgdbObj);
+            continue;
+        }
+
+        gdbPkt->commandType = gdbPkt->pktData.buffer[0];
+        if (mgdbObj->opts.o_enableLogging)
+        {
+            MGDB_LOG_TRACE(MGDB_RECV " : packet = $%s#%s\n", gdbPkt->pktData.buffer,
+                           gdbPkt->checksum);
+        }
+        if (mgdbObj->traceRing)
+        {
+            minigdbstubTraceRecord(mgdbObj->traceRing, MGDB_TRACE_RECV, gdbPkt->pktData.buffer,
+                                   currentOffset);
+        }
+        minigdbstubSend MGDB_T(MGDB_ACK_PACKET, mgdbObj);
+        return;
+    }
+}
+
+// Bytes of the register file a layout covers - mgdbObj.regsSize for a layout
+static size_t minigdbstubRegLayoutSize(const mgdbRegLayout *layout)
+{
+    size_t size = 0;
+    for (size_t i = 0; i < layout->count; ++i)
+    {
+        size_t end = layout->regs[i].offset + (layout->regs[i].bitsize / 8);
+        size       = (end > size) ? end : size;
+    }
+    return size;
+}
+
+// Locate register 'index' in mgdbObj->regs - returns 0 if there is no such register
+static int minigdbstubRegLocate(mgdbProcObj *mgdbObj, size_t index, size_t *offset, size_t *bytes,
+                                int *swap)
+{
+    const mgdbRegLayout *layout = mgdbObj->regLayout;
+    if (layout)
+    {
+        if (index >= layout->count)
+        {
+            return 0;
+        }
+        *offset = layout->regs[index].offset;
+        *bytes  = layout->regs[index].bitsize / 8;
+        *swap   = (layout->regs[index].byteOrder != MGDB_REG_HOST_ORDER);
+        return 1;
+    }
+    if (index >= mgdbObj->regsCount)
+    {
+        return 0;
+    }
+    *bytes  = mgdbObj->regsSize / mgdbObj->regsCount;
+    *offset = index * *bytes;
+    *swap   = 0;
+    return 1;
+}
+
+// Fetch register 'index' into mgdbObj->regs unless it's already cached for this stop
+MGDB_TPL static void minigdbstubRegFetch(mgdbProcObj *mgdbObj, size_t index)
+{
+    mgdbRegCache *cache = mgdbObj->regCache;
+    size_t offset, bytes;
+    int swap;
+    if (!cache || (index >= cache->count) || (cache->state[index] & MGDB_REG_CACHED) ||
+        !minigdbstubRegLocate(mgdbObj, index, &offset, &bytes, &swap))
+    {
+        return;
+    }
+#if defined(__cplusplus) || defined(MGDB_USR_REG_CALLBACKS)
+    MGDB_USR_CALL(ReadReg)(index, &mgdbObj->regs[offset], mgdbObj->usrData);
+#endif
+    cache->state[index] |= MGDB_REG_CACHED;
+    ++cache->fetches;
+}
+
+MGDB_TPL static void minigdbstubRegFetchAll(mgdbProcObj *mgdbObj)
+{
+    for (size_t i = 0; mgdbObj->regCache && (i < mgdbObj->regCache->count); ++i)
+    {
+        minigdbstubRegFetch MGDB_T(mgdbObj, i);
+    }
+}
+
+// GDB wrote register 'index' in mgdbObj->regs
+static void minigdbstubRegMarkDirty(mgdbProcObj *mgdbObj, size_t index)
+{
+    mgdbRegCache *cache = mgdbObj->regCache;
+    if (cache && (index < cache->count))
+    {
+        cache->state[index] |= MGDB_REG_CACHED | MGDB_REG_DIRTY;
+    }
+}
+
+// Write dirty registers back to the target and forget the cached ones - called before the target
+// resumes. Call it too if the target runs on after a stop the stub has looked at (e.g. a
+// breakpoint condition that didn't hold)
+MGDB_TPL static void minigdbstubRegCacheFlush(mgdbProcObj *mgdbObj)
+{
+    mgdbRegCache *cache = mgdbObj->regCache;
+    for (size_t i = 0; cache && (i < cache->count); ++i)
+    {
+        size_t offset, bytes;
+        int swap;
+        if ((cache->state[i] & MGDB_REG_DIRTY) &&
+            minigdbstubRegLocate(mgdbObj, i, &offset, &bytes, &swap))
+        {
+#if defined(__cplusplus) || defined(MGDB_USR_REG_CALLBACKS)
+            MGDB_USR_CALL(WriteReg)(i, &mgdbObj->regs[offset], mgdbObj->usrData);
+#endif
+            ++cache->writebacks;
+        }
+        cache->state[i] = 0;
+    }
+}
+
+// Write all registers - recvPkt holds the hex register data (without the 'G')
+MGDB_TPL static void minigdbstubWriteRegs(mgdbProcObj *mgdbObj, gdbPacket *recvPkt)
+{
+    const mgdbRegLayout *layout = mgdbObj->regLayout;
+    const char *hex             = recvPkt->pktData.buffer;
+    if (layout)
+    {
+        for (size_t i = 0; i < layout->count; ++i)
+        {
+            const mgdbRegDesc *desc = &layout->regs[i];
+            size_t bytes            = desc->bitsize / 8;
+            int swap                = (desc->byteOrder != MGDB_REG_HOST_ORDER);
+
+            // GDB may send fewer registers than described
+            if (minigdbstubDecodeRegBytes(&mgdbObj->regs[desc->offset], hex, bytes, swap) != bytes)
+            {
+                break;
+            }
+            minigdbstubRegMarkDirty(mgdbObj, i);
+            hex += bytes * 2;
+        }
+    }
+    else
+    {
+        size_t decoded = minigdbstubDecodeRegBytes(mgdbObj->regs, hex, mgdbObj->regsSize, 0);
+        for (size_t i = 0; mgdbObj->regCache && (i < mgdbObj->regsCount); ++i)
+        {
+            if ((i + 1) * (mgdbObj->regsSize / mgdbObj->regsCount) <= decoded)
+            {
+                minigdbstubRegMarkDirty(mgdbObj, i);
+            }
+        }
+    }
+    minigdbstubSend MGDB_T(MGDB_OK_PACKET, mgdbObj);
+}
+
+MGDB_TPL static void minigdbstubWriteReg(mgdbProcObj *mgdbObj, gdbPacket *recvPkt)
+{
+    size_t index, offset, bytes;
+    int swap;
+    const char *val = strchr(recvPkt->pktData.buffer, '=');
+    MGDB_HEX_DECODE_ASCII(&recvPkt->pktData.buffer[1], index);
+    if ((val == NULL) || !minigdbstubRegLocate(mgdbObj, index, &offset, &bytes, &swap))
+    {
+        minigdbstubSend MGDB_T(MGDB_ERROR_PACKET, mgdbObj);
+        return;
+    }
+    if (strlen(val + 1) < bytes * 2)
+    {
+        minigdbstubRegFetch MGDB_T(mgdbObj, index);  // A short value only replaces some bytes
+    }
+    if (minigdbstubDecodeRegBytes(&mgdbObj->regs[offset], val + 1, bytes, swap) == 0)
+    {
+        minigdbstubSend MGDB_T(MGDB_ERROR_PACKET, mgdbObj);
+        return;
+    }
+    minigdbstubRegMarkDirty(mgdbObj, index);
+    minigdbstubSend MGDB_T(MGDB_OK_PACKET, mgdbObj);
+}
+
+MGDB_TPL static void minigdbstubSendRegs(mgdbProcObj *mgdbObj)
+{
+    const mgdbRegLayout *layout = mgdbObj->regLayout;
+    DynCharBuffer sendPkt       = {0};
+    MGDB_CHECK_RET(initDynCharBuffer(&sendPkt, 512), mgdbObj);
+    MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, '$'), mgdbObj);
+    minigdbstubRegFetchAll MGDB_T(mgdbObj);
+
+    if (layout)
+    {
+        for (size_t i = 0; i < layout->count;)
+        {
+            // Registers that follow each other in host byte order go out as one block
+            const mgdbRegDesc *desc = &layout->regs[i];
+            size_t bytes            = desc->bitsize / 8;
+            int swap                = (desc->byteOrder != MGDB_REG_HOST_ORDER);
+            for (++i; !swap && (i < layout->count) &&
+                      (layout->regs[i].offset == desc->offset + bytes) &&
+                      (layout->regs[i].byteOrder == MGDB_REG_HOST_ORDER);
+                 ++i)
+            {
+                bytes += layout->regs[i].bitsize / 8;
+            }
+            MGDB_CHECK_RET(reserveDynCharBuffer(&sendPkt, bytes * 2), mgdbObj);
+            minigdbstubEncodeRegBytes(&sendPkt.buffer[sendPkt.used], &mgdbObj->regs[desc->offset],
+                                      bytes, swap);
+            sendPkt.used += bytes * 2;
+        }
+    }
+    else
+    {
+        // Uniform registers in host byte order - the register file goes out as-is
+        MGDB_CHECK_RET(reserveDynCharBuffer(&sendPkt, mgdbObj->regsSize * 2), mgdbObj);
+        minigdbstubEncodeRegBytes(&sendPkt.buffer[sendPkt.used], mgdbObj->regs, mgdbObj->regsSize,
+                                  0);
+        sendPkt.used += mgdbObj->regsSize * 2;
+    }
+
+    minigdbstubSendPkt MGDB_T(&sendPkt, mgdbObj);
+    freeDynCharBuffer(&sendPkt);
+}
+
+MGDB_TPL static void minigdbstubSendReg(mgdbProcObj *mgdbObj, gdbPacket *recvPkt)
+{
+    size_t index, offset, bytes;
+    int swap;
+    MGDB_HEX_DECODE_ASCII(&recvPkt->pktData.buffer[1], index);
+    if (!minigdbstubRegLocate(mgdbObj, index, &offset, &bytes, &swap))
+    {
+        minigdbstubSend MGDB_T(MGDB_ERROR_PACKET, mgdbObj);
+        return;
+    }
+
+    DynCharBuffer sendPkt = {0};
+    minigdbstubRegFetch MGDB_T(mgdbObj, index);
+    MGDB_CHECK_RET(initDynCharBuffer(&sendPkt, (bytes * 2) + 8), mgdbObj);
+    MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, '$'), mgdbObj);
+    minigdbstubEncodeRegBytes(&sendPkt.buffer[sendPkt.used], &mgdbObj->regs[offset], bytes, swap);
+    sendPkt.used += bytes * 2;
+
+    minigdbstubSendPkt MGDB_T(&sendPkt, mgdbObj);
+    freeDynCharBuffer(&sendPkt);
+}
+
+// Bytes of [addr, addr + len) that lie in the memory map (writable ones if write is set), counting
+// from addr - all of them without a map
+static size_t minigdbstubMemMapped(const mgdbMemMap *map, size_t addr, size_t len, int write)
+{
+    size_t done = 0;
+    while (map && (done < len))
+    {
+        const mgdbMemRegion *region = NULL;
+        for (size_t i = 0; (i < map->count) && !region; ++i)
+        {
+            const mgdbMemRegion *r = &map->regions[i];
+            if ((addr + done - r->start < r->length) && !(write && (r->type == MGDB_MEM_ROM)))
+            {
+                region = r;
+            }
+        }
+        if (region == NULL)
+        {
+            return done;
+        }
+        size_t left = region->length - (addr + done - region->start);
+        done += (left < len - done) ? left : len - done;
+    }
+    return len;
+}
+
+// Check an access against the memory map and the CheckMem hook - returns 0 or the error number to
+// reply with. Reads may be cut short to the mapped bytes (*len), writes have to fit entirely
+MGDB_TPL static int minigdbstubMemCheck(mgdbProcObj *mgdbObj, size_t addr, size_t *len, int write)
+{
+    size_t mapped = minigdbstubMemMapped(mgdbObj->memMap, addr, *len, write);
+    if ((mapped == 0 && *len > 0) || (write && (mapped != *len)))
+    {
+        return MGDB_MEM_ERROR;
+    }
+    *len = mapped;
+#if defined(__cplusplus) || defined(MGDB_USR_MEM_CHECK)
+    return MGDB_USR_CALL(CheckMem)(addr, mapped, write, mgdbObj->usrData) & 0xff;
+#else
+    return 0;
+#endif
+}
+
+MGDB_TPL static void minigdbstubSendError(mgdbProcObj *mgdbObj, int err)
+{
+    char reply[4];
+    int len = snprintf(reply, sizeof(reply), "E%02x", err);
+    minigdbstubSendPayload MGDB_T(reply, len, mgdbObj);
+}
+
+MGDB_TPL static void minigdbstubWriteMem(mgdbProcObj *mgdbObj, gdbPacket *recvPkt)
+{
+    size_t address, length;
+    int lengthOffset = 0;
+    int valOffset    = 0;
+
+    // Grab the length offset
+    for (int i = 0; recvPkt->pktData.buffer[i] != 0; ++i)
+    {
+        if ((recvPkt->pktData.buffer[i] == ',') || (recvPkt->pktData.buffer[i] == ';') ||
+            (recvPkt->pktData.buffer[i] == ':'))
+        {
+            recvPkt->pktData.buffer[i] = 0;
+            ++lengthOffset;
+            valOffset = lengthOffset;
+            break;
+        }
+        ++lengthOffset;
+    }
+    // Grab the data value offset
+    for (int i = lengthOffset; recvPkt->pktData.buffer[i] != 0; ++i)
+    {
+        if ((recvPkt->pktData.buffer[i] == ',') || (recvPkt->pktData.buffer[i] == ';') ||
+            (recvPkt->pktData.buffer[i] == ':'))
+        {
+            recvPkt->pktData.buffer[i] = 0;
+            ++valOffset;
+            break;
+        }
+        ++valOffset;
+    }
+    MGDB_HEX_DECODE_ASCII(&recvPkt->pktData.buffer[1], address);
+    MGDB_HEX_DECODE_ASCII(&recvPkt->pktData.buffer[lengthOffset], length);
+    int err = minigdbstubMemCheck MGDB_T(mgdbObj, address, &length, 1);
+    if (err)
+    {
+        minigdbstubSendError MGDB_T(mgdbObj, err);
+        return;
+    }
+
+    // Call user write memory handler
+    for (size_t i = 0; i < length; ++i)
+    {
+        int decodedVal;
+        char atoiBuf[8];
+        atoiBuf[0] = recvPkt->pktData.buffer[valOffset + (i * 2)];
+        atoiBuf[1] = recvPkt->pktData.buffer[valOffset + (i * 2) + 1];
+        atoiBuf[2] = 0;
+        MGDB_HEX_DECODE_ASCII(atoiBuf, decodedVal);
+        MGDB_USR_CALL(WriteMem)(address + i, (unsigned char)decodedVal, mgdbObj->usrData);
+    }
+
+    minigdbstubSend MGDB_T(MGDB_OK_PACKET, mgdbObj);
+}
+
+MGDB_TPL static void minigdbstubReadMem(mgdbProcObj *mgdbObj, gdbPacket *recvPkt)
+{
+    size_t address, length;
+    int valOffset = 0;
+    for (int i = 0; recvPkt->pktData.buffer[i] != 0; ++i)
+    {
+        if ((recvPkt->pktData.buffer[i] == ',') || (recvPkt->pktData.buffer[i] == ';') ||
+            (recvPkt->pktData.buffer[i] == ':'))
+        {
+            recvPkt->pktData.buffer[i] = 0;
+            ++valOffset;
+            break;
+        }
+        ++valOffset;
+    }
+    MGDB_HEX_DECODE_ASCII(&recvPkt->pktData.buffer[1], address);
+    MGDB_HEX_DECODE_ASCII(&recvPkt->pktData.buffer[valOffset], length);
+    int err = minigdbstubMemCheck MGDB_T(mgdbObj, address, &length, 0);
+    if (err)
+    {
+        minigdbstubSendError MGDB_T(mgdbObj, err);
+        return;
+    }
+
+    // Alloc a packet w/ the requested data to send as a response to GDB
+    DynCharBuffer memBuf = {0};
+    MGDB_CHECK_RET(initDynCharBuffer(&memBuf, length), mgdbObj);
+    MGDB_CHECK_RET(insertDynCharBuffer(&memBuf, '$'), mgdbObj);
+
+    // Call user read memory handler
+    for (size_t i = 0; i < length; ++i)
+    {
+        char itoaBuff[8];
+        unsigned char c = MGDB_USR_CALL(ReadMem)(address + i, mgdbObj->usrData);
+        MGDB_HEX_ENCODE_ASCII(c, 3, itoaBuff);
+
+        // Swap if single digit
+        if (itoaBuff[1] == 0)
+        {
+            itoaBuff[1] = itoaBuff[0];
+            itoaBuff[0] = '0';
+        }
+
+        MGDB_CHECK_RET(insertDynCharBuffer(&memBuf, itoaBuff[0]), mgdbObj);
+        MGDB_CHECK_RET(insertDynCharBuffer(&memBuf, itoaBuff[1]), mgdbObj);
+    }
+
+    // Compute and append the checksum
+    char checksum[8];
+    size_t len = memBuf.used - 1;
+    minigdbstubComputeChecksum(&memBuf.buffer[1], len, checksum);
+    MGDB_CHECK_RET(insertDynCharBuffer(&memBuf, '#'), mgdbObj);
+    MGDB_CHECK_RET(insertDynCharBuffer(&memBuf, checksum[0]), mgdbObj);
+    MGDB_CHECK_RET(insertDynCharBuffer(&memBuf, checksum[1]), mgdbObj);
+    MGDB_CHECK_RET(insertDynCharBuffer(&memBuf, 0), mgdbObj);
+
+    minigdbstubSend MGDB_T((const char *)memBuf.buffer, mgdbObj);
+    freeDynCharBuffer(&memBuf);
+}
+
+// Thread stop reply "T<signal>thread:<id>;" - sent as a "%Stop:" notification if notify is set
+MGDB_TPL static void minigdbstubSendThreadStop(mgdbProcObj *mgdbObj, const mgdbThread *thread,
+                                               int notify)
+{
+    char reply[64];
+    int len = snprintf(reply, sizeof(reply), "%cT%02xthread:%zx;", notify ? '%' : '$',
+                       thread->signalNum & 0xff, thread->id);
+    DynCharBuffer sendPkt = {0};
+    MGDB_CHECK_RET(initDynCharBuffer(&sendPkt, len + 8), mgdbObj);
+    if (notify)
+    {
+        // "%Stop:" - the checksum covers everything after the '%'
+        MGDB_CHECK_RET(appendDynCharBuffer(&sendPkt, "%Stop:", 6), mgdbObj);
+        MGDB_CHECK_RET(appendDynCharBuffer(&sendPkt, &reply[1], len - 1), mgdbObj);
+    }
+    else
+    {
+        MGDB_CHECK_RET(appendDynCharBuffer(&sendPkt, reply, len), mgdbObj);
+    }
+    minigdbstubSendPkt MGDB_T(&sendPkt, mgdbObj);
+    freeDynCharBuffer(&sendPkt);
+}
+
+// Make thread 'index' the one register packets (and the next stop reply) refer to
+MGDB_TPL static void minigdbstubThreadSelect(mgdbProcObj *mgdbObj, size_t index)
+{
+    mgdbThread *thread = &mgdbObj->threads->threads[index];
+    if (index != mgdbObj->threads->current)
+    {
+        minigdbstubRegCacheFlush MGDB_T(mgdbObj);  // Cached registers belong to the old thread
+    }
+    mgdbObj->threads->current = index;
+    if (thread->regs)
+    {
+        mgdbObj->regs = thread->regs;
+    }
+}
+
+// Oldest stop GDB hasn't acknowledged yet
+static mgdbThread *minigdbstubThreadPendingStop(mgdbThreadTable *table)
+{
+    mgdbThread *oldest = NULL;
+    for (size_t i = 0; i < table->count; ++i)
+    {
+        mgdbThread *thread = &table->threads[i];
+        if (thread->pendingStop && (!oldest || (thread->stopSeq < oldest->stopSeq)))
+        {
+            oldest = thread;
+        }
+    }
+    return oldest;
+}
+
+// Call when a thread stops (breakpoint, end of a step, interrupted by vCont;t) with its registers
+// up to date. In non-stop mode GDB is notified right away with a %Stop notification (or once it has
+// drained the earlier ones with vStopped). In all-stop mode the whole target is stopped and the
+// thread is the one minigdbstubProcess reports on entry
+MGDB_TPL static void minigdbstubThreadStopped(mgdbProcObj *mgdbObj, size_t threadId, int signalNum)
+{
+    mgdbThreadTable *table = mgdbObj->threads;
+    mgdbThread *thread     = minigdbstubThreadFind(table, threadId);
+    if (thread == NULL)
+    {
+        return;
+    }
+    thread->running   = 0;
+    thread->signalNum = signalNum;
+    if (!table->nonStop)
+    {
+        for (size_t i = 0; i < table->count; ++i)
+        {
+            table->threads[i].running = 0;
+        }
+        minigdbstubThreadSelect MGDB_T(mgdbObj, (size_t)(thread - table->threads));
+        mgdbObj->signalNum = signalNum;
+        return;
+    }
+    thread->pendingStop = 1;
+    thread->stopSeq     = table->nextSeq++;
+    if (!table->notified)
+    {
+        table->notified = 1;
+        minigdbstubSendThreadStop MGDB_T(mgdbObj, thread, 1);
+        minigdbstubFlush MGDB_T(mgdbObj);
+    }
+}
+
+MGDB_TPL static void minigdbstubSendSignal(mgdbProcObj *mgdbObj)
+{
+    if (mgdbObj->threads)
+    {
+        // Thread-aware stop reply for the current thread
+        mgdbThread *thread = &mgdbObj->threads->threads[mgdbObj->threads->current];
+        thread->signalNum  = mgdbObj->signalNum;
+        minigdbstubSendThreadStop MGDB_T(mgdbObj, thread, 0);
+        return;
+    }
+    if (mgdbObj->snapshots && mgdbObj->snapshots->atBegin)
+    {
+        // Reverse execution ran out of recorded history
+        char reply[32];
+        int len =
+            snprintf(reply, sizeof(reply), "T%02xreplaylog:begin;", mgdbObj->signalNum & 0xff);
+        minigdbstubSendPayload MGDB_T(reply, len, mgdbObj);
+        return;
+    }
+    DynCharBuffer sendPkt = {0};
     MGDB_CHECK_RET(initDynCharBuffer(&sendPkt, 32), mgdbObj);
     MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, '$'), mgdbObj);
-    MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, 'S'), mgdbObj);
+    MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, 'S'), mgdbObj);
+
+    // Convert signal num to hex char array
+    char itoaBuff[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    MGDB_DEC_ENCODE_ASCII(mgdbObj->signalNum, 8, itoaBuff);
+
+    // Swap if single digit
+    if (itoaBuff[1] == 0)
+    {
+        itoaBuff[1] = itoaBuff[0];
+        itoaBuff[0] = '0';
+    }
+
+    int bufferPtr = 0;
+    while (itoaBuff[bufferPtr] != 0)
+    {
+        MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, itoaBuff[bufferPtr]), mgdbObj);
+        ++bufferPtr;
+    }
+    MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, '#'), mgdbObj);
+
+    // Add the two checksum hex chars
+    char checksumHex[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    minigdbstubComputeChecksum(&sendPkt.buffer[1], bufferPtr + 1, checksumHex);
+    MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, checksumHex[0]), mgdbObj);
+    MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, checksumHex[1]), mgdbObj);
+    MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, 0), mgdbObj);
+
+    minigdbstubSend MGDB_T((const char *)sendPkt.buffer, mgdbObj);
+    freeDynCharBuffer(&sendPkt);
+}
+
+// Agent expression opcodes (GDB "Agent Expressions" appendix) - the subset the stub evaluates
+enum
+{
+    MGDB_AX_ADD           = 0x02,
+    MGDB_AX_SUB           = 0x03,
+    MGDB_AX_MUL           = 0x04,
+    MGDB_AX_DIV_SIGNED    = 0x05,
+    MGDB_AX_DIV_UNSIGNED  = 0x06,
+    MGDB_AX_REM_SIGNED    = 0x07,
+    MGDB_AX_REM_UNSIGNED  = 0x08,
+    MGDB_AX_LSH           = 0x09,
+    MGDB_AX_RSH_SIGNED    = 0x0a,
+    MGDB_AX_RSH_UNSIGNED  = 0x0b,
+    MGDB_AX_TRACE         = 0x0c,
+    MGDB_AX_TRACE_QUICK   = 0x0d,
+    MGDB_AX_LOG_NOT       = 0x0e,
+    MGDB_AX_BIT_AND       = 0x0f,
+    MGDB_AX_BIT_OR        = 0x10,
+    MGDB_AX_BIT_XOR       = 0x11,
+    MGDB_AX_BIT_NOT       = 0x12,
+    MGDB_AX_EQUAL         = 0x13,
+    MGDB_AX_LESS_SIGNED   = 0x14,
+    MGDB_AX_LESS_UNSIGNED = 0x15,
+    MGDB_AX_EXT           = 0x16,
+    MGDB_AX_REF8          = 0x17,
+    MGDB_AX_REF16         = 0x18,
+    MGDB_AX_REF32         = 0x19,
+    MGDB_AX_REF64         = 0x1a,
+    MGDB_AX_IF_GOTO       = 0x20,
+    MGDB_AX_GOTO          = 0x21,
+    MGDB_AX_CONST8        = 0x22,
+    MGDB_AX_CONST16       = 0x23,
+    MGDB_AX_CONST32       = 0x24,
+    MGDB_AX_CONST64       = 0x25,
+    MGDB_AX_REG           = 0x26,
+    MGDB_AX_END           = 0x27,
+    MGDB_AX_DUP           = 0x28,
+    MGDB_AX_POP           = 0x29,
+    MGDB_AX_ZERO_EXT      = 0x2a,
+    MGDB_AX_SWAP          = 0x2b,
+    MGDB_AX_TRACENZ       = 0x2f,
+    MGDB_AX_TRACE16       = 0x30,
+    MGDB_AX_PICK          = 0x32,
+    MGDB_AX_ROT           = 0x33
+};
+
+#ifndef MGDB_AX_STACK_SIZE
+#    define MGDB_AX_STACK_SIZE 32
+#endif
+#ifndef MGDB_AX_MAX_STEPS
+#    define MGDB_AX_MAX_STEPS 4096  // Bound on executed instructions - expressions can loop
+#endif
+
+// Read a register's value (up to 64 bits) from mgdbObj->regs
+MGDB_TPL static int minigdbstubRegValue(mgdbProcObj *mgdbObj, size_t index,
+                                        unsigned long long *value)
+{
+    size_t offset, bytes;
+    int swap;
+    if (!minigdbstubRegLocate(mgdbObj, index, &offset, &bytes, &swap) || (bytes > 8))
+    {
+        return MGDB_BAD_FORMAT;
+    }
+    minigdbstubRegFetch MGDB_T(mgdbObj, index);
+    *value = 0;
+    memcpy((char *)value + ((MGDB_REG_HOST_ORDER == MGDB_REG_BIG_ENDIAN) ? 8 - bytes : 0),
+           &mgdbObj->regs[offset], bytes);
+    return MGDB_SUCCESS;
+}
+
+// Read a little-endian (big-endian with MGDB_TARGET_BIG_ENDIAN) value from target memory
+MGDB_TPL static unsigned long long minigdbstubReadMemValue(mgdbProcObj *mgdbObj, size_t addr,
+                                                          size_t bytes)
+{
+    unsigned long long value = 0;
+    for (size_t i = 0; i < bytes; ++i)
+    {
+        unsigned long long c = MGDB_USR_CALL(ReadMem)(addr + i, mgdbObj->usrData);
+#ifdef MGDB_TARGET_BIG_ENDIAN
+        value = (value << 8) | c;
+#else
+        value |= c << (i * 8);
+#endif
+    }
+    return value;
+}
+
+// Bytes spanned by the register file - a layout is measured once, not on every tracepoint hit or
+// snapshot checkpoint
+static size_t minigdbstubRegFileSize(mgdbProcObj *mgdbObj)
+{
+    if (!mgdbObj->regLayout)
+    {
+        return mgdbObj->regsSize;
+    }
+    if (mgdbObj->sizedLayout != mgdbObj->regLayout)
+    {
+        mgdbObj->regLayoutSize = minigdbstubRegLayoutSize(mgdbObj->regLayout);
+        mgdbObj->sizedLayout   = mgdbObj->regLayout;
+    }
+    return mgdbObj->regLayoutSize;
+}
+
+// Record len bytes of target memory at addr in the open trace frame
+MGDB_TPL static void minigdbstubTraceCollectMem(mgdbProcObj *mgdbObj, size_t addr, size_t len)
+{
+    mgdbTracepoints *tp = mgdbObj->tracepoints;
+    if (minigdbstubMemCheck MGDB_T(mgdbObj, addr, &len, 0) || (len == 0))
+    {
+        return;  // Nothing readable there
+    }
+    mgdbTraceBlock block = {'M', addr, len};
+    if (!minigdbstubTraceReserve(tp, sizeof(block) + len))
+    {
+        return;
+    }
+    minigdbstubTraceAppend(tp, &block, sizeof(block));
+    for (size_t i = 0; i < len; ++i)
+    {
+        unsigned char c = MGDB_USR_CALL(ReadMem)(addr + i, mgdbObj->usrData);
+        minigdbstubTraceAppend(tp, &c, 1);
+    }
+}
+
+// Evaluate agent expression bytecode against mgdbObj->regs and target memory - the value left on
+// top of the stack by 'end' goes to *result
+MGDB_TPL static int minigdbstubAxEval(mgdbProcObj *mgdbObj, const unsigned char *code, size_t len,
+                                      long long *result)
+{
+    long long stack[MGDB_AX_STACK_SIZE];
+    unsigned long long a, b;
+    size_t sp = 0, pc = 0;
+
+// Require n values on the stack / n immediate bytes after the opcode
+#define MGDB_AX_NEED(n)         \
+    if (sp < (n))               \
+    {                           \
+        return MGDB_BAD_FORMAT; \
+    }
+#define MGDB_AX_IMM(n, out)              \
+    if (pc + (n) > len)                  \
+    {                                    \
+        return MGDB_BAD_FORMAT;          \
+    }                                    \
+    out = 0;                             \
+    for (size_t i = 0; i < (n); ++i)     \
+    {                                    \
+        out = (out << 8) | code[pc++];   \
+    }
+// Division by zero is an error, as in GDB's own evaluator
+#define MGDB_AX_DIVISOR()       \
+    MGDB_AX_NEED(2);            \
+    if (stack[sp - 1] == 0)     \
+    {                           \
+        return MGDB_BAD_FORMAT; \
+    }
+#define MGDB_AX_BINOP(expr)                            \
+    MGDB_AX_NEED(2);                                   \
+    a             = (unsigned long long)stack[sp - 2]; \
+    b             = (unsigned long long)stack[sp - 1]; \
+    stack[sp - 2] = (long long)(expr);                 \
+    --sp;                                              \
+    break;
+
+    for (int steps = 0; steps < MGDB_AX_MAX_STEPS; ++steps)
+    {
+        if (pc >= len)
+        {
+            return MGDB_BAD_FORMAT;
+        }
+        if (sp >= MGDB_AX_STACK_SIZE - 1)
+        {
+            return MGDB_BAD_FORMAT;
+        }
+        switch (code[pc++])
+        {
+            case MGDB_AX_ADD:
+                MGDB_AX_BINOP(a + b)
+            case MGDB_AX_SUB:
+                MGDB_AX_BINOP(a - b)
+            case MGDB_AX_MUL:
+                MGDB_AX_BINOP(a * b)
+            case MGDB_AX_DIV_SIGNED:
+                // Dividing the most negative value by -1 overflows (and traps on x86) - negate
+                // unsigned instead, wrapping like GDB does
+                MGDB_AX_DIVISOR();
+                MGDB_AX_BINOP((b == ~0ULL) ? 0 - a : (long long)a / (long long)b)
+            case MGDB_AX_DIV_UNSIGNED:
+                MGDB_AX_DIVISOR();
+                MGDB_AX_BINOP(a / b)
+            case MGDB_AX_REM_SIGNED:
+                MGDB_AX_DIVISOR();
+                MGDB_AX_BINOP((b == ~0ULL) ? 0 : (long long)a % (long long)b)
+            case MGDB_AX_REM_UNSIGNED:
+                MGDB_AX_DIVISOR();
+                MGDB_AX_BINOP(a % b)
+            case MGDB_AX_LSH:
+                MGDB_AX_BINOP((b < 64) ? a << b : 0)
+            case MGDB_AX_RSH_SIGNED:
+                MGDB_AX_BINOP((long long)a >> ((b < 64) ? b : 63))
+            case MGDB_AX_RSH_UNSIGNED:
+                MGDB_AX_BINOP((b < 64) ? a >> b : 0)
+            case MGDB_AX_BIT_AND:
+                MGDB_AX_BINOP(a & b)
+            case MGDB_AX_BIT_OR:
+                MGDB_AX_BINOP(a | b)
+            case MGDB_AX_BIT_XOR:
+                MGDB_AX_BINOP(a ^ b)
+            case MGDB_AX_EQUAL:
+                MGDB_AX_BINOP(a == b)
+            case MGDB_AX_LESS_SIGNED:
+                MGDB_AX_BINOP((long long)a < (long long)b)
+            case MGDB_AX_LESS_UNSIGNED:
+                MGDB_AX_BINOP(a < b)
+            case MGDB_AX_LOG_NOT:
+                MGDB_AX_NEED(1);
+                stack[sp - 1] = !stack[sp - 1];
+                break;
+            case MGDB_AX_BIT_NOT:
+                MGDB_AX_NEED(1);
+                stack[sp - 1] = ~stack[sp - 1];
+                break;
+            case MGDB_AX_EXT:
+            case MGDB_AX_ZERO_EXT:
+            {
+                unsigned char op = code[pc - 1];
+                MGDB_AX_NEED(1);
+                MGDB_AX_IMM(1, a);
+                if ((a > 0) && (a < 64))
+                {
+                    b             = (unsigned long long)stack[sp - 1] << (64 - a);
+                    stack[sp - 1] = (op == MGDB_AX_EXT) ? (long long)b >> (64 - a)
+                                                        : (long long)(b >> (64 - a));
+                }
+                break;
+            }
+            case MGDB_AX_REF8:
+            case MGDB_AX_REF16:
+            case MGDB_AX_REF32:
+            case MGDB_AX_REF64:
+            {
+                size_t bytes = (size_t)1 << (code[pc - 1] - MGDB_AX_REF8);
+                size_t valid = bytes;
+                MGDB_AX_NEED(1);
+                if (minigdbstubMemCheck MGDB_T(mgdbObj, (size_t)stack[sp - 1], &valid, 0) ||
+                    (valid != bytes))
+                {
+                    return MGDB_BAD_FORMAT;
+                }
+                stack[sp - 1] = (long long)minigdbstubReadMemValue MGDB_T(
+                    mgdbObj, (size_t)stack[sp - 1], bytes);
+                break;
+            }
+            case MGDB_AX_IF_GOTO:
+                MGDB_AX_NEED(1);
+                MGDB_AX_IMM(2, a);
+                pc = stack[--sp] ? (size_t)a : pc;
+                break;
+            case MGDB_AX_GOTO:
+                MGDB_AX_IMM(2, a);
+                pc = (size_t)a;
+                break;
+            case MGDB_AX_CONST8:
+            case MGDB_AX_CONST16:
+            case MGDB_AX_CONST32:
+            case MGDB_AX_CONST64:
+            {
+                // Immediates are big-endian and zero-extended
+                size_t bytes = (size_t)1 << (code[pc - 1] - MGDB_AX_CONST8);
+                MGDB_AX_IMM(bytes, a);
+                stack[sp++] = (long long)a;
+                break;
+            }
+            case MGDB_AX_REG:
+                MGDB_AX_IMM(2, a);
+                if (minigdbstubRegValue MGDB_T(mgdbObj, (size_t)a, &b) != MGDB_SUCCESS)
+                {
+                    return MGDB_BAD_FORMAT;
+                }
+                stack[sp++] = (long long)b;
+                break;
+            case MGDB_AX_END:
+                MGDB_AX_NEED(1);
+                *result = stack[sp - 1];
+                return MGDB_SUCCESS;
+            case MGDB_AX_DUP:
+                MGDB_AX_NEED(1);
+                stack[sp] = stack[sp - 1];
+                ++sp;
+                break;
+            case MGDB_AX_POP:
+                MGDB_AX_NEED(1);
+                --sp;
+                break;
+            case MGDB_AX_SWAP:
+                MGDB_AX_NEED(2);
+                a             = (unsigned long long)stack[sp - 1];
+                stack[sp - 1] = stack[sp - 2];
+                stack[sp - 2] = (long long)a;
+                break;
+            case MGDB_AX_TRACE:
+            case MGDB_AX_TRACENZ:
+            {
+                // addr size => (only while collecting a trace frame)
+                unsigned char op = code[pc - 1];
+                MGDB_AX_NEED(2);
+                if (!mgdbObj->tracepoints || !mgdbObj->tracepoints->collecting)
+                {
+                    return MGDB_BAD_FORMAT;
+                }
+                a = (unsigned long long)stack[sp - 2];
+                b = (unsigned long long)stack[sp - 1];
+                sp -= 2;
+                if (op == MGDB_AX_TRACENZ)
+                {
+                    // Up to and including the first zero byte, never past readable memory
+                    size_t n = 0, valid = (size_t)b;
+                    if (minigdbstubMemCheck MGDB_T(mgdbObj, (size_t)a, &valid, 0))
+                    {
+                        valid = 0;
+                    }
+                    while ((n < valid) &&
+                           (MGDB_USR_CALL(ReadMem)(a + n++, mgdbObj->usrData) != 0))
+                    {
+                    }
+                    b = n;
+                }
+                minigdbstubTraceCollectMem MGDB_T(mgdbObj, (size_t)a, (size_t)b);
+                break;
+            }
+            case MGDB_AX_TRACE_QUICK:
+            case MGDB_AX_TRACE16:
+            {
+                // addr => addr, size is an immediate
+                size_t bytes = (code[pc - 1] == MGDB_AX_TRACE_QUICK) ? 1 : 2;
+                MGDB_AX_NEED(1);
+                MGDB_AX_IMM(bytes, a);
+                if (!mgdbObj->tracepoints || !mgdbObj->tracepoints->collecting)
+                {
+                    return MGDB_BAD_FORMAT;
+                }
+                minigdbstubTraceCollectMem MGDB_T(mgdbObj, (size_t)stack[sp - 1], (size_t)a);
+                break;
+            }
+            case MGDB_AX_PICK:
+                MGDB_AX_IMM(1, a);
+                MGDB_AX_NEED(a + 1);
+                stack[sp] = stack[sp - 1 - a];
+                ++sp;
+                break;
+            case MGDB_AX_ROT:
+                MGDB_AX_NEED(3);
+                a             = (unsigned long long)stack[sp - 3];
+                stack[sp - 3] = stack[sp - 2];
+                stack[sp - 2] = stack[sp - 1];
+                stack[sp - 1] = (long long)a;
+                break;
+            default:  // Floating point and state variables are not supported here
+                return MGDB_BAD_FORMAT;
+        }
+    }
+#undef MGDB_AX_NEED
+#undef MGDB_AX_IMM
+#undef MGDB_AX_DIVISOR
+#undef MGDB_AX_BINOP
+    return MGDB_BAD_FORMAT;
+}
+
+// Plant (MGDB_SET_BREAKPOINT) or remove (MGDB_CLEAR_BREAKPOINT) the enabled tracepoints through the
+// breakpoint hook. They are flagged MGDB_TRACEPOINT on top of MGDB_SOFT_BREAKPOINT, so a target can
+// keep them apart from GDB's own breakpoints at the same address
+MGDB_TPL static void minigdbstubTracepointsPlant(mgdbProcObj *mgdbObj, int type)
+{
+    mgdbTracepoints *tp = mgdbObj->tracepoints;
+    for (size_t i = 0; i < tp->defCount; ++i)
+    {
+        if (tp->defs[i].enabled)
+        {
+            MGDB_USR_CALL(ProcessBreakpoint)(type | MGDB_SOFT_BREAKPOINT | MGDB_TRACEPOINT,
+                                             tp->defs[i].addr, mgdbObj->usrData);
+        }
+    }
+}
+
+// Collect a trace frame for each enabled tracepoint at addr whose condition holds - returns 1 if
+// addr has any enabled tracepoint
+MGDB_TPL static int minigdbstubTracepointCollect(mgdbProcObj *mgdbObj, size_t addr)
+{
+    mgdbTracepoints *tp = mgdbObj->tracepoints;
+    int found           = 0;
+    for (size_t i = 0; tp && (tp->status == MGDB_TP_RUNNING) && (i < tp->defCount); ++i)
+    {
+        mgdbTracepoint *def = &tp->defs[i];
+        long long result;
+        if (!def->enabled || (def->addr != addr))
+        {
+            continue;
+        }
+        found = 1;
+        if (def->condLen &&
+            ((minigdbstubAxEval MGDB_T(mgdbObj, def->bytecode, def->condLen, &result) !=
+              MGDB_SUCCESS) ||
+             (result == 0)))
+        {
+            continue;
+        }
+
+        // The header's size is filled in once everything is collected
+        mgdbTraceFrameHdr hdr = {0, addr, def->number};
+        tp->frameStart        = tp->head;
+        tp->collecting        = 1;
+        if (minigdbstubTraceReserve(tp, sizeof(hdr)))
+        {
+            minigdbstubTraceAppend(tp, &hdr, sizeof(hdr));
+        }
+        if (def->collectRegs)
+        {
+            size_t size          = minigdbstubRegFileSize(mgdbObj);
+            mgdbTraceBlock block = {'R', 0, size};
+            if (minigdbstubTraceReserve(tp, sizeof(block) + size))
+            {
+                minigdbstubRegFetchAll MGDB_T(mgdbObj);
+                minigdbstubTraceAppend(tp, &block, sizeof(block));
+                minigdbstubTraceAppend(tp, mgdbObj->regs, size);
+            }
+        }
+        for (size_t m = 0; m < def->memCount; ++m)
+        {
+            const mgdbTraceMemRange *range = &def->mem[m];
+            unsigned long long base        = 0;
+            if ((range->baseReg < 0) ||
+                (minigdbstubRegValue MGDB_T(mgdbObj, (size_t)range->baseReg, &base) ==
+                 MGDB_SUCCESS))
+            {
+                minigdbstubTraceCollectMem MGDB_T(mgdbObj, (size_t)base + range->offset,
+                                                  range->len);
+            }
+        }
+        const unsigned char *code = &def->bytecode[def->condLen];
+        for (size_t e = 0; e < def->exprCount; ++e)
+        {
+            minigdbstubAxEval MGDB_T(mgdbObj, code, def->exprLen[e], &result);
+            code += def->exprLen[e];
+        }
+        if (!tp->collecting)
+        {
+            continue;  // Bigger than the whole buffer
+        }
+        hdr.size = tp->head - tp->frameStart;
+        minigdbstubTraceCopy(tp, tp->frameStart, &hdr, sizeof(hdr), 1);
+        tp->collecting = 0;
+        ++tp->frameCount;
+        if ((++def->hits == def->passCount) && (def->passCount > 0))
+        {
+            tp->status = MGDB_TP_PASSCOUNT;
+            tp->stopTp = def->number;
+            minigdbstubTracepointsPlant MGDB_T(mgdbObj, MGDB_CLEAR_BREAKPOINT);
+        }
+    }
+    return found;
+}
+
+// 1 if any of bp's conditions holds or it has none
+MGDB_TPL static int minigdbstubBreakpointCondition(mgdbProcObj *mgdbObj, const mgdbBreakpoint *bp)
+{
+    const unsigned char *code = bp->bytecode;
+    int stop                  = (bp->condCount == 0);
+    for (size_t i = 0; (i < bp->condCount) && !stop; ++i)
+    {
+        long long result;
+        // A condition that can't be evaluated stops the target, like GDB would
+        stop = (minigdbstubAxEval MGDB_T(mgdbObj, code, bp->condLen[i], &result) != MGDB_SUCCESS) ||
+               (result != 0);
+        code += bp->condLen[i];
+    }
+    return stop;
+}
+
+// Call when the target reaches a breakpoint at addr (with mgdbObj->regs up to date, or a regCache)
+// - returns 1 if it should stop and report to GDB, 0 if it should carry on because no condition
+// holds. Trace frames are collected here too, and a location that only has tracepoints never stops
+MGDB_TPL static int minigdbstubBreakpointHit(mgdbProcObj *mgdbObj, size_t addr)
+{
+    mgdbBreakpointTable *table = mgdbObj->breakpoints;
+    mgdbBreakpoint *bp         = table ? minigdbstubBreakpointFind(table, addr) : NULL;
+    if (mgdbObj->snapshots && (mgdbObj->snapshots->mode != MGDB_SNAP_RECORDING))
+    {
+        return 0;  // Replaying recorded history - minigdbstubSnapshotStep decides where to stop
+    }
+    int stop = !minigdbstubTracepointCollect MGDB_T(mgdbObj, addr);
+    if (table)
+    {
+        stop |= (bp != NULL);
+    }
+    for (size_t i = 0; !table && !stop && (i < mgdbObj->tracepoints->defCount); ++i)
+    {
+        // No table to look in - GDB's own breakpoints are flagged on the tracepoints they share
+        const mgdbTracepoint *def = &mgdbObj->tracepoints->defs[i];
+        stop                      = (def->addr == addr) && def->breakpoint;
+    }
+    if (mgdbObj->detached)
+    {
+        stop = 0;  // No GDB to report to - the target runs on, tracepoints still collect
+    }
+    else if (bp && (bp->condCount > 0))
+    {
+        stop = minigdbstubBreakpointCondition MGDB_T(mgdbObj, bp);
+    }
+    if (table)
+    {
+        ++table->hits;
+        table->stops += stop;
+    }
+    if (!stop)
+    {
+        minigdbstubRegCacheFlush MGDB_T(mgdbObj);  // The target runs on - fetched values go stale
+    }
+    return stop;
+}
+
+// Record (or replace) a breakpoint and the conditions in its Z packet options
+// ("[;X len,bytecode]...[;cmds:...]") - returns MGDB_SUCCESS if it was stored
+static int minigdbstubBreakpointStore(mgdbBreakpointTable *table, size_t addr, int type,
+                                      const char *options)
+{
+    mgdbBreakpoint *bp = minigdbstubBreakpointFind(table, addr);
+    if (bp == NULL)
+    {
+        if (table->count == table->capacity)
+        {
+            return MGDB_ALLOC_FAILED;
+        }
+        bp = &table->entries[table->count++];
+    }
+    bp->addr       = addr;
+    bp->type       = type;
+    bp->condCount  = 0;
+    bp->generation = table->generation;
+
+    size_t used = 0;
+    while (options && *options)
+    {
+        options += (*options == ';');
+        options += (strncmp(options, "cond:", 5) == 0) ? 5 : 0;
+        if (*options != 'X')
+        {
+            // Unsupported option (e.g. cmds:) - skip it
+            options = strchr(options, ';');
+            continue;
+        }
+        char *end;
+        size_t len = strtoul(options + 1, &end, 16);
+        if ((*end != ',') || (bp->condCount == MGDB_BP_MAX_CONDS) ||
+            (used + len > MGDB_BP_COND_SIZE) ||
+            (minigdbstubDecodeRegBytes((char *)&bp->bytecode[used], end + 1, len, 0) != len))
+        {
+            bp->condCount = 0;
+            return MGDB_BAD_FORMAT;
+        }
+        bp->condLen[bp->condCount++] = (unsigned short)len;
+        used += len;
+        options = end + 1 + (len * 2);
+    }
+    return MGDB_SUCCESS;
+}
+
+static void minigdbstubBreakpointRemove(mgdbBreakpointTable *table, size_t addr)
+{
+    mgdbBreakpoint *bp = minigdbstubBreakpointFind(table, addr);
+    if (bp)
+    {
+        *bp = table->entries[--table->count];
+    }
+}
+
+MGDB_TPL static void minigdbstubProcessBreakpoint(mgdbProcObj *mgdbObj, gdbPacket *recvPkt,
+                                                  int type)
+{
+    // Z/z<type>,<addr>,<kind>[;options]
+    char *end;
+    const char *pkt = recvPkt->pktData.buffer;
+    size_t address  = strtoul(&pkt[3], &end, 16);
+    switch (pkt[1])
+    {
+        case '0':  // Software breakpoint
+            type |= MGDB_SOFT_BREAKPOINT;
+            break;
+        case '1':  // Hardware breakpoint
+            type |= MGDB_HARD_BREAKPOINT;
+            break;
+        default:  // Other breakpoint/watchpoint type (unsupported)
+            break;
+    }
+
+    mgdbBreakpointTable *table = mgdbObj->breakpoints;
+    int planted                = 0;
+    if (table && (type & (MGDB_SOFT_BREAKPOINT | MGDB_HARD_BREAKPOINT)))
+    {
+        mgdbBreakpoint *bp = minigdbstubBreakpointFind(table, address);
+        if (type & MGDB_CLEAR_BREAKPOINT)
+        {
+            minigdbstubBreakpointRemove(table, address);
+        }
+        else
+        {
+            // Already in the target (GDB updating conditions, or re-sending after a reconnect)
+            planted = bp && (bp->type == type);
+            if (minigdbstubBreakpointStore(table, address, type, strchr(end, ';')) != MGDB_SUCCESS)
+            {
+                minigdbstubSend MGDB_T(MGDB_ERROR_PACKET, mgdbObj);
+                return;
+            }
+        }
+    }
+    else if (mgdbObj->tracepoints && (type & (MGDB_SOFT_BREAKPOINT | MGDB_HARD_BREAKPOINT)))
+    {
+        // Nowhere else to remember it - minigdbstubBreakpointHit must still stop here
+        mgdbTracepoints *tp = mgdbObj->tracepoints;
+        for (size_t i = 0; i < tp->defCount; ++i)
+        {
+            if (tp->defs[i].addr == address)
+            {
+                tp->defs[i].breakpoint = !(type & MGDB_CLEAR_BREAKPOINT);
+            }
+        }
+    }
+    if (!planted)
+    {
+        MGDB_USR_CALL(ProcessBreakpoint)(type, address, mgdbObj->usrData);
+    }
+    minigdbstubSend MGDB_T(MGDB_OK_PACKET, mgdbObj);
+}
+
+// Remove the breakpoints left over from an earlier GDB session that this one didn't send again -
+// called whenever the target resumes
+MGDB_TPL static void minigdbstubBreakpointSweep(mgdbProcObj *mgdbObj)
+{
+    mgdbBreakpointTable *table = mgdbObj->breakpoints;
+    for (size_t i = 0; table && (i < table->count);)
+    {
+        mgdbBreakpoint *bp = &table->entries[i];
+        if (bp->generation == table->generation)
+        {
+            ++i;
+            continue;
+        }
+        int type = (bp->type & ~MGDB_SET_BREAKPOINT) | MGDB_CLEAR_BREAKPOINT;
+        MGDB_USR_CALL(ProcessBreakpoint)(type, bp->addr, mgdbObj->usrData);
+        *bp = table->entries[--table->count];
+    }
+}
+
+// Snapshot arena records
+static void minigdbstubSnapRead(mgdbSnapshots *snap, size_t pos, mgdbSnapRecord *rec)
+{
+    minigdbstubRingCopy(snap->arena, snap->arenaSize, pos, rec, sizeof(*rec), 0);
+}
+
+static void minigdbstubSnapAppend(mgdbSnapshots *snap, mgdbSnapRecord *rec, size_t dataLen)
+{
+    rec->size = sizeof(*rec) + dataLen;
+    rec->prev = snap->last;
+    minigdbstubRingCopy(snap->arena, snap->arenaSize, snap->head, rec, sizeof(*rec), 1);
+    snap->last = snap->head;
+    snap->head += rec->size;
+}
+
+// Forget which pages were saved since the newest checkpoint
+static void minigdbstubSnapClearPages(mgdbSnapshots *snap)
+{
+    mgdbSnapRecord rec;
+    size_t pos = snap->lastCheckpoint;
+    for (; snap->checkpoints && (pos != snap->head); pos += rec.size)
+    {
+        minigdbstubSnapRead(snap, pos, &rec);
+        if (rec.type == 'P')
+        {
+            size_t page = rec.addr >> MGDB_SNAP_PAGE_SHIFT;
+            snap->pageBits[page >> 3] &= (unsigned char)~(1u << (page & 7));
+        }
+    }
+}
+
+// Make room for len more bytes by dropping the oldest checkpoints with their pages - returns 0 if
+// that isn't possible (without dropping the newest checkpoint if keepNewest is set)
+static int minigdbstubSnapReserve(mgdbSnapshots *snap, size_t len, int keepNewest)
+{
+    if (len > snap->arenaSize)
+    {
+        return 0;
+    }
+    while (snap->head + len - snap->tail > snap->arenaSize)
+    {
+        if (keepNewest && (snap->tail == snap->lastCheckpoint))
+        {
+            return 0;
+        }
+        mgdbSnapRecord rec;
+        minigdbstubSnapRead(snap, snap->tail, &rec);
+        snap->tail += rec.size;
+        --snap->checkpoints;
+        while (snap->tail != snap->head)
+        {
+            minigdbstubSnapRead(snap, snap->tail, &rec);
+            if (rec.type == 'C')
+            {
+                break;
+            }
+            snap->tail += rec.size;
+        }
+    }
+    return 1;
+}
+
+// Newest checkpoint taken before instruction 'icount' - returns 0 if there's none
+static int minigdbstubSnapFind(mgdbSnapshots *snap, unsigned long long icount, size_t *pos,
+                               unsigned long long *at)
+{
+    size_t p = snap->lastCheckpoint;
+    for (size_t i = 0; i < snap->checkpoints; ++i)
+    {
+        mgdbSnapRecord rec;
+        minigdbstubSnapRead(snap, p, &rec);
+        if (rec.icount < icount)
+        {
+            *pos = p;
+            *at  = rec.icount;
+            return 1;
+        }
+        p = rec.addr;
+    }
+    return 0;
+}
+
+MGDB_TPL static void minigdbstubSnapshotCheckpoint(mgdbProcObj *mgdbObj)
+{
+    mgdbSnapshots *snap  = mgdbObj->snapshots;
+    size_t regSize       = minigdbstubRegFileSize(mgdbObj);
+    mgdbSnapRecord rec   = {0, 0, snap->lastCheckpoint, snap->icount, 'C'};
+    snap->nextCheckpoint = snap->icount + snap->interval;
+    minigdbstubSnapClearPages(snap);
+    if (!minigdbstubSnapReserve(snap, sizeof(rec) + regSize, 0))
+    {
+        snap->tail        = snap->head;  // Arena smaller than one checkpoint
+        snap->checkpoints = 0;
+        return;
+    }
+    minigdbstubRegFetchAll MGDB_T(mgdbObj);
+    minigdbstubSnapAppend(snap, &rec, regSize);
+    minigdbstubRingCopy(snap->arena, snap->arenaSize, snap->last + sizeof(rec), mgdbObj->regs,
+                        regSize, 1);
+    snap->lastCheckpoint = snap->last;
+    ++snap->checkpoints;
+    minigdbstubRegCacheFlush MGDB_T(mgdbObj);  // The target runs on
+}
+
+// Save the contents of page 'page' before its first write since the newest checkpoint
+MGDB_TPL static void minigdbstubSnapshotSavePage(mgdbProcObj *mgdbObj, size_t page)
+{
+    mgdbSnapshots *snap = mgdbObj->snapshots;
+    size_t start        = page << MGDB_SNAP_PAGE_SHIFT;
+    size_t len          = (size_t)1 << MGDB_SNAP_PAGE_SHIFT;
+    len                 = (len > snap->memSize - start) ? snap->memSize - start : len;
+    mgdbSnapRecord rec  = {0, 0, start, 0, 'P'};
+    if (!minigdbstubSnapReserve(snap, sizeof(rec) + len, 1))
+    {
+        // This interval alone doesn't fit - start over with a checkpoint before the next insn
+        minigdbstubSnapClearPages(snap);
+        snap->tail           = snap->head;
+        snap->checkpoints    = 0;
+        snap->nextCheckpoint = snap->icount;
+        return;
+    }
+    minigdbstubSnapAppend(snap, &rec, len);
+    size_t pos = snap->last + sizeof(rec);
+    if (snap->mem)
+    {
+        minigdbstubRingCopy(snap->arena, snap->arenaSize, pos, &snap->mem[start], len, 1);
+    }
+    for (size_t i = 0; !snap->mem && (i < len); ++i)
+    {
+        unsigned char c = MGDB_USR_CALL(ReadMem)(start + i, mgdbObj->usrData);
+        minigdbstubRingCopy(snap->arena, snap->arenaSize, pos + i, &c, 1, 1);
+    }
+    snap->pageBits[page >> 3] |= (unsigned char)(1u << (page & 7));
+    ++snap->pagesSaved;
+}
+
+// Call before the target writes len bytes at addr while it runs (not for GDB's M packets)
+MGDB_TPL static void minigdbstubSnapshotWrite(mgdbProcObj *mgdbObj, size_t addr, size_t len)
+{
+    mgdbSnapshots *snap = mgdbObj->snapshots;
+    size_t end          = (addr + len < snap->memSize) ? addr + len : snap->memSize;
+    for (size_t page = addr >> MGDB_SNAP_PAGE_SHIFT;
+         snap->checkpoints && (page << MGDB_SNAP_PAGE_SHIFT) < end; ++page)
+    {
+        if (!(snap->pageBits[page >> 3] & (1u << (page & 7))))
+        {
+            minigdbstubSnapshotSavePage MGDB_T(mgdbObj, page);
+        }
+    }
+}
+
+// Rewind registers and memory to the checkpoint at pos, dropping everything recorded after it
+MGDB_TPL static void minigdbstubSnapshotRestore(mgdbProcObj *mgdbObj, size_t pos)
+{
+    mgdbSnapshots *snap = mgdbObj->snapshots;
+    mgdbSnapRecord rec;
+    minigdbstubSnapClearPages(snap);
+    for (size_t p = snap->last; p != pos; p = rec.prev)
+    {
+        // Newest first, so a page saved in several intervals ends up with its oldest contents
+        minigdbstubSnapRead(snap, p, &rec);
+        if (rec.type == 'C')
+        {
+            --snap->checkpoints;
+            continue;
+        }
+        size_t len = rec.size - sizeof(rec);
+        if (snap->mem)
+        {
+            minigdbstubRingCopy(snap->arena, snap->arenaSize, p + sizeof(rec),
+                                &snap->mem[rec.addr], len, 0);
+        }
+        for (size_t i = 0; !snap->mem && (i < len); ++i)
+        {
+            unsigned char c;
+            minigdbstubRingCopy(snap->arena, snap->arenaSize, p + sizeof(rec) + i, &c, 1, 0);
+            MGDB_USR_CALL(WriteMem)(rec.addr + i, c, mgdbObj->usrData);
+        }
+        ++snap->pagesRestored;
+    }
+    minigdbstubSnapRead(snap, pos, &rec);
+    minigdbstubRingCopy(snap->arena, snap->arenaSize, pos + sizeof(rec), mgdbObj->regs,
+                        rec.size - sizeof(rec), 0);
+    for (size_t i = 0; mgdbObj->regCache && (i < mgdbObj->regCache->count); ++i)
+    {
+        minigdbstubRegMarkDirty(mgdbObj, i);  // Goes back to the target on resume
+    }
+    snap->head           = pos + rec.size;
+    snap->last           = pos;
+    snap->lastCheckpoint = pos;
+    snap->icount         = rec.icount;
+    snap->nextCheckpoint = rec.icount + snap->interval;
+}
+
+// A replay or scan reached snap->replayTo
+MGDB_TPL static int minigdbstubSnapshotReplayEnd(mgdbProcObj *mgdbObj)
+{
+    mgdbSnapshots *snap = mgdbObj->snapshots;
+    size_t pos;
+    unsigned long long at;
+    if (snap->mode == MGDB_SNAP_SCANNING)
+    {
+        if ((snap->scanHit == ~0ULL) && minigdbstubSnapFind(snap, snap->scanFrom, &pos, &at))
+        {
+            // No hit in this interval - scan the one before
+            minigdbstubSnapshotRestore MGDB_T(mgdbObj, pos);
+            snap->replayTo = snap->scanFrom;
+            snap->scanFrom = at;
+            return MGDB_SNAP_REWOUND;
+        }
+        if (!minigdbstubSnapFind(snap, snap->scanFrom + 1, &pos, &at))
+        {
+            // The interval's checkpoint was evicted from the arena - nothing to go back to
+            snap->atBegin = 1;
+            snap->mode    = MGDB_SNAP_RECORDING;
+            return MGDB_SNAP_STOP;
+        }
+        minigdbstubSnapshotRestore MGDB_T(mgdbObj, pos);
+        if (snap->scanHit != ~0ULL)
+        {
+            // Go back once more and stop at the last hit
+            snap->mode     = MGDB_SNAP_REPLAYING;
+            snap->replayTo = snap->scanHit;
+        }
+        else
+        {
+            // Back at the start of the recorded history
+            snap->replayTo = snap->icount;
+            snap->atBegin  = 1;
+        }
+        if (snap->icount != snap->replayTo)
+        {
+            return MGDB_SNAP_REWOUND;
+        }
+    }
+    snap->mode = MGDB_SNAP_RECORDING;
+    return MGDB_SNAP_STOP;
+}
+
+// Call before executing each instruction, at pc, with mgdbObj->regs up to date (or a regCache).
+// Takes checkpoints and ends reverse execution - see MGDB_SNAP_RUN/STOP/REWOUND. The target has
+// to execute deterministically for replays to retrace the recorded history
+MGDB_TPL static int minigdbstubSnapshotStep(mgdbProcObj *mgdbObj, size_t pc)
+{
+    mgdbSnapshots *snap = mgdbObj->snapshots;
+    if ((snap->mode != MGDB_SNAP_RECORDING) && (snap->icount == snap->replayTo))
+    {
+        int ret = minigdbstubSnapshotReplayEnd MGDB_T(mgdbObj);
+        minigdbstubRegCacheFlush MGDB_T(mgdbObj);  // Restored registers go back to the target
+        return ret;
+    }
+    if (snap->mode == MGDB_SNAP_SCANNING)
+    {
+        mgdbBreakpoint *bp =
+            mgdbObj->breakpoints ? minigdbstubBreakpointFind(mgdbObj->breakpoints, pc) : NULL;
+        if (bp && minigdbstubBreakpointCondition MGDB_T(mgdbObj, bp))
+        {
+            snap->scanHit = snap->icount;
+        }
+    }
+    if (snap->icount >= snap->nextCheckpoint)
+    {
+        minigdbstubSnapshotCheckpoint MGDB_T(mgdbObj);
+    }
+    snap->atBegin = 0;
+    ++snap->icount;
+    return MGDB_SNAP_RUN;
+}
+
+// c/s/vCont - forward execution always records, a replay GDB interrupted is abandoned here
+static void minigdbstubSnapshotResume(mgdbProcObj *mgdbObj)
+{
+    if (mgdbObj->snapshots)
+    {
+        mgdbObj->snapshots->mode = MGDB_SNAP_RECORDING;
+    }
+}
+
+// bs/bc - rewind to the newest checkpoint before the current instruction and let the target replay
+// forward from there. Returns 1 once control goes back to the target
+MGDB_TPL static int minigdbstubProcessReverse(mgdbProcObj *mgdbObj, int step)
+{
+    mgdbSnapshots *snap       = mgdbObj->snapshots;
+    unsigned long long origin = snap->icount;
+    size_t pos;
+    unsigned long long at;
+    minigdbstubRegCacheFlush MGDB_T(mgdbObj);  // GDB's register writes belong to the present
+    minigdbstubBreakpointSweep MGDB_T(mgdbObj);
+    mgdbObj->signalNum = 5;  // SIGTRAP
+    snap->atBegin      = !minigdbstubSnapFind(snap, origin, &pos, &at);
+    if (snap->atBegin)
+    {
+        minigdbstubSendSignal MGDB_T(mgdbObj);  // Nothing recorded before this instruction
+        return 0;
+    }
+    minigdbstubSnapshotRestore MGDB_T(mgdbObj, pos);
+    snap->mode     = step ? MGDB_SNAP_REPLAYING : MGDB_SNAP_SCANNING;
+    snap->replayTo = step ? origin - 1 : origin;
+    snap->scanFrom = at;
+    snap->scanHit  = ~0ULL;
+    if (step && (snap->icount == snap->replayTo))
+    {
+        snap->mode = MGDB_SNAP_RECORDING;  // The checkpoint is the previous instruction
+        minigdbstubSendSignal MGDB_T(mgdbObj);
+        return 0;
+    }
+    minigdbstubRegCacheFlush MGDB_T(mgdbObj);
+    minigdbstubFlush MGDB_T(mgdbObj);
+    MGDB_USR_CALL(Continue)(mgdbObj->usrData);
+    return 1;
+}
+
+static mgdbTracepoint *minigdbstubTracepointFind(mgdbTracepoints *tp, unsigned int number,
+                                                 size_t addr)
+{
+    for (size_t i = 0; i < tp->defCount; ++i)
+    {
+        if ((tp->defs[i].number == number) && (tp->defs[i].addr == addr))
+        {
+            return &tp->defs[i];
+        }
+    }
+    return NULL;
+}
+
+// Decode "len,bytecode" into the tracepoint's bytecode - returns the length, or -1 if it is
+// malformed or doesn't fit
+static long minigdbstubTracepointBytecode(mgdbTracepoint *def, const char *str, char **end)
+{
+    size_t len = strtoul(str, end, 16);
+    if ((**end != ',') || (def->bytecodeUsed + len > MGDB_TP_BYTECODE_SIZE) ||
+        (minigdbstubDecodeRegBytes((char *)&def->bytecode[def->bytecodeUsed], *end + 1, len, 0) !=
+         len))
+    {
+        return -1;
+    }
+    def->bytecodeUsed += len;
+    *end += 1 + (len * 2);
+    return (long)len;
+}
+
+// QTDP:<n>:<addr>:<E|D>:<step>:<pass>[:X<len>,<cond>][-] defines a tracepoint location and
+// QTDP:-<n>:<addr>:<actions>[-] adds its collection actions - returns MGDB_SUCCESS if it was stored
+static int minigdbstubTracepointDefine(mgdbTracepoints *tp, const char *pkt)
+{
+    char *end;
+    int actions         = (pkt[5] == '-');
+    unsigned int number = (unsigned int)strtoul(&pkt[5 + actions], &end, 16);
+    size_t addr         = (*end == ':') ? strtoul(end + 1, &end, 16) : 0;
+    if (*end != ':')
+    {
+        return MGDB_BAD_FORMAT;
+    }
+    mgdbTracepoint *def = minigdbstubTracepointFind(tp, number, addr);
+    if (!actions)
+    {
+        if (def == NULL)
+        {
+            if (tp->defCount == tp->defCapacity)
+            {
+                return MGDB_ALLOC_FAILED;
+            }
+            def = &tp->defs[tp->defCount++];
+        }
+        memset(def, 0, sizeof(*def));
+        def->number  = number;
+        def->addr    = addr;
+        def->enabled = (end[1] == 'E');
+        strtoul(end + 3, &end, 16);  // Step count - while-stepping isn't supported
+        def->passCount = (*end == ':') ? strtoul(end + 1, &end, 16) : 0;
+        while (*end == ':')
+        {
+            ++end;
+            if (*end == 'X')
+            {
+                long len = minigdbstubTracepointBytecode(def, end + 1, &end);
+                if (len < 0)
+                {
+                    return MGDB_BAD_FORMAT;
+                }
+                def->condLen = (unsigned short)len;
+            }
+            else
+            {
+                // Fast tracepoint length (F) - a plain tracepoint here
+                end += strcspn(end, ":-");
+            }
+        }
+        return MGDB_SUCCESS;
+    }
+
+    if (def == NULL)
+    {
+        return MGDB_BAD_FORMAT;
+    }
+    ++end;
+    while (*end)
+    {
+        switch (*end)
+        {
+            case 'R':  // Register mask - any register collects the whole register file
+                def->collectRegs = 1;
+                ++end;
+                while (minigdbstubHexVal(*end) >= 0)
+                {
+                    ++end;
+                }
+                break;
+            case 'M':  // <basereg>,<offset>,<len> - basereg is -1 for an absolute address
+            {
+                if (def->memCount == MGDB_TP_MAX_MEM)
+                {
+                    return MGDB_ALLOC_FAILED;
+                }
+                mgdbTraceMemRange *range = &def->mem[def->memCount];
+                range->baseReg = (int)strtol(end + 1, &end, 16);
+                range->offset  = (*end == ',') ? strtoul(end + 1, &end, 16) : 0;
+                range->len     = (*end == ',') ? strtoul(end + 1, &end, 16) : 0;
+                ++def->memCount;
+                break;
+            }
+            case 'X':  // Collection expression
+            {
+                long len = (def->exprCount < MGDB_TP_MAX_EXPRS)
+                               ? minigdbstubTracepointBytecode(def, end + 1, &end)
+                               : -1;
+                if (len < 0)
+                {
+                    return MGDB_BAD_FORMAT;
+                }
+                def->exprLen[def->exprCount++] = (unsigned short)len;
+                break;
+            }
+            case 'S':  // While-stepping actions aren't supported - ignore them
+                return MGDB_SUCCESS;
+            case '-':  // More action packets follow
+                ++end;
+                break;
+            default:
+                return MGDB_BAD_FORMAT;
+        }
+    }
+    return MGDB_SUCCESS;
+}
+
+// Position of the frame selected by QTFrame - returns 0 if it was overwritten
+static int minigdbstubTraceFramePos(mgdbTracepoints *tp, size_t *pos, mgdbTraceFrameHdr *hdr)
+{
+    *pos = tp->tail;
+    for (size_t n = tp->firstFrame; n < tp->firstFrame + tp->frameCount; ++n)
+    {
+        minigdbstubTraceCopy(tp, *pos, hdr, sizeof(*hdr), 0);
+        if ((long)n == tp->selected)
+        {
+            return 1;
+        }
+        *pos += hdr->size;
+    }
+    return 0;
+}
+
+// Find the selected frame's 'type' block holding addr - *len is trimmed to what the block has from
+// addr on, and *pos is where that data starts
+static int minigdbstubTraceFrameBlock(mgdbTracepoints *tp, char type, size_t addr, size_t *len,
+                                      size_t *pos)
+{
+    mgdbTraceFrameHdr hdr;
+    size_t frame;
+    if (!minigdbstubTraceFramePos(tp, &frame, &hdr))
+    {
+        return 0;
+    }
+    for (size_t at = frame + sizeof(hdr); at < frame + hdr.size;)
+    {
+        mgdbTraceBlock block;
+        minigdbstubTraceCopy(tp, at, &block, sizeof(block), 0);
+        at += sizeof(block);
+        if ((block.type == type) && (addr >= block.addr) && (addr - block.addr < block.len))
+        {
+            size_t avail = block.len - (addr - block.addr);
+            *len         = (*len > avail) ? avail : *len;
+            *pos         = at + (addr - block.addr);
+            return 1;
+        }
+        at += block.len;
+    }
+    return 0;
+}
+
+static int minigdbstubTraceFrameSelected(mgdbProcObj *mgdbObj)
+{
+    return mgdbObj->tracepoints && (mgdbObj->tracepoints->selected >= 0);
+}
+
+// Serve 'g' (recvPkt NULL) or 'p' from the selected trace frame - registers it didn't collect are
+// reported unavailable
+MGDB_TPL static void minigdbstubTraceSendFrameRegs(mgdbProcObj *mgdbObj, gdbPacket *recvPkt)
+{
+    mgdbTracepoints *tp = mgdbObj->tracepoints;
+    size_t size         = minigdbstubRegFileSize(mgdbObj);
+    size_t len          = size;
+    size_t pos;
+    if (minigdbstubTraceFrameBlock(tp, 'R', 0, &len, &pos))
+    {
+        DynCharBuffer regs = {0};
+        MGDB_CHECK_RET(initDynCharBuffer(&regs, size), mgdbObj);
+        memset(regs.buffer, 0, size);
+        minigdbstubTraceCopy(tp, pos, regs.buffer, len, 0);
+
+        mgdbProcObj frameObj = *mgdbObj;
+        frameObj.regs        = regs.buffer;
+        frameObj.tracepoints = NULL;
+        if (recvPkt)
+        {
+            minigdbstubSendReg MGDB_T(&frameObj, recvPkt);
+        }
+        else
+        {
+            minigdbstubSendRegs MGDB_T(&frameObj);
+        }
+        mgdbObj->err = frameObj.err;
+        freeDynCharBuffer(&regs);
+        return;
+    }
+
+    size_t index, offset, bytes = 0;
+    int swap;
+    if (recvPkt)
+    {
+        MGDB_HEX_DECODE_ASCII(&recvPkt->pktData.buffer[1], index);
+        if (!minigdbstubRegLocate(mgdbObj, index, &offset, &bytes, &swap))
+        {
+            minigdbstubSend MGDB_T(MGDB_ERROR_PACKET, mgdbObj);
+            return;
+        }
+    }
+    else
+    {
+        size_t regBytes;
+        for (index = 0; minigdbstubRegLocate(mgdbObj, index, &offset, &regBytes, &swap); ++index)
+        {
+            bytes += regBytes;
+        }
+    }
+    DynCharBuffer sendPkt = {0};
+    MGDB_CHECK_RET(initDynCharBuffer(&sendPkt, (bytes * 2) + 8), mgdbObj);
+    MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, '$'), mgdbObj);
+    memset(&sendPkt.buffer[sendPkt.used], 'x', bytes * 2);
+    sendPkt.used += bytes * 2;
+    minigdbstubSendPkt MGDB_T(&sendPkt, mgdbObj);
+    freeDynCharBuffer(&sendPkt);
+}
 
-    // Convert signal num to hex char array
-    char itoaBuff[8] = {0, 0, 0, 0, 0, 0, 0, 0};
-    MGDB_DEC_ENCODE_ASCII(mgdbObj->signalNum, 8, itoaBuff);
+// Serve 'm' from the memory the selected trace frame collected
+MGDB_TPL static void minigdbstubTraceSendFrameMem(mgdbProcObj *mgdbObj, gdbPacket *recvPkt)
+{
+    char *end;
+    size_t addr = strtoul(&recvPkt->pktData.buffer[1], &end, 16);
+    size_t len  = (*end == ',') ? strtoul(end + 1, NULL, 16) : 0;
+    size_t pos;
+    if (!minigdbstubTraceFrameBlock(mgdbObj->tracepoints, 'M', addr, &len, &pos))
+    {
+        minigdbstubSend MGDB_T(MGDB_ERROR_PACKET, mgdbObj);
+        return;
+    }
+
+    DynCharBuffer sendPkt = {0};
+    MGDB_CHECK_RET(initDynCharBuffer(&sendPkt, (len * 2) + 8), mgdbObj);
+    MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, '$'), mgdbObj);
+    for (size_t i = 0; i < len; ++i)
+    {
+        char c;
+        minigdbstubTraceCopy(mgdbObj->tracepoints, pos + i, &c, 1, 0);
+        minigdbstubEncodeRegBytes(&sendPkt.buffer[sendPkt.used], &c, 1, 0);
+        sendPkt.used += 2;
+    }
+    minigdbstubSendPkt MGDB_T(&sendPkt, mgdbObj);
+    freeDynCharBuffer(&sendPkt);
+}
+
+// QTFrame:<n>, QTFrame:pc:<addr>, QTFrame:tdp:<n>, QTFrame:range:<lo>:<hi> and
+// QTFrame:outside:<lo>:<hi> - the searches start after the selected frame
+MGDB_TPL static void minigdbstubTraceSelectFrame(mgdbProcObj *mgdbObj, const char *query)
+{
+    mgdbTracepoints *tp = mgdbObj->tracepoints;
+    char *end;
+    char mode = 'n';
+    size_t lo = 0, hi = 0;
+    if ((strncmp(query, "pc:", 3) == 0) || (strncmp(query, "tdp:", 4) == 0))
+    {
+        mode = query[0];
+        lo   = strtoul(strchr(query, ':') + 1, NULL, 16);
+    }
+    else if ((strncmp(query, "range:", 6) == 0) || (strncmp(query, "outside:", 8) == 0))
+    {
+        mode = query[0];
+        lo   = strtoul(strchr(query, ':') + 1, &end, 16);
+        hi   = (*end == ':') ? strtoul(end + 1, NULL, 16) : lo;
+    }
+    else
+    {
+        lo = strtoul(query, NULL, 16);
+        if ((int)lo == -1)
+        {
+            // Back to the live target
+            tp->selected = -1;
+            minigdbstubSend MGDB_T(MGDB_OK_PACKET, mgdbObj);
+            return;
+        }
+    }
+
+    size_t pos = tp->tail;
+    for (size_t n = tp->firstFrame; n < tp->firstFrame + tp->frameCount; ++n)
+    {
+        mgdbTraceFrameHdr hdr;
+        minigdbstubTraceCopy(tp, pos, &hdr, sizeof(hdr), 0);
+        pos += hdr.size;
+        int match = (mode == 'n') ? (n == lo)
+                    : (mode == 'p') ? (hdr.addr == lo)
+                    : (mode == 't') ? (hdr.number == lo)
+                    : (mode == 'r') ? ((hdr.addr >= lo) && (hdr.addr <= hi))
+                                    : ((hdr.addr < lo) || (hdr.addr > hi));
+        if (match && ((mode == 'n') || ((long)n > tp->selected)))
+        {
+            char reply[48];
+            int len      = snprintf(reply, sizeof(reply), "F%zxT%x", n, hdr.number);
+            tp->selected = (long)n;
+            minigdbstubSendPayload MGDB_T(reply, len, mgdbObj);
+            return;
+        }
+    }
+    tp->selected = -1;
+    minigdbstubSendPayload MGDB_T("F-1", 3, mgdbObj);
+}
+
+// qTStatus reply - "T<running>[;<stop reason>];tframes:...;tcreated:...;tsize:...;tfree:..."
+MGDB_TPL static void minigdbstubSendTraceStatus(mgdbProcObj *mgdbObj)
+{
+    mgdbTracepoints *tp = mgdbObj->tracepoints;
+    char status[192];
+    int len = snprintf(status, sizeof(status), "T%d;", tp->status == MGDB_TP_RUNNING);
+    switch (tp->status)
+    {
+        case MGDB_TP_NOT_RUN:
+            len += snprintf(&status[len], sizeof(status) - len, "tnotrun:0;");
+            break;
+        case MGDB_TP_STOPPED:
+            len += snprintf(&status[len], sizeof(status) - len, "tstop::0;");
+            break;
+        case MGDB_TP_PASSCOUNT:
+            len += snprintf(&status[len], sizeof(status) - len, "tpasscount:%x;", tp->stopTp);
+            break;
+        default:
+            break;
+    }
+    len += snprintf(&status[len], sizeof(status) - len,
+                    "tframes:%zx;tcreated:%zx;tsize:%zx;tfree:%zx;circular:1", tp->frameCount,
+                    tp->firstFrame + tp->frameCount, tp->framesSize,
+                    tp->framesSize - (tp->head - tp->tail));
+    minigdbstubSendPayload MGDB_T(status, len, mgdbObj);
+}
+
+// Tracepoint packets ('QT...')
+MGDB_TPL static void minigdbstubProcessTracepoint(mgdbProcObj *mgdbObj, gdbPacket *recvPkt)
+{
+    mgdbTracepoints *tp = mgdbObj->tracepoints;
+    const char *pkt     = recvPkt->pktData.buffer;
+    int ret             = MGDB_SUCCESS;
+    if ((tp == NULL) || (strncmp(pkt, "QT", 2) != 0))
+    {
+        minigdbstubSend MGDB_T(MGDB_EMPTY_PACKET, mgdbObj);
+        return;
+    }
+
+    if (strcmp(pkt, "QTinit") == 0)
+    {
+        if (tp->status == MGDB_TP_RUNNING)
+        {
+            minigdbstubTracepointsPlant MGDB_T(mgdbObj, MGDB_CLEAR_BREAKPOINT);
+        }
+        minigdbstubTraceClear(tp);
+        tp->defCount = 0;
+        tp->status   = MGDB_TP_NOT_RUN;
+    }
+    else if (strncmp(pkt, "QTDP:", 5) == 0)
+    {
+        ret = minigdbstubTracepointDefine(tp, pkt);
+    }
+    else if (strcmp(pkt, "QTStart") == 0)
+    {
+        minigdbstubTraceClear(tp);
+        for (size_t i = 0; i < tp->defCount; ++i)
+        {
+            tp->defs[i].hits = 0;
+        }
+        tp->status = MGDB_TP_RUNNING;
+        minigdbstubTracepointsPlant MGDB_T(mgdbObj, MGDB_SET_BREAKPOINT);
+    }
+    else if (strcmp(pkt, "QTStop") == 0)
+    {
+        if (tp->status == MGDB_TP_RUNNING)
+        {
+            tp->status = MGDB_TP_STOPPED;
+            minigdbstubTracepointsPlant MGDB_T(mgdbObj, MGDB_CLEAR_BREAKPOINT);
+        }
+    }
+    else if (strncmp(pkt, "QTFrame:", 8) == 0)
+    {
+        minigdbstubTraceSelectFrame MGDB_T(mgdbObj, &pkt[8]);
+        return;
+    }
+    else if ((strncmp(pkt, "QTBuffer:circular:", 18) != 0) && (strncmp(pkt, "QTro", 4) != 0))
+    {
+        // The buffer is always circular and read-only regions aren't needed - anything else
+        // (trace state variables, notes, ...) is unsupported
+        minigdbstubSend MGDB_T(MGDB_EMPTY_PACKET, mgdbObj);
+        return;
+    }
+    minigdbstubSend MGDB_T((ret == MGDB_SUCCESS) ? MGDB_OK_PACKET : MGDB_ERROR_PACKET, mgdbObj);
+}
+
+// H<op><thread> - Hg picks the thread register packets refer to, other ops (Hc) are accepted as-is
+MGDB_TPL static void minigdbstubProcessThreadSelect(mgdbProcObj *mgdbObj, gdbPacket *recvPkt)
+{
+    mgdbThreadTable *table = mgdbObj->threads;
+    const char *pkt        = recvPkt->pktData.buffer;
+    size_t id              = strtoul(&pkt[2], NULL, 16);
+    mgdbThread *thread     = minigdbstubThreadFind(table, id);
+    if ((pkt[1] == 'g') && thread)
+    {
+        minigdbstubThreadSelect MGDB_T(mgdbObj, (size_t)(thread - table->threads));
+    }
+    else if ((pkt[1] == 'g') && (id != 0) && (id != (size_t)-1))
+    {
+        // Not "any" or "all" thread either
+        minigdbstubSend MGDB_T(MGDB_ERROR_PACKET, mgdbObj);
+        return;
+    }
+    minigdbstubSend MGDB_T(MGDB_OK_PACKET, mgdbObj);
+}
+
+MGDB_TPL static void minigdbstubSendThreadList(mgdbProcObj *mgdbObj)
+{
+    mgdbThreadTable *table = mgdbObj->threads;
+    DynCharBuffer sendPkt  = {0};
+    MGDB_CHECK_RET(initDynCharBuffer(&sendPkt, 64), mgdbObj);
+    MGDB_CHECK_RET(appendDynCharBuffer(&sendPkt, "$m", 2), mgdbObj);
+    for (size_t i = 0; i < table->count; ++i)
+    {
+        char id[24];
+        int len = snprintf(id, sizeof(id), (i > 0) ? ",%zx" : "%zx", table->threads[i].id);
+        MGDB_CHECK_RET(appendDynCharBuffer(&sendPkt, id, len), mgdbObj);
+    }
+    minigdbstubSendPkt MGDB_T(&sendPkt, mgdbObj);
+    freeDynCharBuffer(&sendPkt);
+}
+
+// '?' - in non-stop mode every stopped thread is reported again, the first one here and the rest
+// in reply to vStopped
+MGDB_TPL static void minigdbstubSendStatus(mgdbProcObj *mgdbObj)
+{
+    mgdbThreadTable *table = mgdbObj->threads;
+    if (!table || !table->nonStop)
+    {
+        minigdbstubSendSignal MGDB_T(mgdbObj);
+        return;
+    }
+    for (size_t i = 0; i < table->count; ++i)
+    {
+        mgdbThread *thread  = &table->threads[i];
+        thread->pendingStop = !thread->running;
+        thread->stopSeq     = table->nextSeq++;
+    }
+    mgdbThread *thread = minigdbstubThreadPendingStop(table);
+    if (thread == NULL)
+    {
+        minigdbstubSend MGDB_T(MGDB_OK_PACKET, mgdbObj);
+        return;
+    }
+    table->notified = 1;
+    minigdbstubSendThreadStop MGDB_T(mgdbObj, thread, 0);
+}
+
+// vStopped - acknowledges the oldest pending stop and replies with the next one, or OK once GDB has
+// seen them all
+MGDB_TPL static void minigdbstubProcessVStopped(mgdbProcObj *mgdbObj)
+{
+    mgdbThreadTable *table = mgdbObj->threads;
+    mgdbThread *thread     = minigdbstubThreadPendingStop(table);
+    if (thread)
+    {
+        thread->pendingStop = 0;
+    }
+    thread = minigdbstubThreadPendingStop(table);
+    if (thread == NULL)
+    {
+        table->notified = 0;
+        minigdbstubSend MGDB_T(MGDB_OK_PACKET, mgdbObj);
+        return;
+    }
+    minigdbstubSendThreadStop MGDB_T(mgdbObj, thread, 0);
+}
+
+// vCont;<action>[:<thread>]... - each thread takes the first action naming it (or naming no thread).
+// Signals in C/S actions aren't delivered. Returns 1 if control goes back to the target, which is
+// only the case in all-stop mode
+MGDB_TPL static int minigdbstubProcessVCont(mgdbProcObj *mgdbObj, const char *actions)
+{
+    mgdbThreadTable *table = mgdbObj->threads;
+    minigdbstubRegCacheFlush MGDB_T(mgdbObj);
+    minigdbstubSnapshotResume(mgdbObj);
+    minigdbstubBreakpointSweep MGDB_T(mgdbObj);
+    for (size_t i = 0; i < table->count; ++i)
+    {
+        mgdbThread *thread = &table->threads[i];
+        const char *action = actions;
+        for (; action && (*action == ';'); action = strchr(action + 1, ';'))
+        {
+            const char *sep = strpbrk(action + 1, ":;");
+            size_t id       = (sep && (*sep == ':')) ? strtoul(sep + 1, NULL, 16) : (size_t)-1;
+            if ((id != thread->id) && (id != (size_t)-1))
+            {
+                continue;
+            }
+            if ((action[1] == 't') && thread->running)
+            {
+                minigdbstubStopThread MGDB_T(mgdbObj, thread->id);
+            }
+            else if ((action[1] != 't') && !thread->running)
+            {
+                thread->running     = 1;
+                thread->pendingStop = 0;
+                minigdbstubResumeThread MGDB_T(mgdbObj, thread->id,
+                                               (action[1] == 's') || (action[1] == 'S'));
+            }
+            break;
+        }
+    }
+    if (table->nonStop)
+    {
+        minigdbstubSend MGDB_T(MGDB_OK_PACKET, mgdbObj);
+        return 0;
+    }
+    minigdbstubFlush MGDB_T(mgdbObj);
+    return 1;
+}
+
+// 'v' packets - returns 1 once control goes back to the target
+MGDB_TPL static int minigdbstubProcessV(mgdbProcObj *mgdbObj, gdbPacket *recvPkt)
+{
+    const char *pkt = recvPkt->pktData.buffer;
+    if (mgdbObj->threads && (strcmp(pkt, "vCont?") == 0))
+    {
+        minigdbstubSendPayload MGDB_T("vCont;c;C;s;S;t", 15, mgdbObj);
+    }
+    else if (mgdbObj->threads && (strncmp(pkt, "vCont;", 6) == 0))
+    {
+        return minigdbstubProcessVCont MGDB_T(mgdbObj, &pkt[5]);
+    }
+    else if (mgdbObj->threads && (strcmp(pkt, "vStopped") == 0))
+    {
+        minigdbstubProcessVStopped MGDB_T(mgdbObj);
+    }
+    else if (strncmp(pkt, "vAttach;", 8) == 0)
+    {
+        // The one process is always there to attach to, stopped while the stub runs
+        minigdbstubSendStatus MGDB_T(mgdbObj);
+    }
+    else
+    {
+        minigdbstubSend MGDB_T(MGDB_EMPTY_PACKET, mgdbObj);
+    }
+    return 0;
+}
+
+// Target description XML generated from the register layout
+static int minigdbstubXmlAppend(DynCharBuffer *xml, const char *str)
+{
+    return appendDynCharBuffer(xml, str, strlen(str));
+}
+
+static void minigdbstubTargetXml(mgdbProcObj *mgdbObj, DynCharBuffer *xml)
+{
+    // Names, types and groups are appended as they are - they can be of any length
+    const mgdbRegLayout *layout = mgdbObj->regLayout;
+    MGDB_CHECK_RET(minigdbstubXmlAppend(xml, "<?xml version=\"1.0\"?>\n"
+                                             "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">\n"
+                                             "<target version=\"1.0\">\n"),
+                   mgdbObj);
+    if (layout->arch)
+    {
+        MGDB_CHECK_RET(minigdbstubXmlAppend(xml, "<architecture>"), mgdbObj);
+        MGDB_CHECK_RET(minigdbstubXmlAppend(xml, layout->arch), mgdbObj);
+        MGDB_CHECK_RET(minigdbstubXmlAppend(xml, "</architecture>\n"), mgdbObj);
+    }
+    MGDB_CHECK_RET(minigdbstubXmlAppend(xml, "<feature name=\""), mgdbObj);
+    MGDB_CHECK_RET(minigdbstubXmlAppend(xml, layout->feature), mgdbObj);
+    MGDB_CHECK_RET(minigdbstubXmlAppend(xml, "\">\n"), mgdbObj);
+    for (size_t i = 0; i < layout->count; ++i)
+    {
+        const mgdbRegDesc *desc = &layout->regs[i];
+        char numbers[64];
+        snprintf(numbers, sizeof(numbers), "\" bitsize=\"%zu\" regnum=\"%zu\" type=\"",
+                 desc->bitsize, i);
+        MGDB_CHECK_RET(minigdbstubXmlAppend(xml, "<reg name=\""), mgdbObj);
+        MGDB_CHECK_RET(minigdbstubXmlAppend(xml, desc->name), mgdbObj);
+        MGDB_CHECK_RET(minigdbstubXmlAppend(xml, numbers), mgdbObj);
+        MGDB_CHECK_RET(minigdbstubXmlAppend(xml, desc->type), mgdbObj);
+        if (desc->group)
+        {
+            MGDB_CHECK_RET(minigdbstubXmlAppend(xml, "\" group=\""), mgdbObj);
+            MGDB_CHECK_RET(minigdbstubXmlAppend(xml, desc->group), mgdbObj);
+        }
+        MGDB_CHECK_RET(minigdbstubXmlAppend(xml, "\"/>\n"), mgdbObj);
+    }
+    MGDB_CHECK_RET(minigdbstubXmlAppend(xml, "</feature>\n</target>\n"), mgdbObj);
+}
+
+// Memory map XML generated from mgdbObj->memMap
+static void minigdbstubMemoryMapXml(mgdbProcObj *mgdbObj, DynCharBuffer *xml)
+{
+    static const char header[] = "<?xml version=\"1.0\"?>\n<!DOCTYPE memory-map PUBLIC "
+                                 "\"+//IDN gnu.org//DTD GDB Memory Map V1.0//EN\" "
+                                 "\"http://sourceware.org/gdb/gdb-memory-map.dtd\">\n"
+                                 "<memory-map>\n";
+    MGDB_CHECK_RET(appendDynCharBuffer(xml, header, sizeof(header) - 1), mgdbObj);
+    for (size_t i = 0; i < mgdbObj->memMap->count; ++i)
+    {
+        const mgdbMemRegion *region = &mgdbObj->memMap->regions[i];
+        char line[128];
+        int len = snprintf(line, sizeof(line),
+                           "<memory type=\"%s\" start=\"0x%zx\" length=\"0x%zx\"/>\n",
+                           (region->type == MGDB_MEM_ROM) ? "rom" : "ram", region->start,
+                           region->length);
+        MGDB_CHECK_RET(appendDynCharBuffer(xml, line, len), mgdbObj);
+    }
+    MGDB_CHECK_RET(appendDynCharBuffer(xml, "</memory-map>\n", 14), mgdbObj);
+}
+
+// Reply to a qXfer read with the "offset,length" window of data - 'm' if more follows, 'l' if last
+MGDB_TPL static void minigdbstubSendXfer(mgdbProcObj *mgdbObj, const char *window,
+                                         const DynCharBuffer *data)
+{
+    char *lengthStr;
+    size_t offset = strtoul(window, &lengthStr, 16);
+    size_t length = (*lengthStr == ',') ? strtoul(lengthStr + 1, NULL, 16) : 0;
+    offset        = (offset > data->used) ? data->used : offset;
+    length        = (length > data->used - offset) ? data->used - offset : length;
+
+    DynCharBuffer sendPkt = {0};
+    MGDB_CHECK_RET(initDynCharBuffer(&sendPkt, length + 8), mgdbObj);
+    MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, '$'), mgdbObj);
+    MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, (offset + length < data->used) ? 'm' : 'l'),
+                   mgdbObj);
+    for (size_t i = offset; i < offset + length; ++i)
+    {
+        // Binary data - escape the framing characters
+        char c = data->buffer[i];
+        if ((c == '$') || (c == '#') || (c == '}') || (c == '*'))
+        {
+            MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, '}'), mgdbObj);
+            c ^= 0x20;
+        }
+        MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, c), mgdbObj);
+    }
+    minigdbstubSendPkt MGDB_T(&sendPkt, mgdbObj);
+    freeDynCharBuffer(&sendPkt);
+}
+
+MGDB_TPL static void minigdbstubSendSupported(mgdbProcObj *mgdbObj)
+{
+    DynCharBuffer sendPkt = {0};
+    MGDB_CHECK_RET(initDynCharBuffer(&sendPkt, 64), mgdbObj);
+    MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, '$'), mgdbObj);
+    if (mgdbObj->regLayout)
+    {
+        MGDB_CHECK_RET(appendDynCharBuffer(&sendPkt, "qXfer:features:read+;", 21), mgdbObj);
+    }
+    if (mgdbObj->memMap)
+    {
+        MGDB_CHECK_RET(appendDynCharBuffer(&sendPkt, "qXfer:memory-map:read+;", 23), mgdbObj);
+    }
+    if (mgdbObj->breakpoints)
+    {
+        MGDB_CHECK_RET(appendDynCharBuffer(&sendPkt, "ConditionalBreakpoints+;", 24), mgdbObj);
+    }
+    if (mgdbObj->snapshots)
+    {
+        MGDB_CHECK_RET(appendDynCharBuffer(&sendPkt, "ReverseStep+;ReverseContinue+;", 30),
+                       mgdbObj);
+    }
+    if (mgdbObj->tracepoints)
+    {
+        MGDB_CHECK_RET(appendDynCharBuffer(&sendPkt, "ConditionalTracepoints+;", 24), mgdbObj);
+    }
+    if (mgdbObj->threads)
+    {
+        MGDB_CHECK_RET(appendDynCharBuffer(&sendPkt, "QNonStop+;", 10), mgdbObj);
+    }
+    // Drop the trailing ';'
+    sendPkt.used -= (sendPkt.buffer[sendPkt.used - 1] == ';');
+    minigdbstubSendPkt MGDB_T(&sendPkt, mgdbObj);
+    freeDynCharBuffer(&sendPkt);
+}
+
+// Store the low 'bytes' bytes of value in target byte order - returns the end of the field
+static unsigned char *minigdbstubCorePut(unsigned char *out, unsigned long long value, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; ++i)
+    {
+#ifdef MGDB_TARGET_BIG_ENDIAN
+        out[bytes - 1 - i] = (unsigned char)(value >> (i * 8));
+#else
+        out[i] = (unsigned char)(value >> (i * 8));
+#endif
+    }
+    return out + bytes;
+}
+
+typedef struct
+{
+    FILE *file;
+    int is64;
+    size_t pos;           // Bytes written
+    int failed;           // A write failed
+    DynCharBuffer phdrs;  // Program header table - written last, once every segment is known
+    size_t phnum;
+    size_t dataBytes;     // Memory written to the file
+    size_t zeroBytes;     // All-zero memory left out of the file
+} mgdbCoreWriter;
+
+static void minigdbstubCoreWrite(mgdbCoreWriter *core, const void *data, size_t len)
+{
+    core->failed |= (fwrite(data, 1, len, core->file) != len);
+    core->pos += len;
+}
+
+static int minigdbstubCorePhdr(mgdbCoreWriter *core, unsigned int type, unsigned int flags,
+                               size_t offset, size_t addr, size_t fileSize, size_t memSize)
+{
+    unsigned char phdr[56];
+    size_t word      = core->is64 ? 8 : 4;
+    unsigned char *p = minigdbstubCorePut(phdr, type, 4);
+    p                = core->is64 ? minigdbstubCorePut(p, flags, 4) : p;
+    p                = minigdbstubCorePut(p, offset, word);
+    p                = minigdbstubCorePut(p, addr, word);  // p_vaddr
+    p                = minigdbstubCorePut(p, addr, word);  // p_paddr
+    p                = minigdbstubCorePut(p, fileSize, word);
+    p                = minigdbstubCorePut(p, memSize, word);
+    p                = core->is64 ? p : minigdbstubCorePut(p, flags, 4);
+    p                = minigdbstubCorePut(p, 1, word);  // p_align
+    ++core->phnum;
+    return appendDynCharBuffer(&core->phdrs, (const char *)phdr, (size_t)(p - phdr));
+}
+
+// ELF header - more than 0xfffe program headers go in section header 0 (PN_XNUM)
+static size_t minigdbstubCoreEhdr(const mgdbCoreInfo *info, unsigned char *out, size_t phoff,
+                                  size_t phnum, size_t shoff)
+{
+    size_t word = info->is64 ? 8 : 4;
+    memset(out, 0, 16);
+    memcpy(out, "\x7f" "ELF", 4);
+    out[4] = info->is64 ? 2 : 1;  // ELFCLASS64 / ELFCLASS32
+#ifdef MGDB_TARGET_BIG_ENDIAN
+    out[5] = 2;  // ELFDATA2MSB
+#else
+    out[5] = 1;  // ELFDATA2LSB
+#endif
+    out[6]           = 1;  // EV_CURRENT
+    unsigned char *p = minigdbstubCorePut(&out[16], 4, 2);  // ET_CORE
+    p                = minigdbstubCorePut(p, info->machine, 2);
+    p                = minigdbstubCorePut(p, 1, 4);     // e_version
+    p                = minigdbstubCorePut(p, 0, word);  // e_entry
+    p                = minigdbstubCorePut(p, phoff, word);
+    p                = minigdbstubCorePut(p, shoff, word);
+    p                = minigdbstubCorePut(p, info->flags, 4);
+    p                = minigdbstubCorePut(p, info->is64 ? 64 : 52, 2);  // e_ehsize
+    p                = minigdbstubCorePut(p, info->is64 ? 56 : 32, 2);  // e_phentsize
+    p                = minigdbstubCorePut(p, (phnum < 0xffff) ? phnum : 0xffff, 2);
+    p                = minigdbstubCorePut(p, shoff ? (info->is64 ? 64 : 40) : 0, 2);
+    p                = minigdbstubCorePut(p, shoff ? 1 : 0, 2);  // e_shnum
+    p                = minigdbstubCorePut(p, 0, 2);              // e_shstrndx
+    return (size_t)(p - out);
+}
 
-    // Swap if single digit
-    if (itoaBuff[1] == 0)
+// NT_PRSTATUS note - signal, pid 1 and the registers mapped through coreInfo->gregMap
+MGDB_TPL static int minigdbstubCoreNote(mgdbProcObj *mgdbObj, DynCharBuffer *note)
+{
+    const mgdbCoreInfo *info = mgdbObj->coreInfo;
+    size_t header            = info->is64 ? 112 : 72;  // pr_info ... pr_cstime
+    size_t descSize          = header + (info->gregCount * info->gregSize) + (info->is64 ? 8 : 4);
+    size_t noteSize          = 20 + ((descSize + 3) & ~(size_t)3);
+    int err                  = reserveDynCharBuffer(note, noteSize);
+    if (err != MGDB_SUCCESS)
     {
-        itoaBuff[1] = itoaBuff[0];
-        itoaBuff[0] = '0';
+        return err;
     }
+    unsigned char *out = (unsigned char *)note->buffer;
+    memset(out, 0, noteSize);
+    minigdbstubCorePut(out, 5, 4);  // namesz
+    minigdbstubCorePut(&out[4], descSize, 4);
+    minigdbstubCorePut(&out[8], 1, 4);  // NT_PRSTATUS
+    memcpy(&out[12], "CORE", 5);
+    unsigned char *desc = &out[20];
+    minigdbstubCorePut(desc, (unsigned int)mgdbObj->signalNum, 4);       // pr_info.si_signo
+    minigdbstubCorePut(&desc[12], (unsigned int)mgdbObj->signalNum, 2);  // pr_cursig
+    minigdbstubCorePut(&desc[info->is64 ? 32 : 24], 1, 4);               // pr_pid
+    for (size_t i = 0; i < info->gregCount; ++i)
+    {
+        unsigned long long value = 0;
+        if ((info->gregMap[i] >= 0) &&
+            (minigdbstubRegValue MGDB_T(mgdbObj, (size_t)info->gregMap[i], &value) != MGDB_SUCCESS))
+        {
+            value = 0;
+        }
+        minigdbstubCorePut(&desc[header + (i * info->gregSize)], value, info->gregSize);
+    }
+    note->used = noteSize;
+    return MGDB_SUCCESS;
+}
 
-    int bufferPtr = 0;
-    while (itoaBuff[bufferPtr] != 0)
+// Stream one memory map region: a PT_LOAD per run of blocks with data, one without file contents
+// per run of all-zero blocks. Blocks the target refuses (CheckMem hook) are left out
+MGDB_TPL static void minigdbstubCoreRegion(mgdbProcObj *mgdbObj, mgdbCoreWriter *core,
+                                           const mgdbMemRegion *region)
+{
+    unsigned int flags = (region->type == MGDB_MEM_ROM) ? 5 : 6;  // PF_R | PF_X, PF_R | PF_W
+    unsigned char block[MGDB_CORE_BLOCK];
+    int run          = 0;  // Blocks in the current run: 0 - none, 1 - data, 2 - zero
+    size_t runAddr   = 0;
+    size_t runOffset = 0;
+    for (size_t done = 0;; done += MGDB_CORE_BLOCK)
     {
-        MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, itoaBuff[bufferPtr]), mgdbObj);
-        ++bufferPtr;
+        size_t addr  = region->start + done;
+        size_t len   = (done < region->length) ? region->length - done : 0;
+        len          = (len > MGDB_CORE_BLOCK) ? MGDB_CORE_BLOCK : len;
+        size_t avail = len;
+        int next     = 0;
+        if ((len > 0) && !minigdbstubMemCheck MGDB_T(mgdbObj, addr, &avail, 0) && (avail == len))
+        {
+            unsigned char any = 0;
+            for (size_t i = 0; i < len; ++i)
+            {
+                block[i] = MGDB_USR_CALL(ReadMem)(addr + i, mgdbObj->usrData);
+                any |= block[i];
+            }
+            next = any ? 1 : 2;
+        }
+        if ((next != run) && run)
+        {
+            size_t size = addr - runAddr;
+            MGDB_CHECK_RET(minigdbstubCorePhdr(core, 1, flags, runOffset, runAddr,
+                                               (run == 1) ? size : 0, size),
+                           mgdbObj);  // PT_LOAD
+        }
+        if (next != run)
+        {
+            run       = next;
+            runAddr   = addr;
+            runOffset = core->pos;
+        }
+        if (next == 1)
+        {
+            minigdbstubCoreWrite(core, block, len);
+            core->dataBytes += len;
+        }
+        core->zeroBytes += (next == 2) ? len : 0;
+        if (len == 0)
+        {
+            return;
+        }
     }
-    MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, '#'), mgdbObj);
+}
 
-    // Add the two checksum hex chars
-    char checksumHex[8] = {0, 0, 0, 0, 0, 0, 0, 0};
-    minigdbstubComputeChecksum(&sendPkt.buffer[1], bufferPtr + 1, checksumHex);
-    MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, checksumHex[0]), mgdbObj);
-    MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, checksumHex[1]), mgdbObj);
-    MGDB_CHECK_RET(insertDynCharBuffer(&sendPkt, 0), mgdbObj);
+// Write an ELF core of the stopped target to path in one front-to-back pass - only the ELF header
+// is rewritten at the end, once the program header table (at the end of the file) is known
+MGDB_TPL static int minigdbstubDumpCore(mgdbProcObj *mgdbObj, const char *path,
+                                        mgdbCoreWriter *core)
+{
+    const mgdbCoreInfo *info = mgdbObj->coreInfo;
+    unsigned char ehdr[64]   = {0};
+    size_t ehdrSize          = info->is64 ? 64 : 52;
+    memset(core, 0, sizeof(*core));
+    core->is64 = info->is64;
+    if (!mgdbObj->memMap || (info->gregSize > 8))
+    {
+        return MGDB_BAD_FORMAT;
+    }
+    DynCharBuffer note = {0};
+    int err            = initDynCharBuffer(&note, 256);
+    if ((err != MGDB_SUCCESS) ||
+        ((err = initDynCharBuffer(&core->phdrs, 64 * 8)) != MGDB_SUCCESS))
+    {
+        freeDynCharBuffer(&note);
+        return err;
+    }
+    core->file = fopen(path, "wb");
+    err        = core->file ? minigdbstubCoreNote MGDB_T(mgdbObj, &note) : MGDB_IO_FAILED;
+    if (err == MGDB_SUCCESS)
+    {
+        minigdbstubCoreWrite(core, ehdr, ehdrSize);  // Placeholder
+        err = minigdbstubCorePhdr(core, 4, 4, core->pos, 0, note.used, 0);  // PT_NOTE, PF_R
+        minigdbstubCoreWrite(core, note.buffer, note.used);
+    }
+    // Region errors stay on the session like any other packet's. One the session already had is
+    // returned before MGDB_CHECK_RET in a region can overwrite it
+    err = (err == MGDB_SUCCESS) ? mgdbObj->err : err;
+    for (size_t i = 0; (err == MGDB_SUCCESS) && (i < mgdbObj->memMap->count); ++i)
+    {
+        minigdbstubCoreRegion MGDB_T(mgdbObj, core, &mgdbObj->memMap->regions[i]);
+        err = mgdbObj->err;
+    }
+    if (err == MGDB_SUCCESS)
+    {
+        static const unsigned char pad[8] = {0};
+        unsigned char shdr[64]            = {0};
+        minigdbstubCoreWrite(core, pad, (8 - (core->pos & 7)) & 7);
+        size_t phoff = core->pos;
+        minigdbstubCoreWrite(core, core->phdrs.buffer, core->phdrs.used);
+        size_t shoff = (core->phnum < 0xffff) ? 0 : core->pos;
+        if (shoff)
+        {
+            // Section header 0 holds the real program header count
+            minigdbstubCorePut(&shdr[info->is64 ? 44 : 28], core->phnum, 4);  // sh_info
+            minigdbstubCoreWrite(core, shdr, info->is64 ? 64 : 40);
+        }
+        minigdbstubCoreEhdr(info, ehdr, phoff, core->phnum, shoff);
+        core->failed |= (fseek(core->file, 0, SEEK_SET) != 0);
+        core->failed |= (fwrite(ehdr, 1, ehdrSize, core->file) != ehdrSize);
+    }
+    if (core->file)
+    {
+        core->failed |= (fclose(core->file) != 0);
+    }
+    freeDynCharBuffer(&note);
+    freeDynCharBuffer(&core->phdrs);
+    return ((err == MGDB_SUCCESS) && core->failed) ? MGDB_IO_FAILED : err;
+}
 
-    minigdbstubSend((const char *)sendPkt.buffer, mgdbObj);
-    freeDynCharBuffer(&sendPkt);
+// 'O' packet - text shown on GDB's console while a monitor command runs
+MGDB_TPL static void minigdbstubSendConsole(mgdbProcObj *mgdbObj, const char *text)
+{
+    size_t len        = strlen(text);
+    DynCharBuffer hex = {0};
+    MGDB_CHECK_RET(initDynCharBuffer(&hex, (len * 2) + 1), mgdbObj);
+    hex.buffer[0] = 'O';
+    minigdbstubEncodeRegBytes(&hex.buffer[1], text, len, 0);
+    minigdbstubSendPayload MGDB_T(hex.buffer, (len * 2) + 1, mgdbObj);
+    freeDynCharBuffer(&hex);
 }
 
-static void minigdbstubProcessBreakpoint(mgdbProcObj *mgdbObj, gdbPacket *recvPkt, int type)
+// Count a sample at pc - safe to call from any number of threads at once
+static void minigdbstubProfileSample(mgdbProfile *prof, size_t pc)
 {
-    int offset = 0;
-    size_t address;
-    for (int i = 0; recvPkt->pktData.buffer[i] != 0; ++i)
+    size_t mask = prof->capacity - 1;
+    size_t key  = pc + 1;
+    size_t slot = (size_t)((pc * 0x9e3779b97f4a7c15ULL) >> 32);  // Spreads nearby addresses
+    MGDB_ATOMIC_FETCH_ADD(&prof->samples, 1);
+    for (size_t probes = 0; probes < prof->capacity; ++probes, ++slot)
     {
-        if ((recvPkt->pktData.buffer[i] == ',') || (recvPkt->pktData.buffer[i] == ';') ||
-            (recvPkt->pktData.buffer[i] == ':'))
+        mgdbProfileEntry *entry = &prof->entries[slot & mask];
+        size_t found            = MGDB_ATOMIC_LOAD(&entry->pc);
+        if (found == 0)
         {
-            if (offset > 0)
-            {
-                recvPkt->pktData.buffer[i] = 0;
-                break;
-            }
-            offset = i + 1;
+            // Claim the free slot - or see which address another thread claimed it for
+            found = MGDB_ATOMIC_CAS(&entry->pc, 0, key) ? key : MGDB_ATOMIC_LOAD(&entry->pc);
+        }
+        if (found == key)
+        {
+            MGDB_ATOMIC_FETCH_ADD(&entry->count, 1);
+            return;
         }
     }
-    MGDB_HEX_DECODE_ASCII(&recvPkt->pktData.buffer[offset], address);
+    MGDB_ATOMIC_FETCH_ADD(&prof->dropped, 1);
+}
 
-    switch (recvPkt->pktData.buffer[2])
+// Call once per instruction while the target runs, with the pc in mgdbObj->regs up to date (with a
+// regCache, call minigdbstubProfileSample with the pc instead)
+static void minigdbstubProfileTick(mgdbProcObj *mgdbObj)
+{
+    mgdbProfile *prof = mgdbObj->profile;
+    if (--prof->countdown != 0)
     {
-        case '0':  // Software breakpoint
-            type |= MGDB_SOFT_BREAKPOINT;
-            break;
-        case '1':  // Hardware breakpoint
-            type |= MGDB_HARD_BREAKPOINT;
-            break;
-        default:  // Other breakpoint/watchpoint type (unsupported)
-            break;
+        return;
+    }
+    prof->countdown = prof->interval;
+    if (!MGDB_ATOMIC_LOAD(&prof->running))
+    {
+        return;
+    }
+    unsigned char value[sizeof(size_t)] = {0};
+    const unsigned char *src            = (const unsigned char *)&mgdbObj->regs[prof->pcOffset];
+    size_t pad = (MGDB_REG_HOST_ORDER == MGDB_REG_BIG_ENDIAN) ? sizeof(size_t) - prof->pcBytes : 0;
+    for (size_t i = 0; i < prof->pcBytes; ++i)
+    {
+        value[pad + i] = src[prof->pcSwap ? prof->pcBytes - 1 - i : i];
+    }
+    size_t pc;
+    memcpy(&pc, value, sizeof(pc));
+    minigdbstubProfileSample(prof, pc);
+}
+
+// 'profile start' - find the pc slot and clear the histogram. Returns 0 if there's no pc register
+static int minigdbstubProfileStart(mgdbProcObj *mgdbObj, size_t interval)
+{
+    mgdbProfile *prof           = mgdbObj->profile;
+    const mgdbRegLayout *layout = mgdbObj->regLayout;
+    int reg                     = prof->pcReg;
+    for (size_t i = 0; layout && (reg < 0) && (i < layout->count); ++i)
+    {
+        reg = (strcmp(layout->regs[i].name, "pc") == 0) ? (int)i : -1;
+    }
+    for (size_t i = 0; layout && (reg < 0) && (i < layout->count); ++i)
+    {
+        reg = (layout->regs[i].type && (strcmp(layout->regs[i].type, "code_ptr") == 0)) ? (int)i
+                                                                                       : -1;
     }
-    minigdbstubUsrProcessBreakpoint(type, address, mgdbObj->usrData);
+    if ((reg < 0) ||
+        !minigdbstubRegLocate(mgdbObj, reg, &prof->pcOffset, &prof->pcBytes, &prof->pcSwap) ||
+        (prof->pcBytes > sizeof(size_t)))
+    {
+        return 0;
+    }
+    memset(prof->entries, 0, prof->capacity * sizeof(mgdbProfileEntry));
+    prof->samples   = 0;
+    prof->dropped   = 0;
+    prof->interval  = interval ? interval : MGDB_PROFILE_INTERVAL;
+    prof->countdown = prof->interval;
+    MGDB_ATOMIC_STORE(&prof->running, 1);
+    return 1;
+}
 
-    // Send ACK + OK to GDB
-    minigdbstubSend(MGDB_ACK_PACKET, mgdbObj);
-    minigdbstubSend(MGDB_OK_PACKET, mgdbObj);
+static int minigdbstubProfileCompare(const void *a, const void *b)
+{
+    size_t countA = ((const mgdbProfileEntry *)a)->count;
+    size_t countB = ((const mgdbProfileEntry *)b)->count;
+    return (countA < countB) - (countA > countB);
 }
 
-// Main gdb stub process call
-static void minigdbstubProcess(mgdbProcObj *mgdbObj)
+// 'profile dump' - a summary line, then "<pc> <samples>" per address, hottest first
+MGDB_TPL static void minigdbstubProfileDump(mgdbProcObj *mgdbObj)
 {
-    if (mgdbObj->opts.o_signalOnEntry)
+    mgdbProfile *prof    = mgdbObj->profile;
+    DynCharBuffer sorted = {0}, text = {0};
+    MGDB_CHECK_RET(initDynCharBuffer(&sorted, (prof->capacity * sizeof(mgdbProfileEntry)) + 1),
+                   mgdbObj);
+    mgdbProfileEntry *entries = (mgdbProfileEntry *)sorted.buffer;
+    size_t used               = 0;
+    for (size_t i = 0; i < prof->capacity; ++i)
+    {
+        size_t key = MGDB_ATOMIC_LOAD(&prof->entries[i].pc);
+        if (key != 0)
+        {
+            entries[used].pc    = key - 1;
+            entries[used].count = MGDB_ATOMIC_LOAD(&prof->entries[i].count);
+            ++used;
+        }
+    }
+    qsort(entries, used, sizeof(mgdbProfileEntry), minigdbstubProfileCompare);
+
+    // Console output goes out about 1 KiB at a time
+    mgdbObj->err = initDynCharBuffer(&text, 1024 + 64);
+    if (mgdbObj->err != MGDB_SUCCESS)
     {
-        minigdbstubSendSignal(mgdbObj);
+        freeDynCharBuffer(&sorted);
+        return;
     }
-    // Poll and reply to packets from GDB until exit-related command
-    while (1)
+    text.used = (size_t)snprintf(text.buffer, text.size,
+                                 "%zu samples, %zu dropped, %zu addresses\n",
+                                 MGDB_ATOMIC_LOAD(&prof->samples),
+                                 MGDB_ATOMIC_LOAD(&prof->dropped), used);
+    for (size_t i = 0; (i < used) && (mgdbObj->err == MGDB_SUCCESS); ++i)
+    {
+        text.used += (size_t)snprintf(&text.buffer[text.used], text.size - text.used,
+                                      "0x%zx %zu\n", entries[i].pc, entries[i].count);
+        if ((text.used >= 1024) || (i + 1 == used))
+        {
+            minigdbstubSendConsole MGDB_T(mgdbObj, text.buffer);
+            text.used = 0;
+        }
+    }
+    if (used == 0)
     {
-        gdbPacket recvPkt;
-        MGDB_CHECK_RET(initDynCharBuffer(&recvPkt.pktData, MGDB_PKT_SIZE), mgdbObj);
-        minigdbstubRecv(mgdbObj, &recvPkt);
+        minigdbstubSendConsole MGDB_T(mgdbObj, text.buffer);
+    }
+    freeDynCharBuffer(&text);
+    freeDynCharBuffer(&sorted);
+}
 
-        switch (recvPkt.commandType)
+// qRcmd,<hex> - GDB's 'monitor' command. Commands this target doesn't have get the empty reply
+MGDB_TPL static void minigdbstubProcessMonitor(mgdbProcObj *mgdbObj, const char *hex)
+{
+    char cmd[256];
+    cmd[minigdbstubDecodeRegBytes(cmd, hex, sizeof(cmd) - 1, 0)] = 0;
+    if (mgdbObj->coreInfo && (strncmp(cmd, "dump-core ", 10) == 0))
+    {
+        mgdbCoreWriter core;
+        char msg[384];
+        int err = minigdbstubDumpCore MGDB_T(mgdbObj, &cmd[10], &core);
+        if (err == MGDB_SUCCESS)
         {
-            case 'g':
-            {  // Read registers
-                minigdbstubSendRegs(mgdbObj);
-                break;
+            snprintf(msg, sizeof(msg),
+                     "Wrote %s: %zu segments, %zu bytes of memory, %zu zero bytes left out\n",
+                     &cmd[10], core.phnum - 1, core.dataBytes, core.zeroBytes);
+        }
+        else
+        {
+            snprintf(msg, sizeof(msg), "Can't write a core to %s (error %d)\n", &cmd[10], err);
+        }
+        minigdbstubSendConsole MGDB_T(mgdbObj, msg);
+        if (err == MGDB_SUCCESS)
+        {
+            minigdbstubSend MGDB_T(MGDB_OK_PACKET, mgdbObj);
+        }
+        else
+        {
+            minigdbstubSendError MGDB_T(mgdbObj, err);
+        }
+    }
+    else if (mgdbObj->profile && (strncmp(cmd, "profile start", 13) == 0) &&
+             ((cmd[13] == 0) || (cmd[13] == ' ')))
+    {
+        char msg[96];
+        size_t interval = (size_t)strtoull(&cmd[13], NULL, 10);
+        if (minigdbstubProfileStart(mgdbObj, interval))
+        {
+            snprintf(msg, sizeof(msg), "Sampling the pc every %zu instructions\n",
+                     mgdbObj->profile->interval);
+            minigdbstubSendConsole MGDB_T(mgdbObj, msg);
+            minigdbstubSend MGDB_T(MGDB_OK_PACKET, mgdbObj);
+        }
+        else
+        {
+            minigdbstubSendConsole MGDB_T(mgdbObj, "No pc register to sample\n");
+            minigdbstubSendError MGDB_T(mgdbObj, MGDB_BAD_FORMAT);
+        }
+    }
+    else if (mgdbObj->profile && (strcmp(cmd, "profile stop") == 0))
+    {
+        char msg[96];
+        MGDB_ATOMIC_STORE(&mgdbObj->profile->running, 0);
+        snprintf(msg, sizeof(msg), "Stopped after %zu samples\n",
+                 MGDB_ATOMIC_LOAD(&mgdbObj->profile->samples));
+        minigdbstubSendConsole MGDB_T(mgdbObj, msg);
+        minigdbstubSend MGDB_T(MGDB_OK_PACKET, mgdbObj);
+    }
+    else if (mgdbObj->profile && (strcmp(cmd, "profile dump") == 0))
+    {
+        minigdbstubProfileDump MGDB_T(mgdbObj);
+        minigdbstubSend MGDB_T((mgdbObj->err == MGDB_SUCCESS) ? MGDB_OK_PACKET : MGDB_ERROR_PACKET,
+                               mgdbObj);
+    }
+    else
+    {
+        minigdbstubSend MGDB_T(MGDB_EMPTY_PACKET, mgdbObj);
+    }
+}
+
+// General query packets ('q')
+MGDB_TPL static void minigdbstubProcessQuery(mgdbProcObj *mgdbObj, gdbPacket *recvPkt)
+{
+    const char *query = recvPkt->pktData.buffer;
+    if (strncmp(query, "qSupported", 10) == 0)
+    {
+        minigdbstubSendSupported MGDB_T(mgdbObj);
+    }
+    else if (mgdbObj->regLayout && (strncmp(query, "qXfer:features:read:target.xml:", 31) == 0))
+    {
+        DynCharBuffer xml = {0};
+        MGDB_CHECK_RET(initDynCharBuffer(&xml, 1024), mgdbObj);
+        minigdbstubTargetXml(mgdbObj, &xml);
+        if (mgdbObj->err == MGDB_SUCCESS)
+        {
+            minigdbstubSendXfer MGDB_T(mgdbObj, &query[31], &xml);
+        }
+        freeDynCharBuffer(&xml);
+    }
+    else if (mgdbObj->memMap && (strncmp(query, "qXfer:memory-map:read::", 23) == 0))
+    {
+        DynCharBuffer xml = {0};
+        MGDB_CHECK_RET(initDynCharBuffer(&xml, 256), mgdbObj);
+        minigdbstubMemoryMapXml(mgdbObj, &xml);
+        if (mgdbObj->err == MGDB_SUCCESS)
+        {
+            minigdbstubSendXfer MGDB_T(mgdbObj, &query[23], &xml);
+        }
+        freeDynCharBuffer(&xml);
+    }
+    else if (strncmp(query, "qRcmd,", 6) == 0)
+    {
+        minigdbstubProcessMonitor MGDB_T(mgdbObj, &query[6]);
+    }
+    else if ((strcmp(query, "qAttached") == 0) || (strncmp(query, "qAttached:", 10) == 0))
+    {
+        // The target outlives the session - GDB detaches on quit instead of killing it
+        minigdbstubSendPayload MGDB_T("1", 1, mgdbObj);
+    }
+    else if (mgdbObj->tracepoints && (strcmp(query, "qTStatus") == 0))
+    {
+        minigdbstubSendTraceStatus MGDB_T(mgdbObj);
+    }
+    else if (mgdbObj->threads && (strcmp(query, "qfThreadInfo") == 0))
+    {
+        minigdbstubSendThreadList MGDB_T(mgdbObj);
+    }
+    else if (mgdbObj->threads && (strcmp(query, "qsThreadInfo") == 0))
+    {
+        minigdbstubSendPayload MGDB_T("l", 1, mgdbObj);  // Whole list went out in qfThreadInfo
+    }
+    else if (mgdbObj->threads && (strcmp(query, "qC") == 0))
+    {
+        char reply[24];
+        int len = snprintf(reply, sizeof(reply), "QC%zx",
+                           mgdbObj->threads->threads[mgdbObj->threads->current].id);
+        minigdbstubSendPayload MGDB_T(reply, len, mgdbObj);
+    }
+    else
+    {
+        minigdbstubSend MGDB_T(MGDB_EMPTY_PACKET, mgdbObj);
+    }
+}
+
+// Let the target run on without GDB - 'D', or a connection that dropped. Breakpoints, tracepoints,
+// snapshots and the rest of the session state stay where they are for the next GDB. resume is 0
+// when the target is already running and only the session state needs clearing
+MGDB_TPL static void minigdbstubDetach(mgdbProcObj *mgdbObj, int resume)
+{
+    minigdbstubRegCacheFlush MGDB_T(mgdbObj);
+    minigdbstubSnapshotResume(mgdbObj);
+    minigdbstubBreakpointSweep MGDB_T(mgdbObj);
+    if (mgdbObj->tracepoints)
+    {
+        mgdbObj->tracepoints->selected = -1;  // Back to the live target
+    }
+    if (mgdbObj->threads)
+    {
+        mgdbObj->threads->nonStop  = 0;  // A new GDB starts in all-stop mode
+        mgdbObj->threads->notified = 0;
+    }
+    mgdbObj->detached = 1;
+    minigdbstubFlush MGDB_T(mgdbObj);
+    if (resume)
+    {
+        MGDB_USR_CALL(Continue)(mgdbObj->usrData);
+    }
+}
+
+// The first packet after a detach - a new GDB picks up the target as it was left. Breakpoints it
+// doesn't send again are swept when it first resumes the target
+static void minigdbstubAttach(mgdbProcObj *mgdbObj)
+{
+    mgdbObj->detached = 0;
+    ++mgdbObj->reattaches;
+    if (mgdbObj->breakpoints)
+    {
+        ++mgdbObj->breakpoints->generation;
+    }
+}
+
+// Handle one received packet - returns 1 once control goes back to the target
+MGDB_TPL static int minigdbstubDispatch(mgdbProcObj *mgdbObj, gdbPacket *recvPkt)
+{
+    if (mgdbObj->detached && (recvPkt->commandType != 'D'))
+    {
+        minigdbstubAttach(mgdbObj);
+    }
+    switch (recvPkt->commandType)
+    {
+        case 'g':
+        {  // Read registers (from the trace frame GDB is looking at, if any)
+            if (minigdbstubTraceFrameSelected(mgdbObj))
+            {
+                minigdbstubTraceSendFrameRegs MGDB_T(mgdbObj, NULL);
             }
-            case 'G':
-            {  // Write registers
-                minigdbstubWriteRegs(mgdbObj, &recvPkt);
-                break;
+            else
+            {
+                minigdbstubSendRegs MGDB_T(mgdbObj);
             }
-            case 'p':
-            {  // Read one register
-                minigdbstubSendReg(mgdbObj, &recvPkt);
-                break;
+            break;
+        }
+        case 'G':
+        {  // Write registers
+            gdbPacket hexPkt      = *recvPkt;
+            hexPkt.pktData.buffer = &recvPkt->pktData.buffer[1];
+            minigdbstubWriteRegs MGDB_T(mgdbObj, &hexPkt);
+            break;
+        }
+        case 'p':
+        {  // Read one register
+            if (minigdbstubTraceFrameSelected(mgdbObj))
+            {
+                minigdbstubTraceSendFrameRegs MGDB_T(mgdbObj, recvPkt);
             }
-            case 'P':
-            {  // Write one register
-                minigdbstubWriteReg(mgdbObj, &recvPkt);
-                break;
+            else
+            {
+                minigdbstubSendReg MGDB_T(mgdbObj, recvPkt);
             }
-            case 'm':
-            {  // Read mem
-                minigdbstubReadMem(mgdbObj, &recvPkt);
-                break;
+            break;
+        }
+        case 'P':
+        {  // Write one register
+            minigdbstubWriteReg MGDB_T(mgdbObj, recvPkt);
+            break;
+        }
+        case 'm':
+        {  // Read mem
+            if (minigdbstubTraceFrameSelected(mgdbObj))
+            {
+                minigdbstubTraceSendFrameMem MGDB_T(mgdbObj, recvPkt);
             }
-            case 'M':
-            {  // Write mem
-                minigdbstubWriteMem(mgdbObj, &recvPkt);
-                break;
+            else
+            {
+                minigdbstubReadMem MGDB_T(mgdbObj, recvPkt);
             }
-            case 'c':
-            {  // Continue
-                minigdbstubUsrContinue(mgdbObj->usrData);
-                return;
+            break;
+        }
+        case 'M':
+        {  // Write mem
+            minigdbstubWriteMem MGDB_T(mgdbObj, recvPkt);
+            break;
+        }
+        case 'c':
+        {  // Continue
+            minigdbstubRegCacheFlush MGDB_T(mgdbObj);
+            minigdbstubSnapshotResume(mgdbObj);
+            minigdbstubBreakpointSweep MGDB_T(mgdbObj);
+            minigdbstubFlush MGDB_T(mgdbObj);
+            MGDB_USR_CALL(Continue)(mgdbObj->usrData);
+            return 1;
+        }
+        case 's':
+        {  // Step
+            minigdbstubRegCacheFlush MGDB_T(mgdbObj);
+            minigdbstubSnapshotResume(mgdbObj);
+            minigdbstubBreakpointSweep MGDB_T(mgdbObj);
+            minigdbstubFlush MGDB_T(mgdbObj);
+            MGDB_USR_CALL(Step)(mgdbObj->usrData);
+            return 1;
+        }
+        case 'b':
+        {  // Reverse step/continue
+            if (mgdbObj->snapshots &&
+                ((recvPkt->pktData.buffer[1] == 's') || (recvPkt->pktData.buffer[1] == 'c')))
+            {
+                return minigdbstubProcessReverse MGDB_T(mgdbObj, recvPkt->pktData.buffer[1] == 's');
             }
-            case 's':
-            {  // Step
-                minigdbstubUsrStep(mgdbObj->usrData);
-                return;
+            minigdbstubSend MGDB_T(MGDB_EMPTY_PACKET, mgdbObj);
+            break;
+        }
+        case 'Z':
+        {  // Place breakpoint
+            minigdbstubProcessBreakpoint MGDB_T(mgdbObj, recvPkt, MGDB_SET_BREAKPOINT);
+            break;
+        }
+        case 'z':
+        {  // Remove breakpoint
+            minigdbstubProcessBreakpoint MGDB_T(mgdbObj, recvPkt, MGDB_CLEAR_BREAKPOINT);
+            break;
+        }
+        case 'D':
+        {  // Detach - the target runs on
+            minigdbstubSend MGDB_T(MGDB_OK_PACKET, mgdbObj);
+            minigdbstubDetach MGDB_T(mgdbObj, 1);
+            return 1;
+        }
+        case '!':
+        {  // Extended mode - lets GDB attach (vAttach) after connecting
+            minigdbstubSend MGDB_T(MGDB_OK_PACKET, mgdbObj);
+            break;
+        }
+        case 'k':
+        {  // Kill session
+            minigdbstubRegCacheFlush MGDB_T(mgdbObj);
+            minigdbstubFlush MGDB_T(mgdbObj);
+            MGDB_USR_CALL(KillSession)(mgdbObj->usrData);
+            return 1;
+        }
+        case 'q':
+        {  // General query
+            minigdbstubProcessQuery MGDB_T(mgdbObj, recvPkt);
+            break;
+        }
+        case 'Q':
+        {  // General set - non-stop mode, tracepoints
+            if (mgdbObj->threads && (strncmp(recvPkt->pktData.buffer, "QNonStop:", 9) == 0))
+            {
+                mgdbObj->threads->nonStop  = (recvPkt->pktData.buffer[9] == '1');
+                mgdbObj->threads->notified = 0;
+                minigdbstubSend MGDB_T(MGDB_OK_PACKET, mgdbObj);
             }
-            case 'Z':
-            {  // Place breakpoint
-                minigdbstubProcessBreakpoint(mgdbObj, &recvPkt, MGDB_SET_BREAKPOINT);
-                break;
+            else
+            {
+                minigdbstubProcessTracepoint MGDB_T(mgdbObj, recvPkt);
             }
-            case 'z':
-            {  // Remove breakpoint
-                minigdbstubProcessBreakpoint(mgdbObj, &recvPkt, MGDB_CLEAR_BREAKPOINT);
-                break;
+            break;
+        }
+        case 'H':
+        {  // Set thread
+            if (mgdbObj->threads)
+            {
+                minigdbstubProcessThreadSelect MGDB_T(mgdbObj, recvPkt);
             }
-            case 'k':
-            {  // Kill session
-                minigdbstubUsrKillSession(mgdbObj->usrData);
-                return;
+            else
+            {
+                minigdbstubSend MGDB_T(MGDB_EMPTY_PACKET, mgdbObj);
             }
-            case '?':
-            {  // Indicate reason why target halted
-                minigdbstubSendSignal(mgdbObj);
-                break;
-                ;
+            break;
+        }
+        case 'T':
+        {  // Thread alive
+            if (mgdbObj->threads)
+            {
+                size_t id = strtoul(&recvPkt->pktData.buffer[1], NULL, 16);
+                int alive = (minigdbstubThreadFind(mgdbObj->threads, id) != NULL);
+                minigdbstubSend MGDB_T(alive ? MGDB_OK_PACKET : MGDB_ERROR_PACKET, mgdbObj);
             }
-            default:
-            {  // Command unsupported
-                minigdbstubSend(MGDB_EMPTY_PACKET, mgdbObj);
-                break;
+            else
+            {
+                minigdbstubSend MGDB_T(MGDB_EMPTY_PACKET, mgdbObj);
             }
+            break;
+        }
+        case 'v':
+        {  // vCont, vStopped
+            return minigdbstubProcessV MGDB_T(mgdbObj, recvPkt);
+        }
+        case '?':
+        {  // Indicate reason why target halted
+            minigdbstubSendStatus MGDB_T(mgdbObj);
+            break;
+        }
+        default:
+        {  // Command unsupported
+            minigdbstubSend MGDB_T(MGDB_EMPTY_PACKET, mgdbObj);
+            break;
         }
-        // Cleanup packet mem
-        freeDynCharBuffer(&recvPkt.pktData);
+    }
+    return 0;
+}
+
+// Receive and handle a single packet - event-driven callers can use this directly once a full
+// packet is buffered. Returns 1 once control goes back to the target (or on error)
+MGDB_TPL static int minigdbstubProcessPacket(mgdbProcObj *mgdbObj)
+{
+    gdbPacket recvPkt;
+    mgdbObj->err = initDynCharBuffer(&recvPkt.pktData, MGDB_PKT_SIZE);
+    if (mgdbObj->err != MGDB_SUCCESS)
+    {
+        return 1;
+    }
+    minigdbstubRecv MGDB_T(mgdbObj, &recvPkt);
+    int resume =
+        (mgdbObj->err == MGDB_SUCCESS) ? minigdbstubDispatch MGDB_T(mgdbObj, &recvPkt) : 1;
+
+    // Cleanup packet mem
+    freeDynCharBuffer(&recvPkt.pktData);
+    return resume;
+}
+
+// Main gdb stub process call
+MGDB_TPL static void minigdbstubProcess(mgdbProcObj *mgdbObj)
+{
+    if (mgdbObj->opts.o_signalOnEntry)
+    {
+        minigdbstubSendSignal MGDB_T(mgdbObj);
+    }
+    // Poll and reply to packets from GDB until exit-related command
+    while (!minigdbstubProcessPacket MGDB_T(mgdbObj))
+    {
     }
 }
@@ -0,0 +1,199 @@
+#pragma once
+
+// C++ front-end for minigdbstub.
+//
+// mgdb::Stub<Target> binds the stub to a target type whose hooks are ordinary member functions.
+// The hooks are resolved at compile time, so memory and register accessors can be inlined into the
+// packet handlers and any number of target types can live in one binary (or one translation unit).
+// Target must provide:
+//     void putChar(char data);
+//     char getChar();
+//     void writeMem(size_t addr, unsigned char data);
+//     unsigned char readMem(size_t addr);
+//     void cont();
+//     void step();
+//     void processBreakpoint(int type, size_t addr);
+//     void killSession();
+//     void flush();  // Optional - called at reply boundaries
+//     void resumeThread(size_t threadId, int step);  // Optional - per-thread control for
+//     void stopThread(size_t threadId);              // mgdbProcObj::threads (non-stop mode)
+//     void readReg(size_t index, char *value);         // Optional - lazy register access for
+//     void writeReg(size_t index, const char *value);  // mgdbProcObj::regCache
+//     int checkMem(size_t addr, size_t len, int write);  // Optional - 0 or an error number
+//
+// Define MGDB_NO_USR_HOOKS before including this header in translation units that don't also
+// implement the C minigdbstubUsr* hooks.
+
+#include "minigdbstub.h"
+
+namespace mgdb
+{
+// Hooks class passed to the minigdbstub* templates - usrData is the Target
+template <class Target>
+struct TargetHooks
+{
+    static Target *target(void *usrData) { return static_cast<Target *>(usrData); }
+
+    static void Putchar(char data, void *usrData) { target(usrData)->putChar(data); }
+    static char Getchar(void *usrData) { return target(usrData)->getChar(); }
+    static void WriteMem(size_t addr, unsigned char data, void *usrData)
+    {
+        target(usrData)->writeMem(addr, data);
+    }
+    static unsigned char ReadMem(size_t addr, void *usrData)
+    {
+        return target(usrData)->readMem(addr);
+    }
+    static void Continue(void *usrData) { target(usrData)->cont(); }
+    static void Step(void *usrData) { target(usrData)->step(); }
+    static void ProcessBreakpoint(int type, size_t addr, void *usrData)
+    {
+        target(usrData)->processBreakpoint(type, addr);
+    }
+    static void KillSession(void *usrData) { target(usrData)->killSession(); }
+    static void Flush(void *usrData) { flush(target(usrData), 0); }
+    static void ResumeThread(size_t threadId, int step, void *usrData)
+    {
+        resumeThread(target(usrData), threadId, step, 0);
+    }
+    static void StopThread(size_t threadId, void *usrData)
+    {
+        stopThread(target(usrData), threadId, 0);
+    }
+    static void ReadReg(size_t index, char *value, void *usrData)
+    {
+        readReg(target(usrData), index, value, 0);
+    }
+    static void WriteReg(size_t index, const char *value, void *usrData)
+    {
+        writeReg(target(usrData), index, value, 0);
+    }
+    static int CheckMem(size_t addr, size_t len, int write, void *usrData)
+    {
+        return checkMem(target(usrData), addr, len, write, 0);
+    }
+
+  private:
+    // Pick Target::flush() when it exists, otherwise do nothing
+    template <class T>
+    static auto flush(T *t, int) -> decltype(t->flush(), void())
+    {
+        t->flush();
+    }
+    template <class T>
+    static void flush(T *, long)
+    {
+    }
+
+    // Pick Target::resumeThread()/stopThread() when they exist, otherwise the whole target
+    // continues/steps and threads can't be interrupted
+    template <class T>
+    static auto resumeThread(T *t, size_t threadId, int step, int)
+        -> decltype(t->resumeThread(threadId, step), void())
+    {
+        t->resumeThread(threadId, step);
+    }
+    template <class T>
+    static void resumeThread(T *t, size_t, int step, long)
+    {
+        step ? t->step() : t->cont();
+    }
+    template <class T>
+    static auto stopThread(T *t, size_t threadId, int) -> decltype(t->stopThread(threadId), void())
+    {
+        t->stopThread(threadId);
+    }
+    template <class T>
+    static void stopThread(T *, size_t, long)
+    {
+    }
+
+    // Pick Target::readReg()/writeReg() when they exist - without them mgdbProcObj::regs is used
+    // as is, so a regCache would leave the register file unfilled
+    template <class T>
+    static auto readReg(T *t, size_t index, char *value, int)
+        -> decltype(t->readReg(index, value), void())
+    {
+        t->readReg(index, value);
+    }
+    template <class T>
+    static void readReg(T *, size_t, char *, long)
+    {
+    }
+    template <class T>
+    static auto writeReg(T *t, size_t index, const char *value, int)
+        -> decltype(t->writeReg(index, value), void())
+    {
+        t->writeReg(index, value);
+    }
+    template <class T>
+    static void writeReg(T *, size_t, const char *, long)
+    {
+    }
+
+    // Pick Target::checkMem() when it exists, otherwise every access is allowed
+    template <class T>
+    static auto checkMem(T *t, size_t addr, size_t len, int write, int)
+        -> decltype(t->checkMem(addr, len, write))
+    {
+        return t->checkMem(addr, len, write);
+    }
+    template <class T>
+    static int checkMem(T *, size_t, size_t, int, long)
+    {
+        return 0;
+    }
+};
+
+template <class Target>
+class Stub
+{
+  public:
+    typedef TargetHooks<Target> Hooks;
+
+    Stub(Target &target, void *regs, size_t regsSize, size_t regsCount) : mgdbObj()
+    {
+        mgdbObj.regs      = (char *)regs;
+        mgdbObj.regsSize  = regsSize;
+        mgdbObj.regsCount = regsCount;
+        mgdbObj.usrData   = &target;
+    }
+
+    // Registers described by a layout (see MGDB_REG_DESC) instead of a uniform width
+    Stub(Target &target, void *regs, const mgdbRegLayout &layout) : mgdbObj()
+    {
+        mgdbObj.regs      = (char *)regs;
+        mgdbObj.regsSize  = minigdbstubRegLayoutSize(&layout);
+        mgdbObj.regsCount = layout.count;
+        mgdbObj.regLayout = &layout;
+        mgdbObj.usrData   = &target;
+    }
+
+    // Same as minigdbstubProcess - poll and reply to packets until control goes back to the target
+    void process() { minigdbstubProcess<Hooks>(&mgdbObj); }
+
+    // Same as minigdbstubProcessPacket - returns 1 once control goes back to the target
+    int processPacket() { return minigdbstubProcessPacket<Hooks>(&mgdbObj); }
+
+    // Report a stop to GDB (e.g. after a 'c' hits a breakpoint)
+    void sendSignal(int signalNum)
+    {
+        mgdbObj.signalNum = signalNum;
+        minigdbstubSendSignal<Hooks>(&mgdbObj);
+        minigdbstubFlush<Hooks>(&mgdbObj);
+    }
+
+    // Same as minigdbstubThreadStopped - report a thread stop (a %Stop notification in non-stop mode)
+    void threadStopped(size_t threadId, int signalNum)
+    {
+        minigdbstubThreadStopped<Hooks>(&mgdbObj, threadId, signalNum);
+    }
+
+    Target &target() { return *Hooks::target(mgdbObj.usrData); }
+    mgdbProcObj &obj() { return mgdbObj; }  // Options, signal, trace ring, I/O tap
+    int err() const { return mgdbObj.err; }
+
+  private:
+    mgdbProcObj mgdbObj;
+};
+}  // namespace mgdb
@@ -0,0 +1,298 @@
+#pragma once
+
+// Dedicated debug thread companion for minigdbstub (Linux).
+//
+// minigdbstubProcess is synchronous: the thread that calls it owns both the connection and the
+// target until GDB resumes it, so every network stall is an emulation stall. With this header the
+// stub's command loop runs on its own thread (minigdbstubDebugServe) and talks to the target thread
+// through two single-producer/single-consumer lock-free queues - halt/resume/step/kill commands one
+// way, stop events the other.
+//
+// The target checks for commands at safe points with minigdbstubDebugPoll (one load while nothing
+// is pending) and parks in minigdbstubDebugStopped whenever it stops. Register and memory accesses
+// from the stub's hooks are serviced while it is parked there: the target thread touches none of
+// its state again until a command releases it, and the queues order those accesses before its
+// own. While the target runs, the debug thread watches the connection and turns input (GDB's ^C)
+// into a halt. Transports that read ahead (minigdbstub_socket.h) can hide that byte from the
+// connection, so the link also asks inputPending about input already buffered in user space.
+//
+// A waiting side spins for mgdbDebugLink.spin polls before it sleeps on an eventfd, and producers
+// only signal the eventfd when the consumer is actually asleep, so handoffs between two busy threads
+// are system call free.
+//
+// The target's Continue/Step/KillSession hooks forward to minigdbstubDebugCommand, e.g.
+//     static void minigdbstubUsrStep(void *usrData)
+//     {
+//         minigdbstubDebugCommand(&((myTarget *)usrData)->link, MGDB_DEBUG_STEP);
+//     }
+
+#include "minigdbstub.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#ifndef MGDB_DEBUG_QUEUE_SIZE
+#    define MGDB_DEBUG_QUEUE_SIZE 16  // Messages per queue (must be a power of 2)
+#endif
+#ifndef MGDB_DEBUG_SPIN
+#    define MGDB_DEBUG_SPIN 20000  // Queue polls before a waiting side goes to sleep
+#endif
+#define MGDB_CACHE_LINE 64
+
+// Message types
+enum
+{
+    MGDB_DEBUG_HALT = 1,  // Debug thread -> target
+    MGDB_DEBUG_RESUME,    // ...
+    MGDB_DEBUG_STEP,      // ...
+    MGDB_DEBUG_KILL,      // ...
+    MGDB_DEBUG_STOPPED    // Target -> debug thread
+};
+
+typedef struct
+{
+    int type;
+    int signalNum;  // MGDB_DEBUG_STOPPED
+} mgdbDebugMsg;
+
+typedef struct
+{
+    size_t head;  // Total pushed - written by the producer only
+    char producerPad[MGDB_CACHE_LINE - sizeof(size_t)];
+    size_t tail;   // Total popped - written by the consumer only
+    int sleeping;  // The consumer is (about to be) blocked on the eventfd
+    char consumerPad[MGDB_CACHE_LINE - sizeof(size_t) - sizeof(int)];
+    mgdbDebugMsg slots[MGDB_DEBUG_QUEUE_SIZE];
+} mgdbSpscQueue;
+
+typedef struct
+{
+    mgdbSpscQueue commands;  // Debug thread -> target
+    mgdbSpscQueue events;    // Target -> debug thread
+    int commandFd;           // eventfd - wakes a parked target
+    int eventFd;             // eventfd - wakes the debug thread
+    int inputFd;             // Connection watched for interrupts while the target runs (-1: none)
+    int spin;                // Queue polls before sleeping (MGDB_DEBUG_SPIN, 0 on one CPU)
+    int running;             // Debug thread only - the target was resumed and hasn't stopped yet
+    int haltSent;            // Debug thread only - a halt is on its way to the target
+    int killed;              // Debug thread only - the session is over
+    size_t stops;            // Stop events served by the debug thread
+
+    // Optional - nonzero when the transport already holds unread input, e.g.
+    // minigdbstubSockInputPending with the mgdbSockConn as data
+    int (*inputPending)(void *inputData);
+    void *inputData;
+} mgdbDebugLink;
+
+// ====================================================================================================================
+// SPSC queue
+// ====================================================================================================================
+// Returns 1 if the message was queued, 0 if the queue is full
+static int minigdbstubSpscPush(mgdbSpscQueue *q, const mgdbDebugMsg *msg)
+{
+    size_t head = q->head;
+    if (head - MGDB_ATOMIC_LOAD(&q->tail) == MGDB_DEBUG_QUEUE_SIZE)
+    {
+        return 0;
+    }
+    q->slots[head & (MGDB_DEBUG_QUEUE_SIZE - 1)] = *msg;
+    MGDB_ATOMIC_STORE(&q->head, head + 1);
+    return 1;
+}
+
+// Returns 1 if a message was dequeued, 0 if the queue is empty
+static int minigdbstubSpscPop(mgdbSpscQueue *q, mgdbDebugMsg *msg)
+{
+    size_t tail = q->tail;
+    if (MGDB_ATOMIC_LOAD(&q->head) == tail)
+    {
+        return 0;
+    }
+    *msg = q->slots[tail & (MGDB_DEBUG_QUEUE_SIZE - 1)];
+    MGDB_ATOMIC_STORE(&q->tail, tail + 1);
+    return 1;
+}
+
+// ====================================================================================================================
+// Handoff
+// ====================================================================================================================
+static int minigdbstubDebugLinkInit(mgdbDebugLink *link, int inputFd)
+{
+    memset(link, 0, sizeof(*link));
+    link->commandFd = eventfd(0, EFD_CLOEXEC);
+    link->eventFd   = eventfd(0, EFD_CLOEXEC);
+    link->inputFd   = inputFd;
+    // Spinning on a single core only delays the thread we're waiting for
+    link->spin = (sysconf(_SC_NPROCESSORS_ONLN) > 1) ? MGDB_DEBUG_SPIN : 0;
+    return ((link->commandFd >= 0) && (link->eventFd >= 0)) ? MGDB_SUCCESS : MGDB_IO_FAILED;
+}
+
+static void minigdbstubDebugLinkClose(mgdbDebugLink *link)
+{
+    close(link->commandFd);
+    close(link->eventFd);
+    link->commandFd = link->eventFd = -1;
+}
+
+// Queue a message and wake the consumer if it sleeps - the fences pair with the consumer's, so
+// either it sees the message before sleeping or we see it asleep
+static void minigdbstubDebugSend(mgdbSpscQueue *q, int fd, int type, int signalNum)
+{
+    mgdbDebugMsg msg;
+    msg.type      = type;
+    msg.signalNum = signalNum;
+    while (!minigdbstubSpscPush(q, &msg))
+    {
+        sched_yield();
+    }
+    MGDB_ATOMIC_FENCE();
+    if (__atomic_load_n(&q->sleeping, __ATOMIC_RELAXED))
+    {
+        uint64_t one = 1;
+        ssize_t ret  = write(fd, &one, sizeof(one));
+        (void)ret;
+    }
+}
+
+// Wait for a message on q, spinning first - returns 1 with the message, or 0 as soon as inputFd
+// (if >= 0) is readable
+static int minigdbstubDebugWait(mgdbDebugLink *link, mgdbSpscQueue *q, int fd, int inputFd,
+                                mgdbDebugMsg *msg)
+{
+    while (1)
+    {
+        for (int i = 0; i < link->spin; ++i)
+        {
+            if (minigdbstubSpscPop(q, msg))
+            {
+                return 1;
+            }
+        }
+        __atomic_store_n(&q->sleeping, 1, __ATOMIC_RELAXED);
+        MGDB_ATOMIC_FENCE();
+        if (minigdbstubSpscPop(q, msg))
+        {
+            __atomic_store_n(&q->sleeping, 0, __ATOMIC_RELAXED);
+            return 1;
+        }
+        struct pollfd pfds[2];
+        pfds[0].fd      = fd;
+        pfds[0].events  = POLLIN;
+        pfds[0].revents = 0;
+        pfds[1].fd      = inputFd;  // Ignored by poll() when negative
+        pfds[1].events  = POLLIN;
+        pfds[1].revents = 0;
+        int ret         = poll(pfds, 2, -1);
+        __atomic_store_n(&q->sleeping, 0, __ATOMIC_RELAXED);
+        if ((ret < 0) && (errno != EINTR))
+        {
+            msg->type = MGDB_DEBUG_KILL;  // Can't wait any more - let both sides wind down
+            return 1;
+        }
+        if (pfds[0].revents & POLLIN)
+        {
+            uint64_t count;
+            ssize_t n = read(fd, &count, sizeof(count));
+            (void)n;
+        }
+        if (pfds[1].revents & (POLLIN | POLLHUP | POLLERR))
+        {
+            return minigdbstubSpscPop(q, msg);  // A message that arrived meanwhile wins
+        }
+    }
+}
+
+// ====================================================================================================================
+// Target thread
+// ====================================================================================================================
+// Report a stop (breakpoint, finished step, fault, ...) and park until the debug thread hands
+// control back - returns MGDB_DEBUG_RESUME, MGDB_DEBUG_STEP or MGDB_DEBUG_KILL. Call it once before
+// running so that GDB finds the target halted when it connects
+static int minigdbstubDebugStopped(mgdbDebugLink *link, int signalNum)
+{
+    minigdbstubDebugSend(&link->events, link->eventFd, MGDB_DEBUG_STOPPED, signalNum);
+    mgdbDebugMsg msg;
+    do
+    {
+        minigdbstubDebugWait(link, &link->commands, link->commandFd, -1, &msg);
+    } while (msg.type == MGDB_DEBUG_HALT);  // Raced with this stop - already halted
+    return msg.type;
+}
+
+// Call at safe points while running - returns MGDB_DEBUG_RESUME to carry on, otherwise a halt was
+// requested and this is what minigdbstubDebugStopped returned once GDB was done with the target
+static int minigdbstubDebugPoll(mgdbDebugLink *link)
+{
+    mgdbDebugMsg msg;
+    if (!minigdbstubSpscPop(&link->commands, &msg))
+    {
+        return MGDB_DEBUG_RESUME;
+    }
+    return (msg.type == MGDB_DEBUG_HALT) ? minigdbstubDebugStopped(link, SIGINT) : msg.type;
+}
+
+// ====================================================================================================================
+// Debug thread
+// ====================================================================================================================
+// Hand control to the target - call from the Continue (MGDB_DEBUG_RESUME), Step (MGDB_DEBUG_STEP)
+// and KillSession (MGDB_DEBUG_KILL) hooks
+static void minigdbstubDebugCommand(mgdbDebugLink *link, int type)
+{
+    link->killed |= (type == MGDB_DEBUG_KILL);
+    link->running = (type == MGDB_DEBUG_RESUME) || (type == MGDB_DEBUG_STEP);
+    minigdbstubDebugSend(&link->commands, link->commandFd, type, 0);
+}
+
+// Serve GDB until the session is killed, GDB detaches or the connection fails. The stub only runs
+// while the target is parked in minigdbstubDebugStopped. After a detach the target keeps running:
+// point inputFd at the next connection and call again to reattach
+MGDB_TPL static void minigdbstubDebugServe(mgdbDebugLink *link, mgdbProcObj *mgdbObj)
+{
+    int attached = 0;
+    if (link->running && !link->haltSent)
+    {
+        // Reattaching - GDB expects to find the target halted
+        minigdbstubDebugSend(&link->commands, link->commandFd, MGDB_DEBUG_HALT, 0);
+        link->haltSent = 1;
+    }
+    while (!link->killed && (mgdbObj->err == MGDB_SUCCESS))
+    {
+        mgdbDebugMsg msg;
+        int watchInput = link->running && !link->haltSent;
+        int buffered   = watchInput && link->inputPending && link->inputPending(link->inputData);
+        if (buffered || !minigdbstubDebugWait(link, &link->events, link->eventFd,
+                                              watchInput ? link->inputFd : -1, &msg))
+        {
+            // GDB wants the target back (^C) - the stub skips the interrupt byte later
+            minigdbstubDebugSend(&link->commands, link->commandFd, MGDB_DEBUG_HALT, 0);
+            link->haltSent = 1;
+            continue;
+        }
+        if (msg.type != MGDB_DEBUG_STOPPED)
+        {
+            break;
+        }
+        link->running  = 0;
+        link->haltSent = 0;
+        ++link->stops;
+
+        mgdbObj->signalNum            = msg.signalNum;
+        mgdbObj->opts.o_signalOnEntry = attached;  // GDB asks with '?' on the first stop
+        attached                      = 1;
+        minigdbstubProcess MGDB_T(mgdbObj);
+        if (mgdbObj->detached)
+        {
+            return;  // The target runs on without GDB
+        }
+    }
+    if (!link->killed)
+    {
+        // Don't leave the target parked forever
+        minigdbstubDebugCommand(link, MGDB_DEBUG_KILL);
+    }
+}
@@ -0,0 +1,293 @@
+#pragma once
+
+// Session record/replay companion for minigdbstub.
+//
+// Recording taps the stub's transport layer (mgdbProcObj.ioTap) and writes both directions of a
+// GDB session, with timing, to a compact binary file. Replaying feeds the recorded GDB-side bytes
+// back into minigdbstubProcess and checks the stub's output byte for byte against the recording.
+//
+// File format (integers are unsigned LEB128 varints):
+//   "MGDBREC1"
+//   chunk* : dir byte (MGDB_TRACE_RECV/MGDB_TRACE_SEND), delta-time (us since previous chunk),
+//            length, bytes
+// Consecutive bytes travelling in the same direction are coalesced into one chunk.
+
+#include "minigdbstub.h"
+
+#define MGDB_REC_MAGIC "MGDBREC1"
+#define MGDB_REC_MAGIC_LEN 8
+#define MGDB_REC_CHUNK_SIZE 4096
+
+// Fed to the stub once the recorded input is exhausted so that minigdbstubProcess returns
+#define MGDB_REPLAY_EOF_PACKET "$k#6b"
+
+// ====================================================================================================================
+// Recorder
+// ====================================================================================================================
+typedef struct
+{
+    FILE *file;
+    int dir;                            // Direction of the pending chunk (-1 if none)
+    unsigned long long lastTimestamp;   // Timestamp of the previously written chunk
+    unsigned long long chunkTimestamp;  // Timestamp of the first byte of the pending chunk
+    DynCharBuffer chunk;                // Pending chunk bytes
+    int err;                            // First error hit while recording
+} mgdbSessionRecorder;
+
+static void minigdbstubRecPutVarint(FILE *file, unsigned long long val)
+{
+    do
+    {
+        unsigned char byte = val & 0x7f;
+        val >>= 7;
+        if (val != 0)
+        {
+            byte |= 0x80;
+        }
+        fputc(byte, file);
+    } while (val != 0);
+}
+
+static void minigdbstubRecorderFlushChunk(mgdbSessionRecorder *rec)
+{
+    if (rec->dir < 0 || rec->chunk.used == 0)
+    {
+        return;
+    }
+    fputc(rec->dir, rec->file);
+    minigdbstubRecPutVarint(rec->file, (rec->chunkTimestamp - rec->lastTimestamp) / 1000);
+    minigdbstubRecPutVarint(rec->file, rec->chunk.used);
+    if (fwrite(rec->chunk.buffer, 1, rec->chunk.used, rec->file) != rec->chunk.used)
+    {
+        rec->err = MGDB_IO_FAILED;
+    }
+    rec->lastTimestamp = rec->chunkTimestamp;
+    rec->chunk.used    = 0;
+}
+
+static int minigdbstubRecorderOpen(mgdbSessionRecorder *rec, const char *path)
+{
+    rec->file = fopen(path, "wb");
+    if (rec->file == NULL)
+    {
+        MGDB_LOG_E("Failed to open session recording '%s'!\n", path);
+        return MGDB_IO_FAILED;
+    }
+    rec->dir            = -1;
+    rec->lastTimestamp  = MGDB_TIMESTAMP();
+    rec->chunkTimestamp = rec->lastTimestamp;
+    rec->err            = initDynCharBuffer(&rec->chunk, MGDB_REC_CHUNK_SIZE);
+    fwrite(MGDB_REC_MAGIC, 1, MGDB_REC_MAGIC_LEN, rec->file);
+    return rec->err;
+}
+
+// mgdbIoTapFn - attach with mgdbObj.ioTap = minigdbstubRecorderTap, mgdbObj.ioTapData = rec
+static void minigdbstubRecorderTap(int dir, char data, void *tapData)
+{
+    mgdbSessionRecorder *rec = (mgdbSessionRecorder *)tapData;
+    if (rec->err != MGDB_SUCCESS)
+    {
+        return;
+    }
+    if (dir != rec->dir)
+    {
+        minigdbstubRecorderFlushChunk(rec);
+        rec->dir            = dir;
+        rec->chunkTimestamp = MGDB_TIMESTAMP();
+    }
+    rec->err = insertDynCharBuffer(&rec->chunk, data);
+}
+
+static int minigdbstubRecorderClose(mgdbSessionRecorder *rec)
+{
+    if (rec->err == MGDB_SUCCESS)
+    {
+        minigdbstubRecorderFlushChunk(rec);
+    }
+    if (fclose(rec->file) != 0 && rec->err == MGDB_SUCCESS)
+    {
+        rec->err = MGDB_IO_FAILED;
+    }
+    freeDynCharBuffer(&rec->chunk);
+    rec->file = NULL;
+    return rec->err;
+}
+
+// ====================================================================================================================
+// Session log (a loaded recording)
+// ====================================================================================================================
+typedef struct
+{
+    DynCharBuffer input;            // GDB ---> stub bytes
+    DynCharBuffer output;           // GDB <--- stub bytes
+    unsigned long long durationUs;  // Recorded wall-clock duration
+    size_t chunks;                  // Number of chunks in the recording
+} mgdbSessionLog;
+
+static int minigdbstubRecGetVarint(FILE *file, unsigned long long *val)
+{
+    int shift = 0;
+    *val      = 0;
+    while (1)
+    {
+        int byte = fgetc(file);
+        if (byte == EOF || shift > 63)
+        {
+            return MGDB_BAD_FORMAT;
+        }
+        *val |= (unsigned long long)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return MGDB_SUCCESS;
+        }
+        shift += 7;
+    }
+}
+
+static void minigdbstubSessionFree(mgdbSessionLog *log)
+{
+    freeDynCharBuffer(&log->input);
+    freeDynCharBuffer(&log->output);
+}
+
+static int minigdbstubSessionLoad(mgdbSessionLog *log, const char *path)
+{
+    memset(log, 0, sizeof(*log));
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        MGDB_LOG_E("Failed to open session recording '%s'!\n", path);
+        return MGDB_IO_FAILED;
+    }
+
+    int err = MGDB_SUCCESS;
+    char magic[MGDB_REC_MAGIC_LEN];
+    if (fread(magic, 1, MGDB_REC_MAGIC_LEN, file) != MGDB_REC_MAGIC_LEN ||
+        memcmp(magic, MGDB_REC_MAGIC, MGDB_REC_MAGIC_LEN) != 0)
+    {
+        fclose(file);
+        return MGDB_BAD_FORMAT;
+    }
+    if ((err = initDynCharBuffer(&log->input, MGDB_REC_CHUNK_SIZE)) != MGDB_SUCCESS ||
+        (err = initDynCharBuffer(&log->output, MGDB_REC_CHUNK_SIZE)) != MGDB_SUCCESS)
+    {
+        fclose(file);
+        minigdbstubSessionFree(log);
+        return err;
+    }
+
+    int dir;
+    while (err == MGDB_SUCCESS && (dir = fgetc(file)) != EOF)
+    {
+        unsigned long long deltaUs, length;
+        if (minigdbstubRecGetVarint(file, &deltaUs) != MGDB_SUCCESS ||
+            minigdbstubRecGetVarint(file, &length) != MGDB_SUCCESS ||
+            (dir != MGDB_TRACE_RECV && dir != MGDB_TRACE_SEND))
+        {
+            err = MGDB_BAD_FORMAT;
+            break;
+        }
+        DynCharBuffer *stream = (dir == MGDB_TRACE_RECV) ? &log->input : &log->output;
+        for (unsigned long long i = 0; i < length && err == MGDB_SUCCESS; ++i)
+        {
+            int byte = fgetc(file);
+            err      = (byte == EOF) ? MGDB_BAD_FORMAT : insertDynCharBuffer(stream, (char)byte);
+        }
+        log->durationUs += deltaUs;
+        ++log->chunks;
+    }
+    fclose(file);
+    if (err != MGDB_SUCCESS)
+    {
+        minigdbstubSessionFree(log);
+    }
+    return err;
+}
+
+// Append "$<payload>#<checksum>" to a buffer (e.g. to synthesize GDB-side input)
+static int minigdbstubReplayAppendPacket(DynCharBuffer *buf, const char *payload)
+{
+    char checksum[8];
+    size_t len = strlen(payload);
+    int err    = insertDynCharBuffer(buf, '$');
+    for (size_t i = 0; i < len && err == MGDB_SUCCESS; ++i)
+    {
+        err = insertDynCharBuffer(buf, payload[i]);
+    }
+    minigdbstubComputeChecksum((char *)payload, len, checksum);
+    if (err == MGDB_SUCCESS)
+    {
+        err = insertDynCharBuffer(buf, '#');
+    }
+    if (err == MGDB_SUCCESS)
+    {
+        err = insertDynCharBuffer(buf, checksum[0]);
+    }
+    if (err == MGDB_SUCCESS)
+    {
+        err = insertDynCharBuffer(buf, checksum[1]);
+    }
+    return err;
+}
+
+// ====================================================================================================================
+// Replayer - call these from the user Getchar/Putchar hooks of the target under test
+// ====================================================================================================================
+typedef struct
+{
+    const mgdbSessionLog *log;
+    size_t inPos;           // Next input byte to feed to the stub
+    size_t outPos;          // Next expected output byte
+    size_t eofPos;          // Position within MGDB_REPLAY_EOF_PACKET once input is exhausted
+    size_t mismatchOffset;  // First differing output offset (valid if mismatch is set)
+    int mismatch;           // Stub output differed from the recording
+    int eof;                // Input exhausted - MGDB_REPLAY_EOF_PACKET is being fed
+} mgdbReplay;
+
+static void minigdbstubReplayInit(mgdbReplay *replay, const mgdbSessionLog *log)
+{
+    memset(replay, 0, sizeof(*replay));
+    replay->log = log;
+}
+
+static char minigdbstubReplayGetchar(mgdbReplay *replay)
+{
+    if (replay->inPos < replay->log->input.used)
+    {
+        return replay->log->input.buffer[replay->inPos++];
+    }
+    replay->eof = 1;
+    char c      = MGDB_REPLAY_EOF_PACKET[replay->eofPos++];
+    if (replay->eofPos == sizeof(MGDB_REPLAY_EOF_PACKET) - 1)
+    {
+        replay->eofPos = 0;
+    }
+    return c;
+}
+
+static void minigdbstubReplayPutchar(mgdbReplay *replay, char data)
+{
+    if (replay->eof)
+    {
+        return;
+    }
+    if (!replay->mismatch && (replay->outPos >= replay->log->output.used ||
+                              replay->log->output.buffer[replay->outPos] != data))
+    {
+        replay->mismatch       = 1;
+        replay->mismatchOffset = replay->outPos;
+    }
+    ++replay->outPos;
+}
+
+// Whole recorded input has been consumed
+static int minigdbstubReplayDone(const mgdbReplay *replay)
+{
+    return replay->eof || replay->inPos >= replay->log->input.used;
+}
+
+// Stub output so far matches the recording exactly
+static int minigdbstubReplayMatched(const mgdbReplay *replay)
+{
+    return !replay->mismatch && replay->outPos == replay->log->output.used;
+}
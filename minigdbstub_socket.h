@@ -0,0 +1,615 @@
+#pragma once
+
+// Linux TCP/Unix-socket transport companion for minigdbstub.
+//
+// Incoming bytes are read into a ring buffer, replies are collected in a transmit ring and written
+// with a single writev() per reply (the stub calls minigdbstubUsrFlush at reply boundaries), and
+// TCP connections have Nagle disabled. Connections are registered with an epoll instance so they
+// can be driven from an event loop.
+//
+// mgdbSockMux hosts many independent stub sessions on one thread: each connection carries its own
+// mgdbProcObj and packets are only handed to the stub once they are fully buffered, so no session
+// ever blocks another (packets bigger than MGDB_SOCK_RX_SIZE get an error reply instead). Replies a
+// full socket won't take stay queued until epoll reports it writable again, and a ^C from GDB
+// interrupts a running session (mgdbSockMux.onInterrupt). TCP listeners use SO_REUSEPORT, so a
+// small worker pool is simply several muxes listening on the same port from different threads.
+//
+// Define MGDB_SOCK_CONN(usrData) before including this header to have it define the transport
+// hooks (minigdbstubUsrPutchar/Getchar/Flush). The macro maps the stub's usrData to the session's
+// mgdbSockConn, e.g. when the connection is the first member of the user data:
+//     #define MGDB_SOCK_CONN(usrData) ((mgdbSockConn *)(usrData))
+// C++ targets bound through mgdb::Stub<Target> instead call the mux with their hooks class, e.g.
+// minigdbstubMuxPoll<mgdb::TargetHooks<Board> >(&mux, timeoutMs).
+
+#ifndef MGDB_USR_FLUSH
+#    define MGDB_USR_FLUSH
+#endif
+#ifndef _GNU_SOURCE
+#    define _GNU_SOURCE  // accept4() - only effective when this header is included first
+#endif
+
+#include "minigdbstub.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Ring buffer sizes (must be powers of 2)
+#ifndef MGDB_SOCK_RX_SIZE
+#    define MGDB_SOCK_RX_SIZE 4096
+#endif
+#ifndef MGDB_SOCK_TX_SIZE
+#    define MGDB_SOCK_TX_SIZE 4096
+#endif
+
+// Fed to the stub once the peer has disconnected so that minigdbstubProcess returns - a detach, so
+// the target runs on and keeps its session state for the next GDB to connect
+#define MGDB_SOCK_EOF_PACKET "$D#44"
+
+typedef struct
+{
+    int fd;
+    char rx[MGDB_SOCK_RX_SIZE];
+    size_t rxHead;          // Total bytes received
+    size_t rxTail;          // Total bytes consumed by the stub
+    char tx[MGDB_SOCK_TX_SIZE];
+    size_t txHead;          // Total bytes queued by the stub
+    size_t txTail;          // Total bytes written to the socket
+    DynCharBuffer txSpill;  // Replies queued behind a full tx ring and a full socket (mux sessions)
+    size_t txSpillPos;      // Bytes of txSpill already written
+    int epollFd;            // Mux epoll instance - a full socket arms EPOLLOUT, -1 waits in poll()
+    int txArmed;            // EPOLLOUT is armed for unsent replies
+    size_t eofPos;          // Position within MGDB_SOCK_EOF_PACKET once disconnected
+    int rxDrop;             // Rejecting an oversized packet - -1 until its '#', then digits left
+    int running;            // The stub handed control back to the target (multiplexed sessions)
+    int err;                // MGDB_IO_FAILED once the peer has disconnected
+    size_t writes;          // Number of writev() calls (stat)
+    mgdbProcObj *mgdbObj;   // Stub session driven by this connection (multiplexed sessions only)
+} mgdbSockConn;
+
+typedef struct
+{
+    int listenFd;
+    int epollFd;
+    int port;  // Bound TCP port (useful when listening on port 0)
+} mgdbSockServer;
+
+// ====================================================================================================================
+// Listening/accepting
+// ====================================================================================================================
+static int minigdbstubSockSetNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    return (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) ? MGDB_IO_FAILED
+                                                                     : MGDB_SUCCESS;
+}
+
+static int minigdbstubSockListenFd(mgdbSockServer *server, int fd, struct sockaddr *addr,
+                                   socklen_t addrLen)
+{
+    int one          = 1;
+    server->listenFd = fd;
+    server->epollFd  = -1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (addr->sa_family == AF_INET)
+    {
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+    }
+    if (bind(fd, addr, addrLen) < 0 || listen(fd, SOMAXCONN) < 0 ||
+        minigdbstubSockSetNonBlocking(fd) != MGDB_SUCCESS)
+    {
+        MGDB_LOG_E("Failed to listen: %s\n", strerror(errno));
+        close(fd);
+        return MGDB_IO_FAILED;
+    }
+
+    server->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (server->epollFd < 0)
+    {
+        close(fd);
+        return MGDB_IO_FAILED;
+    }
+    struct epoll_event ev;
+    ev.events   = EPOLLIN;
+    ev.data.ptr = NULL;  // NULL marks the listening socket
+    epoll_ctl(server->epollFd, EPOLL_CTL_ADD, fd, &ev);
+    return MGDB_SUCCESS;
+}
+
+// Listen on host:port (port 0 picks a free port, see server->port)
+static int minigdbstubSockListenTcp(mgdbSockServer *server, const char *host, int port)
+{
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons((unsigned short)port);
+    if (inet_pton(AF_INET, host, &addr.sin_addr) != 1)
+    {
+        MGDB_LOG_E("Bad listen address '%s'\n", host);
+        return MGDB_IO_FAILED;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return MGDB_IO_FAILED;
+    }
+    int err = minigdbstubSockListenFd(server, fd, (struct sockaddr *)&addr, sizeof(addr));
+    if (err == MGDB_SUCCESS)
+    {
+        socklen_t addrLen = sizeof(addr);
+        getsockname(fd, (struct sockaddr *)&addr, &addrLen);
+        server->port = ntohs(addr.sin_port);
+    }
+    return err;
+}
+
+// Listen on a Unix socket path (any stale socket file is replaced)
+static int minigdbstubSockListenUnix(mgdbSockServer *server, const char *path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        MGDB_LOG_E("Unix socket path too long '%s'\n", path);
+        return MGDB_IO_FAILED;
+    }
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return MGDB_IO_FAILED;
+    }
+    server->port = 0;
+    return minigdbstubSockListenFd(server, fd, (struct sockaddr *)&addr, sizeof(addr));
+}
+
+static void minigdbstubSockConnInit(mgdbSockConn *conn, int fd)
+{
+    conn->fd     = fd;
+    conn->rxHead = conn->rxTail = 0;
+    conn->txHead = conn->txTail = 0;
+    conn->txSpill.buffer        = NULL;
+    conn->txSpill.used          = 0;
+    conn->txSpill.size          = 0;
+    conn->txSpillPos            = 0;
+    conn->epollFd               = -1;
+    conn->txArmed               = 0;
+    conn->eofPos                = 0;
+    conn->rxDrop                = 0;
+    conn->running               = 0;
+    conn->err                   = MGDB_SUCCESS;
+    conn->writes                = 0;
+}
+
+// Accept a pending connection without blocking - returns MGDB_IO_FAILED if none is pending
+static int minigdbstubSockTryAccept(mgdbSockServer *server, mgdbSockConn *conn)
+{
+    int fd = accept4(server->listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0)
+    {
+        return MGDB_IO_FAILED;
+    }
+    // Replies are already batched per packet - never let Nagle hold them back
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    minigdbstubSockConnInit(conn, fd);
+
+    struct epoll_event ev;
+    ev.events   = EPOLLIN;
+    ev.data.ptr = conn;
+    epoll_ctl(server->epollFd, EPOLL_CTL_ADD, fd, &ev);
+    return MGDB_SUCCESS;
+}
+
+// Block until a GDB connects
+static int minigdbstubSockAccept(mgdbSockServer *server, mgdbSockConn *conn)
+{
+    struct pollfd pfd;
+    pfd.fd     = server->listenFd;
+    pfd.events = POLLIN;
+    while (minigdbstubSockTryAccept(server, conn) != MGDB_SUCCESS)
+    {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        {
+            MGDB_LOG_E("Failed to accept: %s\n", strerror(errno));
+            return MGDB_IO_FAILED;
+        }
+        poll(&pfd, 1, -1);
+    }
+    return MGDB_SUCCESS;
+}
+
+static void minigdbstubSockClose(mgdbSockServer *server, mgdbSockConn *conn)
+{
+    if (conn->fd >= 0)
+    {
+        if (server)
+        {
+            epoll_ctl(server->epollFd, EPOLL_CTL_DEL, conn->fd, NULL);
+        }
+        close(conn->fd);
+        conn->fd = -1;
+    }
+    freeDynCharBuffer(&conn->txSpill);
+    conn->txSpillPos = 0;
+}
+
+static void minigdbstubSockServerClose(mgdbSockServer *server)
+{
+    close(server->listenFd);
+    close(server->epollFd);
+    server->listenFd = server->epollFd = -1;
+}
+
+// ====================================================================================================================
+// Buffered I/O
+// ====================================================================================================================
+
+// Read whatever is available into the rx ring - returns bytes read (0 if none or disconnected)
+static size_t minigdbstubSockFill(mgdbSockConn *conn)
+{
+    size_t total = 0;
+    while (conn->err == MGDB_SUCCESS && conn->rxHead - conn->rxTail < MGDB_SOCK_RX_SIZE)
+    {
+        size_t head  = conn->rxHead & (MGDB_SOCK_RX_SIZE - 1);
+        size_t space = MGDB_SOCK_RX_SIZE - (conn->rxHead - conn->rxTail);
+        struct iovec iov[2];
+        int iovCount    = 1;
+        iov[0].iov_base = &conn->rx[head];
+        iov[0].iov_len  = (head + space > MGDB_SOCK_RX_SIZE) ? MGDB_SOCK_RX_SIZE - head : space;
+        if (iov[0].iov_len < space)
+        {
+            iov[1].iov_base = conn->rx;
+            iov[1].iov_len  = space - iov[0].iov_len;
+            iovCount        = 2;
+        }
+
+        ssize_t n = readv(conn->fd, iov, iovCount);
+        if (n > 0)
+        {
+            conn->rxHead += (size_t)n;
+            total += (size_t)n;
+            continue;
+        }
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+        {
+            conn->err = MGDB_IO_FAILED;
+        }
+        break;
+    }
+    return total;
+}
+
+// Watch a mux session's socket for room to write the rest of its replies
+static void minigdbstubSockWatchTx(mgdbSockConn *conn, int watch)
+{
+    struct epoll_event ev;
+    ev.events   = watch ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    ev.data.ptr = conn;
+    epoll_ctl(conn->epollFd, EPOLL_CTL_MOD, conn->fd, &ev);
+    conn->txArmed = watch;
+}
+
+// Write out everything queued in the tx ring (then txSpill) - one writev() per call unless the
+// socket is full. A mux session never waits for the socket: what's left stays queued and goes out
+// from minigdbstubMuxService once EPOLLOUT fires
+static void minigdbstubSockFlush(mgdbSockConn *conn)
+{
+    while (conn->err == MGDB_SUCCESS && (conn->txHead != conn->txTail || conn->txSpill.used))
+    {
+        size_t used = conn->txHead - conn->txTail;
+        size_t tail = conn->txTail & (MGDB_SOCK_TX_SIZE - 1);
+        struct iovec iov[3];
+        iov[0].iov_base = &conn->tx[tail];
+        iov[0].iov_len  = (tail + used > MGDB_SOCK_TX_SIZE) ? MGDB_SOCK_TX_SIZE - tail : used;
+        int iovCount    = (used != 0);
+        if (iov[0].iov_len < used)
+        {
+            iov[iovCount].iov_base = conn->tx;
+            iov[iovCount].iov_len  = used - iov[0].iov_len;
+            ++iovCount;
+        }
+        if (conn->txSpill.used)
+        {
+            iov[iovCount].iov_base = &conn->txSpill.buffer[conn->txSpillPos];
+            iov[iovCount].iov_len  = conn->txSpill.used - conn->txSpillPos;
+            ++iovCount;
+        }
+
+        ssize_t n = writev(conn->fd, iov, iovCount);
+        ++conn->writes;
+        if (n > 0)
+        {
+            // Ring bytes are always older than spilled ones
+            size_t fromRing = ((size_t)n < used) ? (size_t)n : used;
+            conn->txTail += fromRing;
+            conn->txSpillPos += (size_t)n - fromRing;
+            if (conn->txSpillPos == conn->txSpill.used)
+            {
+                conn->txSpill.used = conn->txSpillPos = 0;
+            }
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        {
+            if (errno != EINTR && conn->epollFd >= 0)
+            {
+                if (!conn->txArmed)
+                {
+                    minigdbstubSockWatchTx(conn, 1);
+                }
+                return;
+            }
+            struct pollfd pfd;
+            pfd.fd     = conn->fd;
+            pfd.events = POLLOUT;
+            poll(&pfd, 1, -1);
+            continue;
+        }
+        conn->err = MGDB_IO_FAILED;
+    }
+    if (conn->err != MGDB_SUCCESS)
+    {
+        conn->txTail       = conn->txHead;
+        conn->txSpill.used = conn->txSpillPos = 0;
+    }
+    if (conn->txArmed && conn->fd >= 0)
+    {
+        minigdbstubSockWatchTx(conn, 0);
+    }
+}
+
+static void minigdbstubSockPutchar(mgdbSockConn *conn, char data)
+{
+    if (!conn->txSpill.used && (conn->txHead - conn->txTail == MGDB_SOCK_TX_SIZE))
+    {
+        minigdbstubSockFlush(conn);
+    }
+    if (conn->txSpill.used || (conn->txHead - conn->txTail == MGDB_SOCK_TX_SIZE))
+    {
+        // A mux session's socket is full as well - queue behind the ring instead of waiting
+        if (insertDynCharBuffer(&conn->txSpill, data) != MGDB_SUCCESS)
+        {
+            conn->err = MGDB_IO_FAILED;
+        }
+        return;
+    }
+    conn->tx[conn->txHead++ & (MGDB_SOCK_TX_SIZE - 1)] = data;
+}
+
+static char minigdbstubSockGetchar(mgdbSockConn *conn)
+{
+    while (conn->rxHead == conn->rxTail)
+    {
+        if (conn->err != MGDB_SUCCESS)
+        {
+            // Peer is gone - detach
+            char c = MGDB_SOCK_EOF_PACKET[conn->eofPos++];
+            if (conn->eofPos == sizeof(MGDB_SOCK_EOF_PACKET) - 1)
+            {
+                conn->eofPos = 0;
+            }
+            return c;
+        }
+        minigdbstubSockFlush(conn);
+        if (minigdbstubSockFill(conn) == 0 && conn->err == MGDB_SUCCESS)
+        {
+            struct pollfd pfd;
+            pfd.fd     = conn->fd;
+            pfd.events = POLLIN;
+            poll(&pfd, 1, -1);
+        }
+    }
+    return conn->rx[conn->rxTail++ & (MGDB_SOCK_RX_SIZE - 1)];
+}
+
+// Bytes were read ahead and not consumed yet - mgdbDebugLink.inputPending for
+// minigdbstub_debugthread.h
+static int minigdbstubSockInputPending(void *conn)
+{
+    return ((mgdbSockConn *)conn)->rxHead != ((mgdbSockConn *)conn)->rxTail;
+}
+
+// A complete "$...#xx" packet is buffered
+static int minigdbstubSockHasPacket(mgdbSockConn *conn)
+{
+    int inPkt = 0;
+    for (size_t i = conn->rxTail; i < conn->rxHead; ++i)
+    {
+        char c = conn->rx[i & (MGDB_SOCK_RX_SIZE - 1)];
+        if (c == '$')
+        {
+            inPkt = 1;
+        }
+        else if (c == '#' && inPkt)
+        {
+            return conn->rxHead - i > 2;
+        }
+    }
+    return 0;
+}
+
+// GDB's ^C (0x03) comes on its own, never inside a packet. Consumes one buffered ahead of the next
+// packet and returns 1 if there was one
+static int minigdbstubSockTakeInterrupt(mgdbSockConn *conn)
+{
+    for (size_t i = conn->rxTail; i < conn->rxHead; ++i)
+    {
+        char c = conn->rx[i & (MGDB_SOCK_RX_SIZE - 1)];
+        if (c == '$')
+        {
+            return 0;
+        }
+        if (c == '\x03')
+        {
+            conn->rxTail = i + 1;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Throw away a packet that doesn't fit the rx ring - handing it to the stub would block the mux
+// thread on the rest of it. GDB gets an error reply once the whole packet has been read. Returns 1
+// while the packet is still arriving
+static int minigdbstubSockRejectOversized(mgdbSockConn *conn)
+{
+    if (!conn->rxDrop && (conn->rxHead - conn->rxTail == MGDB_SOCK_RX_SIZE) &&
+        !minigdbstubSockHasPacket(conn))
+    {
+        conn->rxDrop = -1;
+    }
+    while (conn->rxDrop && (conn->rxTail != conn->rxHead))
+    {
+        char c       = conn->rx[conn->rxTail++ & (MGDB_SOCK_RX_SIZE - 1)];
+        conn->rxDrop = (conn->rxDrop > 0) ? conn->rxDrop - 1 : (c == '#') ? 2 : -1;
+        for (const char *reply = MGDB_ACK_PACKET MGDB_ERROR_PACKET; !conn->rxDrop && *reply;)
+        {
+            minigdbstubSockPutchar(conn, *reply++);
+        }
+    }
+    return conn->rxDrop != 0;
+}
+
+// ====================================================================================================================
+// Multi-session server
+// ====================================================================================================================
+typedef struct
+{
+    mgdbSockServer server;
+    // Return a free connection slot with conn->mgdbObj set up, or NULL to refuse the connection
+    mgdbSockConn *(*onAccept)(void *ctx);
+    // Connection closed - its slot may be reused
+    void (*onClose)(mgdbSockConn *conn, void *ctx);
+    // Optional - GDB interrupted (^C) a running session: halt its target and report the stop with
+    // minigdbstubMuxReportStop. Without it the session is reported stopped (SIGINT) right away
+    void (*onInterrupt)(mgdbSockConn *conn, void *ctx);
+    void *ctx;
+    size_t sessions;  // Currently open sessions
+    size_t packets;   // Total packets handed to the stub (stat)
+} mgdbSockMux;
+
+static void minigdbstubMuxAcceptAll(mgdbSockMux *mux)
+{
+    while (1)
+    {
+        mgdbSockConn *conn = mux->onAccept(mux->ctx);
+        if (conn == NULL)
+        {
+            // Out of session slots - refuse
+            int fd = accept4(mux->server.listenFd, NULL, NULL, SOCK_CLOEXEC);
+            if (fd < 0)
+            {
+                return;
+            }
+            close(fd);
+            continue;
+        }
+        if (minigdbstubSockTryAccept(&mux->server, conn) != MGDB_SUCCESS)
+        {
+            conn->fd = -1;
+            mux->onClose(conn, mux->ctx);
+            return;
+        }
+        conn->epollFd = mux->server.epollFd;
+        ++mux->sessions;
+    }
+}
+
+// Report an asynchronous stop (e.g. after a 'c') for a multiplexed session
+MGDB_TPL static void minigdbstubMuxReportStop(mgdbSockConn *conn, int signalNum)
+{
+    conn->running            = 0;
+    conn->mgdbObj->signalNum = signalNum;
+    minigdbstubSendSignal MGDB_T(conn->mgdbObj);
+    minigdbstubSockFlush(conn);
+}
+
+MGDB_TPL static void minigdbstubMuxService(mgdbSockMux *mux, mgdbSockConn *conn)
+{
+    minigdbstubSockFill(conn);
+    if (conn->running && !conn->rxDrop && minigdbstubSockTakeInterrupt(conn))
+    {
+        if (mux->onInterrupt)
+        {
+            mux->onInterrupt(conn, mux->ctx);
+        }
+        else
+        {
+            minigdbstubMuxReportStop MGDB_T(conn, SIGINT);
+        }
+    }
+    do
+    {
+        while (!minigdbstubSockRejectOversized(conn) && minigdbstubSockHasPacket(conn))
+        {
+            conn->running |= minigdbstubProcessPacket MGDB_T(conn->mgdbObj);
+            ++mux->packets;
+        }
+    } while (conn->rxDrop && minigdbstubSockFill(conn));
+    // Replies to pipelined packets go out together - also what a writable socket (EPOLLOUT) wakes
+    minigdbstubSockFlush(conn);
+
+    if (conn->err != MGDB_SUCCESS)
+    {
+        if (!conn->mgdbObj->detached)
+        {
+            // Dropped without a 'D' - a target that is already running is left alone
+            minigdbstubDetach MGDB_T(conn->mgdbObj, !conn->running);
+        }
+        minigdbstubSockClose(&mux->server, conn);
+        --mux->sessions;
+        mux->onClose(conn, mux->ctx);
+    }
+}
+
+// Wait up to timeoutMs (-1 = forever) for activity and service every ready session - returns the
+// number of events handled
+MGDB_TPL static int minigdbstubMuxPoll(mgdbSockMux *mux, int timeoutMs)
+{
+    struct epoll_event events[64];
+    int count = epoll_wait(mux->server.epollFd, events, 64, timeoutMs);
+    for (int i = 0; i < count; ++i)
+    {
+        if (events[i].data.ptr == NULL)
+        {
+            minigdbstubMuxAcceptAll(mux);
+        }
+        else
+        {
+            minigdbstubMuxService MGDB_T(mux, (mgdbSockConn *)events[i].data.ptr);
+        }
+    }
+    return (count < 0) ? 0 : count;
+}
+
+// ====================================================================================================================
+// Transport hooks
+// ====================================================================================================================
+#ifdef MGDB_SOCK_CONN
+static void minigdbstubUsrPutchar(char data, void *usrData)
+{
+    minigdbstubSockPutchar(MGDB_SOCK_CONN(usrData), data);
+}
+
+static char minigdbstubUsrGetchar(void *usrData)
+{
+    return minigdbstubSockGetchar(MGDB_SOCK_CONN(usrData));
+}
+
+static void minigdbstubUsrFlush(void *usrData)
+{
+    minigdbstubSockFlush(MGDB_SOCK_CONN(usrData));
+}
+#endif
@@ -1,3 +1,4 @@
+#include <limits.h>
 #include <signal.h>
 #include <iostream>
 #include <string>
@@ -12,7 +13,7 @@
 TEST(minigdbstub, test_set_soft_breakpoint)
 {
     // Create mock test packet
-    const char *packet = "$Z0,d8,4#b2";
+    const char *packet = "Z0,d8,4";
 
     // Create mock putchar buff
     std::vector<char> dummyPutchar;
@@ -27,7 +28,7 @@ TEST(minigdbstub, test_set_soft_breakpoint)
     gdbPkt.checksum[0] = 'b';
     gdbPkt.checksum[1] = '2';
     gdbPkt.checksum[2] = 0;
-    for (size_t i = 0; i < strlen(packet); ++i)
+    for (size_t i = 0; i <= strlen(packet); ++i)
     {
         GTEST_FAIL_IF_ERR(insertDynCharBuffer(&gdbPkt.pktData, packet[i]));
     }
@@ -40,5 +41,108 @@ TEST(minigdbstub, test_set_soft_breakpoint)
     EXPECT_EQ(brkObj->bits.isSet, 1U);
     EXPECT_EQ(brkObj->bits.hardBreak, 0U);
     EXPECT_EQ(brkObj->bits.isClear, 0U);
+    EXPECT_EQ(std::string(dummyPutchar.begin(), dummyPutchar.end()), MGDB_OK_PACKET);
     freeDynCharBuffer(&gdbPkt.pktData);
-}
\ No newline at end of file
+}
+
+TEST(minigdbstub, test_conditional_breakpoint)
+{
+    std::vector<unsigned char> mem(64, 0);
+    g_memHandle          = &mem;
+    unsigned int regs[4] = {0, 7, 0, 0};
+
+    mgdbBreakpoint entries[2];
+    mgdbBreakpointTable table;
+    minigdbstubBreakpointInit(&table, entries, 2);
+
+    testBreak breakObj  = {{0}};
+    mgdbProcObj procObj = {0};
+    procObj.usrData     = &breakObj;
+    procObj.regs        = (char *)regs;
+    procObj.regsSize    = sizeof(regs);
+    procObj.regsCount   = 4;
+    procObj.breakpoints = &table;
+
+    // Stop if "$r1 == 7" or "*(int *)0x10 > 2":
+    //   reg 1, const8 7, equal, end
+    //   const8 2, const8 0x10, ref32, less_signed, end
+    EXPECT_EQ(runPkt(&procObj, "Z0,400,4;X7,26000122071327;X7,22022210191427"), MGDB_OK_PACKET);
+    EXPECT_EQ(breakObj.bits.isSet, 1U);
+    ASSERT_EQ(table.count, 1U);
+    EXPECT_EQ(entries[0].condCount, 2U);
+
+    EXPECT_EQ(minigdbstubBreakpointHit(&procObj, 0x400), 1);
+    regs[1] = 0;
+    EXPECT_EQ(minigdbstubBreakpointHit(&procObj, 0x400), 0);
+    mem[0x10] = 3;
+    EXPECT_EQ(minigdbstubBreakpointHit(&procObj, 0x400), 1);
+    EXPECT_EQ(table.hits, 3U);
+    EXPECT_EQ(table.stops, 2U);
+
+    // Unconditional and unknown breakpoints always stop
+    runPkt(&procObj, "Z0,500,4");
+    EXPECT_EQ(minigdbstubBreakpointHit(&procObj, 0x500), 1);
+    EXPECT_EQ(minigdbstubBreakpointHit(&procObj, 0x600), 1);
+
+    // GDB resends Z0 with the new condition list when it changes
+    runPkt(&procObj, "Z0,400,4;X7,26000122071327");
+    EXPECT_EQ(table.count, 2U);
+    EXPECT_EQ(minigdbstubBreakpointHit(&procObj, 0x400), 0);
+
+    // Bytecode that can't be evaluated (equal on an empty stack) stops the target
+    runPkt(&procObj, "Z0,400,4;X2,1327");
+    EXPECT_EQ(minigdbstubBreakpointHit(&procObj, 0x400), 1);
+    // ...and so does a division by zero (const8 1, const8 0, div_unsigned, end)
+    runPkt(&procObj, "Z0,400,4;X6,220122000627");
+    EXPECT_EQ(minigdbstubBreakpointHit(&procObj, 0x400), 1);
+
+    // Full table
+    EXPECT_EQ(runPkt(&procObj, "Z0,700,4"), MGDB_ERROR_PACKET);
+
+    EXPECT_EQ(runPkt(&procObj, "z0,400,4"), MGDB_OK_PACKET);
+    EXPECT_EQ(table.count, 1U);
+    EXPECT_EQ(minigdbstubBreakpointFind(&table, 0x400), nullptr);
+
+    EXPECT_NE(runPkt(&procObj, "qSupported:multiprocess+").find("ConditionalBreakpoints+"),
+              std::string::npos);
+}
+
+TEST(minigdbstub, test_ax_eval)
+{
+    mgdbProcObj procObj = {0};
+    long long result;
+    struct
+    {
+        std::vector<unsigned char> code;
+        long long expected;
+    } cases[] = {
+        {{0x22, 0xff, 0x16, 0x08, 0x27}, -1},                                     // ext 8
+        {{0x23, 0x12, 0x34, 0x2a, 0x08, 0x27}, 0x34},                             // zero_ext 8
+        {{0x22, 0x05, 0x22, 0x03, 0x03, 0x27}, 2},                                // sub
+        {{0x22, 0x01, 0x20, 0x00, 0x08, 0x22, 0x09, 0x27, 0x22, 0x04, 0x27}, 4},  // if_goto
+        {{0x24, 0x80, 0x00, 0x00, 0x00, 0x22, 0x04, 0x0b, 0x27}, 0x08000000},     // rsh_unsigned
+        {{0x22, 0x01, 0x22, 0x02, 0x2b, 0x03, 0x27}, 1},                          // swap, sub
+        {{0x22, 0xf9, 0x16, 0x08, 0x22, 0xff, 0x16, 0x08, 0x05, 0x27}, 7},        // div_signed
+        {{0x22, 0xf9, 0x16, 0x08, 0x22, 0x02, 0x07, 0x27}, -1},                   // rem_signed
+        // LLONG_MIN / -1 and LLONG_MIN % -1 would trap - they wrap to LLONG_MIN and give 0
+        {{0x25, 0x80, 0, 0, 0, 0, 0, 0, 0, 0x22, 0xff, 0x16, 0x08, 0x05, 0x27}, LLONG_MIN},
+        {{0x25, 0x80, 0, 0, 0, 0, 0, 0, 0, 0x22, 0xff, 0x16, 0x08, 0x07, 0x27}, 0},
+    };
+    for (auto &c : cases)
+    {
+        ASSERT_EQ(minigdbstubAxEval(&procObj, c.code.data(), c.code.size(), &result),
+                  MGDB_SUCCESS);
+        EXPECT_EQ(result, c.expected);
+    }
+
+    // Division by zero: const8 1, const8 0, div_signed .. rem_unsigned, end
+    for (unsigned char op = 0x05; op <= 0x08; ++op)
+    {
+        const unsigned char divZero[] = {0x22, 0x01, 0x22, 0x00, op, 0x27};
+        EXPECT_EQ(minigdbstubAxEval(&procObj, divZero, sizeof(divZero), &result), MGDB_BAD_FORMAT);
+    }
+
+    // Runaway loop: goto 0
+    const unsigned char loop[] = {0x21, 0x00, 0x00};
+    EXPECT_EQ(minigdbstubAxEval(&procObj, loop, sizeof(loop), &result), MGDB_BAD_FORMAT);
+}
@@ -1,10 +1,35 @@
 #ifndef MINIGDBSTUB_TEST_COMMON_HPP
 #define MINIGDBSTUB_TEST_COMMON_HPP
 
+#include <string.h>
 #include <iostream>
+#include <string>
 #include <vector>
+#include "gtest/gtest.h"
 #include "minigdbstub.h"
 
+// A packet as it goes over the wire - "$<payload>#<checksum>", or "%..." for a notification
+static std::string makePkt(const std::string &payload, const char *start = "$")
+{
+    char checksum[8];
+    minigdbstubComputeChecksum(const_cast<char *>(payload.c_str()), payload.size(), checksum);
+    return start + payload + "#" + checksum[0] + checksum[1];
+}
+
+// qRcmd packet for a monitor command
+static std::string monitorPkt(const std::string &cmd)
+{
+    std::string pkt = "qRcmd,";
+    for (unsigned char c : cmd)
+    {
+        pkt += minigdbstubHexPairs[c * 2];
+        pkt += minigdbstubHexPairs[(c * 2) + 1];
+    }
+    return pkt;
+}
+
+// Tests that bring their own transport (sockets, the C++ front-end) only share the packet helpers
+#ifndef MGDB_TEST_OWN_HOOKS
 typedef struct
 {
     unsigned int softBreak : 1;
@@ -83,6 +108,27 @@ static void minigdbstubUsrKillSession(void *usrData)
     return;
 }
 
+// Dispatch one packet payload - returns what the stub sent back, and in resume whether control
+// went back to the target
+static std::string runPkt(mgdbProcObj *mgdbObj, const char *payload, int *resume = NULL)
+{
+    std::vector<char> out;
+    gdbPacket pkt;
+    EXPECT_EQ(initDynCharBuffer(&pkt.pktData, 64), MGDB_SUCCESS);
+    EXPECT_EQ(appendDynCharBuffer(&pkt.pktData, payload, strlen(payload) + 1), MGDB_SUCCESS);
+    pkt.commandType    = payload[0];
+    g_putcharPktHandle = &out;
+    int ret            = minigdbstubDispatch(mgdbObj, &pkt);
+    if (resume)
+    {
+        *resume = ret;
+    }
+    EXPECT_EQ(mgdbObj->err, MGDB_SUCCESS);
+    freeDynCharBuffer(&pkt.pktData);
+    return std::string(out.begin(), out.end());
+}
+#endif  // MGDB_TEST_OWN_HOOKS
+
 #define GTEST_COUT std::cerr << "\033[0;32m[ INFO     ] \033[0;37m"
 #define GTEST_FAIL_IF_ERR(x)                \
     if (x != MGDB_SUCCESS)                  \
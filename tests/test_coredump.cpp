@@ -0,0 +1,127 @@
+#include <signal.h>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#define MGDB_CORE_BLOCK 0x400  // Small blocks keep the test's memory small
+#define MGDB_USR_MEM_CHECK
+#include "minigdbstub.h"
+#include "test_common.hpp"
+
+// Block the target refuses to read (e.g. MMIO)
+static size_t g_coreFaultAddr;
+
+static int minigdbstubUsrCheckMem(size_t addr, size_t len, int write, void *usrData)
+{
+    return (g_coreFaultAddr - addr < len) ? 0x0e : 0;
+}
+
+static unsigned int coreWord(const std::vector<unsigned char> &file, size_t offset)
+{
+    return file[offset] | (file[offset + 1] << 8) | (file[offset + 2] << 16) |
+           ((unsigned int)file[offset + 3] << 24);
+}
+
+// --- Tests ---
+
+TEST(minigdbstub, test_coredump)
+{
+    static const mgdbMemRegion regions[] = {
+        {0x0000, 0x2000, MGDB_MEM_RAM},
+        {0x2800, 0x0800, MGDB_MEM_ROM},
+    };
+    static const mgdbMemMap map    = MGDB_MEM_MAP(regions);
+    static const int gregMap[]     = {2, 0, 1, -1};  // pc first, like many Linux gregsets
+    static const mgdbCoreInfo info = {243, 0, 0, gregMap, 4, 4};
+    std::vector<unsigned char> mem(0x3000);
+    mem[0x10]       = 0x11;  // Block 0
+    mem[0x1bff]     = 0x22;  // Block 6
+    mem[0x2c00]     = 0x33;  // ROM, second block
+    g_memHandle     = &mem;
+    g_coreFaultAddr = 0x1000;  // Block 4
+
+    unsigned int regs[3] = {0xaaaa, 0xbbbb, 0x1234};
+    mgdbProcObj mgdbObj  = {0};
+    mgdbObj.regs         = (char *)regs;
+    mgdbObj.regsSize     = sizeof(regs);
+    mgdbObj.regsCount    = 3;
+    mgdbObj.memMap       = &map;
+    mgdbObj.signalNum    = SIGTRAP;
+
+    // Targets without core info don't know the command
+    std::string path = testing::TempDir() + "mgdb_test.core";
+    std::string cmd  = monitorPkt("dump-core " + path);
+    EXPECT_EQ(runPkt(&mgdbObj, cmd.c_str()), MGDB_EMPTY_PACKET);
+    mgdbObj.coreInfo = &info;
+    std::string reply = runPkt(&mgdbObj, cmd.c_str());
+    EXPECT_EQ(reply.substr(0, 2), "$O");
+    EXPECT_EQ(reply.substr(reply.size() - 6), MGDB_OK_PACKET);
+
+    std::ifstream in(path, std::ios::binary);
+    std::vector<unsigned char> file((std::istreambuf_iterator<char>(in)),
+                                    std::istreambuf_iterator<char>());
+    in.close();
+    remove(path.c_str());
+    ASSERT_GT(file.size(), 52U);
+    EXPECT_EQ(memcmp(file.data(), "\x7f" "ELF\x01\x01\x01", 7), 0);
+    EXPECT_EQ(file[16], 4);    // ET_CORE
+    EXPECT_EQ(file[18], 243);  // e_machine
+
+    // RAM: data, zero, refused, zero, data, zero - ROM: zero, data
+    struct
+    {
+        unsigned int type, vaddr, filesz, memsz, flags;
+    } expected[] = {
+        {4, 0, 20 + 92, 0, 4},  // 72 + 4 registers + pr_fpvalid
+        {1, 0x0000, 0x400, 0x400, 6},
+        {1, 0x0400, 0, 0xc00, 6},
+        {1, 0x1400, 0, 0x400, 6},
+        {1, 0x1800, 0x400, 0x400, 6},
+        {1, 0x1c00, 0, 0x400, 6},
+        {1, 0x2800, 0, 0x400, 5},
+        {1, 0x2c00, 0x400, 0x400, 5},
+    };
+    size_t phoff = coreWord(file, 28);
+    size_t phnum = file[44] | (file[45] << 8);
+    ASSERT_EQ(phnum, sizeof(expected) / sizeof(expected[0]));
+    ASSERT_LE(phoff + (phnum * 32), file.size());
+    for (size_t i = 0; i < phnum; ++i)
+    {
+        size_t ph = phoff + (i * 32);
+        EXPECT_EQ(coreWord(file, ph), expected[i].type) << i;
+        EXPECT_EQ(coreWord(file, ph + 8), expected[i].vaddr) << i;
+        EXPECT_EQ(coreWord(file, ph + 16), expected[i].filesz) << i;
+        EXPECT_EQ(coreWord(file, ph + 20), expected[i].memsz) << i;
+        EXPECT_EQ(coreWord(file, ph + 24), expected[i].flags) << i;
+    }
+
+    // Segment contents, and registers in pr_reg (72 bytes into the NT_PRSTATUS descriptor)
+    EXPECT_EQ(file[coreWord(file, phoff + 32 + 4) + 0x10], 0x11);
+    EXPECT_EQ(file[coreWord(file, phoff + (4 * 32) + 4) + 0x3ff], 0x22);
+    EXPECT_EQ(file[coreWord(file, phoff + (7 * 32) + 4)], 0x33);
+    size_t note = coreWord(file, phoff + 4);
+    EXPECT_EQ(memcmp(&file[note + 12], "CORE", 5), 0);
+    EXPECT_EQ(file[note + 20 + 12], SIGTRAP);  // pr_cursig
+    EXPECT_EQ(coreWord(file, note + 20 + 72), 0x1234U);
+    EXPECT_EQ(coreWord(file, note + 20 + 76), 0xaaaaU);
+    EXPECT_EQ(coreWord(file, note + 20 + 80), 0xbbbbU);
+    EXPECT_EQ(coreWord(file, note + 20 + 84), 0U);
+    EXPECT_LT(file.size(), 0x1000U);
+
+    // Unwritable path - the error goes to GDB's console too
+    cmd   = monitorPkt("dump-core " + testing::TempDir() + "no-such-dir/mgdb_test.core");
+    reply = runPkt(&mgdbObj, cmd.c_str());
+    EXPECT_EQ(reply.substr(0, 2), "$O");
+    EXPECT_EQ(reply.substr(reply.size() - 7), makePkt("E02"));
+
+    // An error the session already had is returned, not cleared by the regions written after it
+    mgdbCoreWriter core;
+    mgdbObj.err = MGDB_ALLOC_FAILED;
+    EXPECT_EQ(minigdbstubDumpCore(&mgdbObj, path.c_str(), &core), MGDB_ALLOC_FAILED);
+    EXPECT_EQ(mgdbObj.err, MGDB_ALLOC_FAILED);
+    remove(path.c_str());
+}
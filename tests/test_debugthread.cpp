@@ -0,0 +1,233 @@
+#include <signal.h>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#define MGDB_SOCK_CONN(usrData) ((mgdbSockConn *)(usrData))
+#include "minigdbstub_socket.h"
+
+#include "minigdbstub_debugthread.h"
+#define MGDB_TEST_OWN_HOOKS
+#include "test_common.hpp"
+
+typedef struct
+{
+    mgdbSockConn conn;  // Must be first (MGDB_SOCK_CONN)
+    mgdbDebugLink link;
+    unsigned int regs[2];  // Counter, pc
+    unsigned char mem[16];
+} threadTarget;
+
+// Target hooks - transport hooks come from minigdbstub_socket.h
+static unsigned char minigdbstubUsrReadMem(size_t addr, void *usrData)
+{
+    return ((threadTarget *)usrData)->mem[addr % 16];
+}
+
+static void minigdbstubUsrWriteMem(size_t addr, unsigned char data, void *usrData)
+{
+    ((threadTarget *)usrData)->mem[addr % 16] = data;
+}
+
+static void minigdbstubUsrContinue(void *usrData)
+{
+    minigdbstubDebugCommand(&((threadTarget *)usrData)->link, MGDB_DEBUG_RESUME);
+}
+
+static void minigdbstubUsrStep(void *usrData)
+{
+    minigdbstubDebugCommand(&((threadTarget *)usrData)->link, MGDB_DEBUG_STEP);
+}
+
+static void minigdbstubUsrProcessBreakpoint(int type, size_t addr, void *usrData) {}
+
+static void minigdbstubUsrKillSession(void *usrData)
+{
+    minigdbstubDebugCommand(&((threadTarget *)usrData)->link, MGDB_DEBUG_KILL);
+}
+
+// Send raw bytes and wait for one reply packet (acks are dropped)
+static std::string threadTransact(int fd, const std::string &out)
+{
+    EXPECT_EQ(write(fd, out.c_str(), out.size()), (ssize_t)out.size());
+    std::string reply;
+    char c;
+    while ((reply.size() < 3) || (reply[reply.size() - 3] != '#'))
+    {
+        if (read(fd, &c, 1) != 1)
+        {
+            break;
+        }
+        if (!reply.empty() || (c == '$'))
+        {
+            reply += c;
+        }
+    }
+    EXPECT_EQ(write(fd, "+", 1), 1);
+    return reply;
+}
+
+// Emulation loop - one "instruction" bumps the counter, the target stops by itself at pc 100
+static void threadTargetRun(threadTarget *target)
+{
+    int cmd = minigdbstubDebugStopped(&target->link, SIGTRAP);
+    while (cmd != MGDB_DEBUG_KILL)
+    {
+        ++target->regs[0];
+        ++target->regs[1];
+        if ((cmd == MGDB_DEBUG_STEP) || (target->regs[1] == 100))
+        {
+            cmd = minigdbstubDebugStopped(&target->link, SIGTRAP);
+            continue;
+        }
+        cmd = minigdbstubDebugPoll(&target->link);
+    }
+}
+
+// --- Tests ---
+
+TEST(minigdbstub, test_debugthread_queue)
+{
+    mgdbSpscQueue q;
+    memset(&q, 0, sizeof(q));
+    mgdbDebugMsg msg = {MGDB_DEBUG_STOPPED, 0};
+    for (int round = 0; round < 3; ++round)
+    {
+        for (int i = 0; i < MGDB_DEBUG_QUEUE_SIZE; ++i)
+        {
+            msg.signalNum = round * 100 + i;
+            EXPECT_EQ(minigdbstubSpscPush(&q, &msg), 1);
+        }
+        EXPECT_EQ(minigdbstubSpscPush(&q, &msg), 0);  // Full
+        for (int i = 0; i < MGDB_DEBUG_QUEUE_SIZE; ++i)
+        {
+            ASSERT_EQ(minigdbstubSpscPop(&q, &msg), 1);
+            EXPECT_EQ(msg.signalNum, round * 100 + i);
+        }
+        EXPECT_EQ(minigdbstubSpscPop(&q, &msg), 0);  // Empty
+    }
+}
+
+TEST(minigdbstub, test_debugthread_session)
+{
+    mgdbSockServer server;
+    ASSERT_EQ(minigdbstubSockListenTcp(&server, "127.0.0.1", 0), MGDB_SUCCESS);
+
+    static threadTarget target;
+    memset(&target, 0, sizeof(target));
+    target.mem[2]  = 0x5a;
+    target.regs[1] = 0x10;
+
+    std::string status, mem, stepped, regs, stopped, interrupted;
+    std::thread client([&]() {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family      = AF_INET;
+        addr.sin_port        = htons((unsigned short)server.port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        int fd               = socket(AF_INET, SOCK_STREAM, 0);
+        ASSERT_EQ(connect(fd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+        status  = threadTransact(fd, makePkt("?"));
+        mem     = threadTransact(fd, makePkt("m2,1"));
+        stepped = threadTransact(fd, makePkt("s"));
+        regs    = threadTransact(fd, makePkt("g"));
+        stopped = threadTransact(fd, makePkt("c"));  // Runs to pc 100
+
+        // Pc is past 100 now - only an interrupt stops the target
+        EXPECT_EQ(write(fd, "$c#63", 5), 5);
+        usleep(10000);
+        interrupted = threadTransact(fd, "\x03");
+        EXPECT_EQ(write(fd, "$k#6b", 5), 5);
+        close(fd);
+    });
+
+    ASSERT_EQ(minigdbstubSockAccept(&server, &target.conn), MGDB_SUCCESS);
+    ASSERT_EQ(minigdbstubDebugLinkInit(&target.link, target.conn.fd), MGDB_SUCCESS);
+    target.link.inputPending = minigdbstubSockInputPending;
+    target.link.inputData    = &target.conn;
+    mgdbProcObj mgdbObj = {0};
+    mgdbObj.regs        = (char *)target.regs;
+    mgdbObj.regsSize    = sizeof(target.regs);
+    mgdbObj.regsCount   = 2;
+    mgdbObj.usrData     = &target;
+    std::thread targetThread(threadTargetRun, &target);
+    minigdbstubDebugServe(&target.link, &mgdbObj);
+    targetThread.join();
+    client.join();
+
+    EXPECT_EQ(status, makePkt("S05"));
+    EXPECT_EQ(mem, makePkt("5a"));
+    EXPECT_EQ(stepped, makePkt("S05"));
+    EXPECT_EQ(regs, makePkt("0100000011000000"));
+    EXPECT_EQ(stopped, makePkt("S05"));
+    EXPECT_EQ(interrupted, makePkt("S02"));
+    EXPECT_GT(target.regs[1], 100U);
+    EXPECT_EQ(target.link.killed, 1);
+    EXPECT_EQ(target.link.stops, 4U);
+
+    minigdbstubDebugLinkClose(&target.link);
+    minigdbstubSockClose(&server, &target.conn);
+    minigdbstubSockServerClose(&server);
+}
+
+TEST(minigdbstub, test_debugthread_reattach)
+{
+    mgdbSockServer server;
+    ASSERT_EQ(minigdbstubSockListenTcp(&server, "127.0.0.1", 0), MGDB_SUCCESS);
+
+    static threadTarget target;
+    memset(&target, 0, sizeof(target));
+    target.regs[1] = 0x10;
+
+    std::string detached, status, regs;
+    std::thread client([&]() {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family      = AF_INET;
+        addr.sin_port        = htons((unsigned short)server.port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        int fd               = socket(AF_INET, SOCK_STREAM, 0);
+        ASSERT_EQ(connect(fd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+        detached = threadTransact(fd, makePkt("D"));
+        close(fd);
+
+        // The target ran on to pc 100 without GDB - the next one finds it there
+        usleep(10000);
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        ASSERT_EQ(connect(fd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+        status = threadTransact(fd, makePkt("?"));
+        regs   = threadTransact(fd, makePkt("g"));
+        EXPECT_EQ(write(fd, "$k#6b", 5), 5);
+        close(fd);
+    });
+
+    ASSERT_EQ(minigdbstubSockAccept(&server, &target.conn), MGDB_SUCCESS);
+    ASSERT_EQ(minigdbstubDebugLinkInit(&target.link, target.conn.fd), MGDB_SUCCESS);
+    mgdbProcObj mgdbObj = {0};
+    mgdbObj.regs        = (char *)target.regs;
+    mgdbObj.regsSize    = sizeof(target.regs);
+    mgdbObj.regsCount   = 2;
+    mgdbObj.usrData     = &target;
+    std::thread targetThread(threadTargetRun, &target);
+    minigdbstubDebugServe(&target.link, &mgdbObj);
+    EXPECT_EQ(mgdbObj.detached, 1);
+    EXPECT_EQ(target.link.killed, 0);
+    minigdbstubSockClose(&server, &target.conn);
+
+    ASSERT_EQ(minigdbstubSockAccept(&server, &target.conn), MGDB_SUCCESS);
+    target.link.inputFd = target.conn.fd;
+    minigdbstubDebugServe(&target.link, &mgdbObj);
+    targetThread.join();
+    client.join();
+
+    EXPECT_EQ(detached, MGDB_OK_PACKET);
+    EXPECT_EQ(status, makePkt("S05"));
+    EXPECT_EQ(regs, makePkt("5400000064000000"));
+    EXPECT_EQ(mgdbObj.reattaches, 1U);
+    EXPECT_EQ(target.link.killed, 1);
+
+    minigdbstubDebugLinkClose(&target.link);
+    minigdbstubSockClose(&server, &target.conn);
+    minigdbstubSockServerClose(&server);
+}
@@ -0,0 +1,76 @@
+#include <signal.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "minigdbstub.h"
+#include "test_common.hpp"
+
+// --- Tests ---
+
+TEST(minigdbstub, test_detach)
+{
+    unsigned int regs[2] = {0x11, 0x22};
+    mgdbProcObj mgdbObj  = {0};
+    mgdbObj.regs         = (char *)regs;
+    mgdbObj.regsSize     = sizeof(regs);
+    mgdbObj.regsCount    = 2;
+    mgdbObj.signalNum    = SIGTRAP;
+
+    // The target outlives GDB - quitting detaches rather than kills
+    EXPECT_EQ(runPkt(&mgdbObj, "qAttached"), makePkt("1"));
+    EXPECT_EQ(runPkt(&mgdbObj, "qAttached:1"), makePkt("1"));
+    int resumed = 0;
+    EXPECT_EQ(runPkt(&mgdbObj, "D", &resumed), MGDB_OK_PACKET);
+    EXPECT_EQ(resumed, 1);
+    EXPECT_EQ(mgdbObj.detached, 1);
+    EXPECT_EQ(mgdbObj.reattaches, 0U);
+
+    // The next GDB's first packet starts a new session - extended mode and vAttach work too
+    EXPECT_EQ(runPkt(&mgdbObj, "!"), MGDB_OK_PACKET);
+    EXPECT_EQ(mgdbObj.detached, 0);
+    EXPECT_EQ(mgdbObj.reattaches, 1U);
+    EXPECT_EQ(runPkt(&mgdbObj, "vAttach;1"), makePkt("S05"));
+    EXPECT_EQ(runPkt(&mgdbObj, "g"), makePkt("1100000022000000"));
+    EXPECT_EQ(mgdbObj.reattaches, 1U);
+}
+
+TEST(minigdbstub, test_detach_breakpoints)
+{
+    mgdbBreakpoint entries[4];
+    mgdbBreakpointTable table;
+    minigdbstubBreakpointInit(&table, entries, 4);
+    testBreak breakObj  = {{0}};
+    mgdbProcObj mgdbObj = {0};
+    mgdbObj.usrData     = &breakObj;
+    mgdbObj.breakpoints = &table;
+
+    EXPECT_EQ(runPkt(&mgdbObj, "Z0,100,4"), MGDB_OK_PACKET);
+    EXPECT_EQ(runPkt(&mgdbObj, "Z0,200,4"), MGDB_OK_PACKET);
+    EXPECT_EQ(breakObj.addr, 0x200U);
+
+    // Nobody to report to while detached - the target runs through its breakpoints
+    EXPECT_EQ(runPkt(&mgdbObj, "D"), MGDB_OK_PACKET);
+    EXPECT_EQ(table.count, 2U);
+    EXPECT_EQ(minigdbstubBreakpointHit(&mgdbObj, 0x100), 0);
+
+    // The new GDB re-sends one of them - already planted, so the target isn't asked again
+    breakObj = {{0}};
+    runPkt(&mgdbObj, "qSupported:multiprocess+");
+    EXPECT_EQ(mgdbObj.reattaches, 1U);
+    EXPECT_EQ(runPkt(&mgdbObj, "Z0,200,4"), MGDB_OK_PACKET);
+    EXPECT_EQ(breakObj.addr, 0U);
+    EXPECT_EQ(minigdbstubBreakpointHit(&mgdbObj, 0x200), 1);
+
+    // The one it didn't re-send goes once the target resumes
+    EXPECT_EQ(runPkt(&mgdbObj, "c"), "");
+    EXPECT_EQ(table.count, 1U);
+    EXPECT_EQ(table.entries[0].addr, 0x200U);
+    EXPECT_EQ(breakObj.addr, 0x100U);
+    EXPECT_EQ(breakObj.bits.isClear, 1U);
+    EXPECT_EQ(breakObj.bits.isSet, 0U);
+    EXPECT_EQ(minigdbstubBreakpointFind(&table, 0x100), (mgdbBreakpoint *)NULL);
+    EXPECT_EQ(table.stops, 1U);
+}
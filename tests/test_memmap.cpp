@@ -0,0 +1,88 @@
+#include <signal.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#define MGDB_USR_MEM_CHECK
+#include "minigdbstub.h"
+#include "test_common.hpp"
+
+// Bytes the target refuses (e.g. an MMIO hole) on top of the memory map
+static size_t g_faultAddr;
+static int g_memChecks;
+
+static int minigdbstubUsrCheckMem(size_t addr, size_t len, int write, void *usrData)
+{
+    ++g_memChecks;
+    return (g_faultAddr - addr < len) ? 0x0e : 0;
+}
+
+// --- Tests ---
+
+TEST(minigdbstub, test_memmap)
+{
+    static const mgdbMemRegion regions[] = {
+        {0x00, 0x10, MGDB_MEM_RAM},
+        {0x10, 0x08, MGDB_MEM_RAM},  // Adjacent regions read as one
+        {0x40, 0x10, MGDB_MEM_ROM},
+    };
+    static const mgdbMemMap map = MGDB_MEM_MAP(regions);
+    std::vector<unsigned char> mem(0x100);
+    for (size_t i = 0; i < mem.size(); ++i)
+    {
+        mem[i] = (unsigned char)i;
+    }
+    g_memHandle = &mem;
+    g_faultAddr = (size_t)-1;
+    g_memChecks = 0;
+
+    mgdbProcObj mgdbObj = {0};
+    mgdbObj.memMap      = &map;
+    EXPECT_EQ(runPkt(&mgdbObj, "qSupported:multiprocess+"), makePkt("qXfer:memory-map:read+"));
+    EXPECT_EQ(runPkt(&mgdbObj, "qXfer:memory-map:read::0,400"),
+              makePkt("l<?xml version=\"1.0\"?>\n<!DOCTYPE memory-map PUBLIC \"+//IDN "
+                      "gnu.org//DTD GDB Memory Map V1.0//EN\" "
+                      "\"http://sourceware.org/gdb/gdb-memory-map.dtd\">\n<memory-map>\n"
+                      "<memory type=\"ram\" start=\"0x0\" length=\"0x10\"/>\n"
+                      "<memory type=\"ram\" start=\"0x10\" length=\"0x8\"/>\n"
+                      "<memory type=\"rom\" start=\"0x40\" length=\"0x10\"/>\n</memory-map>\n"));
+
+    // Reads stop at the end of the mapped range, unmapped ones fail before reaching the hooks
+    EXPECT_EQ(runPkt(&mgdbObj, "m14,8"), makePkt("14151617"));
+    EXPECT_EQ(runPkt(&mgdbObj, "m20,4"), makePkt("E01"));
+    EXPECT_EQ(runPkt(&mgdbObj, "m4e,1"), makePkt("4e"));
+    EXPECT_EQ(g_memChecks, 2);
+
+    // Writes have to fit - and ROM can't be written
+    EXPECT_EQ(runPkt(&mgdbObj, "M16,4:aabbccdd"), makePkt("E01"));
+    EXPECT_EQ(runPkt(&mgdbObj, "M40,1:aa"), makePkt("E01"));
+    EXPECT_EQ(runPkt(&mgdbObj, "M16,2:aabb"), MGDB_OK_PACKET);
+    EXPECT_EQ(mem[0x16], 0xaa);
+    EXPECT_EQ(mem[0x40], 0x40);
+
+    // The target turns down part of a mapped range with its own error number
+    g_faultAddr = 0x6;
+    EXPECT_EQ(runPkt(&mgdbObj, "m4,4"), makePkt("E0e"));
+    EXPECT_EQ(runPkt(&mgdbObj, "M6,1:00"), makePkt("E0e"));
+    EXPECT_EQ(runPkt(&mgdbObj, "m0,4"), makePkt("00010203"));
+}
+
+TEST(minigdbstub, test_memmap_condition)
+{
+    // *(unsigned char *)0x20 == 0 - can't be evaluated, the address isn't mapped
+    const unsigned char cond[] = {0x22, 0x20, 0x17, 0x22, 0x00, 0x13, 0x27};
+    static const mgdbMemRegion regions[] = {{0x00, 0x10, MGDB_MEM_RAM}};
+    static const mgdbMemMap map           = MGDB_MEM_MAP(regions);
+    std::vector<unsigned char> mem(0x100);
+    g_memHandle = &mem;
+    g_faultAddr = (size_t)-1;
+
+    mgdbProcObj mgdbObj = {0};
+    long long result;
+    EXPECT_EQ(minigdbstubAxEval(&mgdbObj, cond, sizeof(cond), &result), MGDB_SUCCESS);
+    EXPECT_EQ(result, 1);
+    mgdbObj.memMap = &map;
+    EXPECT_EQ(minigdbstubAxEval(&mgdbObj, cond, sizeof(cond), &result), MGDB_BAD_FORMAT);
+}
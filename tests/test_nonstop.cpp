@@ -0,0 +1,116 @@
+#include <signal.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#define MGDB_USR_THREADS
+#include "minigdbstub.h"
+#include "test_common.hpp"
+
+static std::vector<std::string> g_threadCalls;
+
+static void minigdbstubUsrResumeThread(size_t threadId, int step, void *usrData)
+{
+    g_threadCalls.push_back((step ? "step " : "resume ") + std::to_string(threadId));
+}
+
+static void minigdbstubUsrStopThread(size_t threadId, void *usrData)
+{
+    g_threadCalls.push_back("stop " + std::to_string(threadId));
+}
+
+// --- Tests ---
+
+TEST(minigdbstub, test_nonstop)
+{
+    unsigned int regs[3][2] = {{0x11, 0x12}, {0x21, 0x22}, {0x31, 0x32}};
+    mgdbThread threads[3];
+    for (size_t i = 0; i < 3; ++i)
+    {
+        threads[i].id   = i + 1;
+        threads[i].regs = (char *)regs[i];
+    }
+    mgdbThreadTable table;
+    minigdbstubThreadInit(&table, threads, 3);
+    EXPECT_EQ(threads[1].running, 0);
+    for (size_t i = 0; i < 3; ++i)
+    {
+        threads[i].running = 1;
+    }
+
+    mgdbProcObj procObj = {0};
+    procObj.regs        = (char *)regs[0];
+    procObj.regsSize    = sizeof(regs[0]);
+    procObj.regsCount   = 2;
+    procObj.threads     = &table;
+    g_threadCalls.clear();
+
+    // GDB only asks for non-stop mode if the stub says it supports it
+    EXPECT_EQ(runPkt(&procObj, "qSupported:multiprocess+"), makePkt("QNonStop+"));
+    EXPECT_EQ(runPkt(&procObj, "QNonStop:1"), MGDB_OK_PACKET);
+    EXPECT_EQ(runPkt(&procObj, "qfThreadInfo"), makePkt("m1,2,3"));
+    EXPECT_EQ(runPkt(&procObj, "qsThreadInfo"), makePkt("l"));
+    EXPECT_EQ(runPkt(&procObj, "T2"), MGDB_OK_PACKET);
+    EXPECT_EQ(runPkt(&procObj, "T9"), MGDB_ERROR_PACKET);
+    EXPECT_EQ(runPkt(&procObj, "vCont?"), makePkt("vCont;c;C;s;S;t"));
+    EXPECT_EQ(runPkt(&procObj, "?"), MGDB_OK_PACKET);  // Everything is running
+
+    // Thread 2 stops - GDB hears about it right away. Thread 3 waits for vStopped
+    std::vector<char> notify;
+    g_putcharPktHandle = &notify;
+    minigdbstubThreadStopped(&procObj, 2, SIGTRAP);
+    minigdbstubThreadStopped(&procObj, 3, 0);
+    EXPECT_EQ(std::string(notify.begin(), notify.end()), makePkt("Stop:T05thread:2;", "%"));
+    EXPECT_EQ(runPkt(&procObj, "vStopped"), makePkt("T00thread:3;"));
+    EXPECT_EQ(runPkt(&procObj, "vStopped"), MGDB_OK_PACKET);
+
+    // Registers follow Hg
+    EXPECT_EQ(runPkt(&procObj, "Hg2"), MGDB_OK_PACKET);
+    EXPECT_EQ(runPkt(&procObj, "g"), makePkt("2100000022000000"));
+    EXPECT_EQ(runPkt(&procObj, "Hg3"), MGDB_OK_PACKET);
+    EXPECT_EQ(runPkt(&procObj, "p1"), makePkt("32000000"));
+    EXPECT_EQ(runPkt(&procObj, "qC"), makePkt("QC3"));
+    EXPECT_EQ(runPkt(&procObj, "Hg7"), MGDB_ERROR_PACKET);
+
+    // Threads resume and stop independently - packets keep being served
+    int resume = -1;
+    EXPECT_EQ(runPkt(&procObj, "vCont;c:2", &resume), MGDB_OK_PACKET);
+    EXPECT_EQ(resume, 0);
+    EXPECT_EQ(runPkt(&procObj, "vCont;t:1"), MGDB_OK_PACKET);
+    EXPECT_EQ(runPkt(&procObj, "vCont;s:3;c"), MGDB_OK_PACKET);
+    ASSERT_EQ(g_threadCalls.size(), 3U);
+    EXPECT_EQ(g_threadCalls[0], "resume 2");
+    EXPECT_EQ(g_threadCalls[1], "stop 1");
+    EXPECT_EQ(g_threadCalls[2], "step 3");
+
+    // '?' reports every stopped thread again
+    notify.clear();
+    g_putcharPktHandle = &notify;
+    minigdbstubThreadStopped(&procObj, 1, SIGINT);
+    EXPECT_EQ(std::string(notify.begin(), notify.end()), makePkt("Stop:T02thread:1;", "%"));
+    EXPECT_EQ(runPkt(&procObj, "vStopped"), MGDB_OK_PACKET);
+    g_putcharPktHandle = &notify;
+    minigdbstubThreadStopped(&procObj, 3, SIGTRAP);
+    EXPECT_EQ(runPkt(&procObj, "vStopped"), MGDB_OK_PACKET);
+    EXPECT_EQ(runPkt(&procObj, "?"), makePkt("T02thread:1;"));
+    EXPECT_EQ(runPkt(&procObj, "vStopped"), makePkt("T05thread:3;"));
+    EXPECT_EQ(runPkt(&procObj, "vStopped"), MGDB_OK_PACKET);
+
+    // All-stop - a stop halts everything, vCont hands control back to the target
+    EXPECT_EQ(runPkt(&procObj, "QNonStop:0"), MGDB_OK_PACKET);
+    notify.clear();
+    g_putcharPktHandle = &notify;
+    minigdbstubThreadStopped(&procObj, 2, SIGTRAP);
+    EXPECT_TRUE(notify.empty());
+    EXPECT_EQ(threads[0].running + threads[1].running + threads[2].running, 0);
+    EXPECT_EQ(runPkt(&procObj, "?"), makePkt("T05thread:2;"));
+    EXPECT_EQ(runPkt(&procObj, "vCont;c", &resume), "");
+    EXPECT_EQ(resume, 1);
+    EXPECT_EQ(g_threadCalls.size(), 6U);
+
+    // Without a thread table 'T' is unsupported rather than a dead thread
+    procObj.threads = NULL;
+    EXPECT_EQ(runPkt(&procObj, "T1"), MGDB_EMPTY_PACKET);
+}
@@ -0,0 +1,135 @@
+#include <signal.h>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "minigdbstub.h"
+#include "test_common.hpp"
+
+typedef struct
+{
+    unsigned int r0;
+    unsigned int pc;
+} profRegs;
+
+static const mgdbRegDesc profRegDescs[] = {
+    MGDB_REG_DESC(profRegs, r0, "r0", MGDB_REG_LITTLE_ENDIAN, "int", "general"),
+    MGDB_REG_DESC(profRegs, pc, "ip", MGDB_REG_LITTLE_ENDIAN, "code_ptr", "general"),
+};
+static const mgdbRegLayout profLayout = MGDB_REG_LAYOUT(NULL, "org.test.cpu", profRegDescs);
+
+// Run a monitor command - returns the console text, followed by the final reply's payload
+static std::string profMonitor(mgdbProcObj *mgdbObj, const std::string &cmd)
+{
+    std::string reply = runPkt(mgdbObj, monitorPkt(cmd).c_str());
+    std::string text;
+    for (size_t pos = 0; pos < reply.size();)
+    {
+        size_t end          = reply.find('#', pos);
+        std::string payload = reply.substr(pos + 1, end - pos - 1);
+        pos                 = end + 3;
+        if ((payload[0] != 'O') || (payload == "OK"))
+        {
+            return text + payload;
+        }
+        for (size_t i = 1; i + 1 < payload.size(); i += 2)
+        {
+            text += (char)strtol(payload.substr(i, 2).c_str(), NULL, 16);
+        }
+    }
+    return text;
+}
+
+// --- Tests ---
+
+TEST(minigdbstub, test_profile)
+{
+    mgdbProfileEntry entries[16];
+    mgdbProfile prof;
+    minigdbstubProfileInit(&prof, entries, 16);
+    profRegs regs       = {0, 0};
+    mgdbProcObj mgdbObj = {0};
+    mgdbObj.regs        = (char *)&regs;
+    mgdbObj.regsSize    = sizeof(regs);
+    mgdbObj.regsCount   = 2;
+
+    // Targets without a profile don't know the command, without a layout there's no pc to sample
+    EXPECT_EQ(runPkt(&mgdbObj, "qRcmd,70726f66696c65207374617274"), MGDB_EMPTY_PACKET);
+    mgdbObj.profile = &prof;
+    EXPECT_EQ(profMonitor(&mgdbObj, "profile start"), "No pc register to sample\nE03");
+    EXPECT_EQ(profMonitor(&mgdbObj, "profile starts"), "");
+
+    // The layout's code_ptr register - a loop spending 3/4 of its time at 0x108
+    mgdbObj.regLayout = &profLayout;
+    EXPECT_EQ(profMonitor(&mgdbObj, "profile start 2"), "Sampling the pc every 2 instructions\nOK");
+    static const unsigned int loop[] = {0x100, 0x104, 0x108, 0x108, 0x108, 0x108, 0x108, 0x108};
+    for (size_t i = 0; i < 800; ++i)
+    {
+        regs.pc = loop[i % 8];
+        minigdbstubProfileTick(&mgdbObj);
+    }
+    EXPECT_EQ(prof.samples, 400U);
+    EXPECT_EQ(profMonitor(&mgdbObj, "profile stop"), "Stopped after 400 samples\nOK");
+    for (size_t i = 0; i < 100; ++i)
+    {
+        minigdbstubProfileTick(&mgdbObj);
+    }
+    EXPECT_EQ(profMonitor(&mgdbObj, "profile dump"),
+              "400 samples, 0 dropped, 2 addresses\n0x108 300\n0x104 100\nOK");
+
+    // Starting again clears the histogram
+    EXPECT_EQ(profMonitor(&mgdbObj, "profile start"),
+              "Sampling the pc every 1000 instructions\nOK");
+    EXPECT_EQ(profMonitor(&mgdbObj, "profile dump"), "0 samples, 0 dropped, 0 addresses\nOK");
+}
+
+TEST(minigdbstub, test_profile_full)
+{
+    mgdbProfileEntry entries[4];
+    mgdbProfile prof;
+    minigdbstubProfileInit(&prof, entries, 4);
+    mgdbProcObj mgdbObj = {0};
+    mgdbObj.profile     = &prof;
+
+    // Every address gets a slot until the table is full - the rest only show up as dropped
+    for (size_t pc = 0; pc < 6; ++pc)
+    {
+        for (size_t n = 0; n <= pc; ++n)
+        {
+            minigdbstubProfileSample(&prof, pc * 4);
+        }
+    }
+    EXPECT_EQ(prof.samples, 21U);
+    EXPECT_EQ(prof.dropped, 11U);
+    EXPECT_EQ(profMonitor(&mgdbObj, "profile dump"),
+              "21 samples, 11 dropped, 4 addresses\n0xc 4\n0x8 3\n0x4 2\n0x0 1\nOK");
+
+    // Long dumps are split over several console packets
+    mgdbProfileEntry bigEntries[256];
+    minigdbstubProfileInit(&prof, bigEntries, 256);
+    for (size_t pc = 0; pc < 200; ++pc)
+    {
+        minigdbstubProfileSample(&prof, 0x10000000 + pc);
+    }
+    std::string dump = profMonitor(&mgdbObj, "profile dump");
+    EXPECT_EQ(dump.substr(0, 37), "200 samples, 0 dropped, 200 addresses");
+    EXPECT_EQ(std::count(dump.begin(), dump.end(), '\n'), 201);
+    EXPECT_EQ(dump.substr(dump.size() - 2), "OK");
+
+    // GDB still gets a reply when the dump can't be built
+    std::vector<char> out;
+    gdbPacket pkt;
+    std::string payload = monitorPkt("profile dump");
+    GTEST_FAIL_IF_ERR(initDynCharBuffer(&pkt.pktData, 64));
+    GTEST_FAIL_IF_ERR(appendDynCharBuffer(&pkt.pktData, payload.c_str(), payload.size() + 1));
+    pkt.commandType    = 'q';
+    g_putcharPktHandle = &out;
+    prof.capacity      = (size_t)1 << 58;
+    minigdbstubDispatch(&mgdbObj, &pkt);
+    freeDynCharBuffer(&pkt.pktData);
+    EXPECT_EQ(mgdbObj.err, MGDB_ALLOC_FAILED);
+    EXPECT_EQ(std::string(out.begin(), out.end()), MGDB_ERROR_PACKET);
+}
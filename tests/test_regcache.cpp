@@ -0,0 +1,107 @@
+#include <signal.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#define MGDB_USR_REG_CALLBACKS
+#include "minigdbstub.h"
+#include "test_common.hpp"
+
+// The target's real register file - the stub only sees it through the hooks
+static unsigned int g_targetRegs[4];
+static std::vector<std::string> g_regCalls;
+
+static void minigdbstubUsrReadReg(size_t index, char *value, void *usrData)
+{
+    g_regCalls.push_back("read " + std::to_string(index));
+    memcpy(value, &g_targetRegs[index], sizeof(g_targetRegs[index]));
+}
+
+static void minigdbstubUsrWriteReg(size_t index, const char *value, void *usrData)
+{
+    g_regCalls.push_back("write " + std::to_string(index));
+    memcpy(&g_targetRegs[index], value, sizeof(g_targetRegs[index]));
+}
+
+// --- Tests ---
+
+TEST(minigdbstub, test_regcache)
+{
+    unsigned int initRegs[4] = {0x11, 0x22, 0x33, 0x44};
+    memcpy(g_targetRegs, initRegs, sizeof(g_targetRegs));
+    unsigned int cacheRegs[4] = {0};
+    unsigned char state[4];
+    mgdbRegCache cache;
+    minigdbstubRegCacheInit(&cache, state, 4);
+
+    mgdbProcObj procObj = {0};
+    procObj.regs        = (char *)cacheRegs;
+    procObj.regsSize    = sizeof(cacheRegs);
+    procObj.regsCount   = 4;
+    procObj.regCache    = &cache;
+    g_regCalls.clear();
+
+    // Only the register GDB asks for is fetched, and only once per stop
+    EXPECT_EQ(runPkt(&procObj, "p2"), makePkt("33000000"));
+    EXPECT_EQ(runPkt(&procObj, "p2"), makePkt("33000000"));
+    EXPECT_EQ(g_regCalls, std::vector<std::string>({"read 2"}));
+
+    // A write stays in the cache until the target resumes
+    EXPECT_EQ(runPkt(&procObj, "P1=55000000"), MGDB_OK_PACKET);
+    EXPECT_EQ(g_targetRegs[1], 0x22U);
+    EXPECT_EQ(runPkt(&procObj, "g"), makePkt("11000000550000003300000044000000"));
+    EXPECT_EQ(g_regCalls, std::vector<std::string>({"read 2", "read 0", "read 3"}));
+    EXPECT_EQ(runPkt(&procObj, "s"), "");
+    EXPECT_EQ(g_targetRegs[1], 0x55U);
+    EXPECT_EQ(cache.fetches, 3U);
+    EXPECT_EQ(cache.writebacks, 1U);
+
+    // Next stop - everything is fetched again, and only written registers go back
+    g_regCalls.clear();
+    g_targetRegs[0] = 0x99;
+    EXPECT_EQ(runPkt(&procObj, "p0"), makePkt("99000000"));
+    EXPECT_EQ(runPkt(&procObj, "G11000000220000003300000066000000"), MGDB_OK_PACKET);
+    EXPECT_EQ(runPkt(&procObj, "c"), "");
+    EXPECT_EQ(g_regCalls, std::vector<std::string>(
+                              {"read 0", "write 0", "write 1", "write 2", "write 3"}));
+    EXPECT_EQ(g_targetRegs[0], 0x11U);
+    EXPECT_EQ(g_targetRegs[3], 0x66U);
+    for (size_t i = 0; i < 4; ++i)
+    {
+        EXPECT_EQ(state[i], 0);
+    }
+}
+
+TEST(minigdbstub, test_regcache_condition)
+{
+    // $r1 == 7 - a condition reads only the registers it names
+    const unsigned char cond[] = {0x26, 0x00, 0x01, 0x22, 0x07, 0x13, 0x27};
+    unsigned int initRegs[4]   = {0, 6, 0, 0};
+    memcpy(g_targetRegs, initRegs, sizeof(g_targetRegs));
+    unsigned int cacheRegs[4] = {0};
+    unsigned char state[4];
+    mgdbRegCache cache;
+    minigdbstubRegCacheInit(&cache, state, 4);
+
+    mgdbProcObj procObj = {0};
+    procObj.regs        = (char *)cacheRegs;
+    procObj.regsSize    = sizeof(cacheRegs);
+    procObj.regsCount   = 4;
+    procObj.regCache    = &cache;
+    g_regCalls.clear();
+
+    long long result;
+    ASSERT_EQ(minigdbstubAxEval(&procObj, cond, sizeof(cond), &result), MGDB_SUCCESS);
+    EXPECT_EQ(result, 0);
+    EXPECT_EQ(g_regCalls, std::vector<std::string>({"read 1"}));
+
+    // The target runs on and changes r1 - a flushed cache fetches it again
+    minigdbstubRegCacheFlush(&procObj);
+    g_targetRegs[1] = 7;
+    ASSERT_EQ(minigdbstubAxEval(&procObj, cond, sizeof(cond), &result), MGDB_SUCCESS);
+    EXPECT_EQ(result, 1);
+    EXPECT_EQ(cache.fetches, 2U);
+    EXPECT_EQ(cache.writebacks, 0U);
+}
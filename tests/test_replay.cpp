@@ -0,0 +1,124 @@
+#include <signal.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "minigdbstub.h"
+#include "minigdbstub_replay.h"
+#include "test_common.hpp"
+
+// Run one stub session over the mock transport, optionally recording it
+static void runSession(const DynCharBuffer &input, std::vector<char> &output,
+                       std::vector<unsigned char> &mem, mgdbSessionRecorder *rec)
+{
+    std::vector<char> inputVec(input.buffer, input.buffer + input.used);
+    g_getcharPktHandle = &inputVec;
+    g_getcharPktIndex  = 0;
+    g_putcharPktHandle = &output;
+    g_memHandle        = &mem;
+
+    int regs[4]         = {1, 2, 3, 4};
+    mgdbProcObj procObj = {0};
+    procObj.regs        = (char *)regs;
+    procObj.regsSize    = sizeof(regs);
+    procObj.regsCount   = 4;
+    procObj.signalNum   = SIGTRAP;
+    if (rec)
+    {
+        procObj.ioTap     = minigdbstubRecorderTap;
+        procObj.ioTapData = rec;
+    }
+    minigdbstubProcess(&procObj);
+    ASSERT_EQ(procObj.err, MGDB_SUCCESS);
+}
+
+// --- Tests ---
+
+TEST(minigdbstub, test_record_replay)
+{
+    DynCharBuffer input;
+    GTEST_FAIL_IF_ERR(initDynCharBuffer(&input, MGDB_PKT_SIZE));
+    GTEST_FAIL_IF_ERR(minigdbstubReplayAppendPacket(&input, "?"));
+    GTEST_FAIL_IF_ERR(minigdbstubReplayAppendPacket(&input, "g"));
+    GTEST_FAIL_IF_ERR(minigdbstubReplayAppendPacket(&input, "m4,4"));
+    GTEST_FAIL_IF_ERR(minigdbstubReplayAppendPacket(&input, "k"));
+
+    std::vector<unsigned char> mem(64, 0xab);
+    std::vector<char> output;
+    std::string path = testing::TempDir() + "mgdb_test_session.rec";
+    mgdbSessionRecorder rec;
+    GTEST_FAIL_IF_ERR(minigdbstubRecorderOpen(&rec, path.c_str()));
+    runSession(input, output, mem, &rec);
+    GTEST_FAIL_IF_ERR(minigdbstubRecorderClose(&rec));
+
+    mgdbSessionLog log;
+    GTEST_FAIL_IF_ERR(minigdbstubSessionLoad(&log, path.c_str()));
+    ASSERT_EQ(log.input.used, input.used);
+    EXPECT_EQ(memcmp(log.input.buffer, input.buffer, input.used), 0);
+    ASSERT_EQ(log.output.used, output.size());
+    EXPECT_EQ(memcmp(log.output.buffer, output.data(), output.size()), 0);
+    EXPECT_EQ(log.chunks, 8U);
+
+    // Replaying against the same target matches byte for byte
+    std::vector<char> replayOut;
+    runSession(log.input, replayOut, mem, NULL);
+    mgdbReplay replay;
+    minigdbstubReplayInit(&replay, &log);
+    for (char c : replayOut)
+    {
+        minigdbstubReplayPutchar(&replay, c);
+    }
+    EXPECT_TRUE(minigdbstubReplayMatched(&replay));
+
+    // A target with different memory diverges at the 'm' reply
+    std::vector<unsigned char> otherMem(64, 0xcd);
+    replayOut.clear();
+    runSession(log.input, replayOut, otherMem, NULL);
+    minigdbstubReplayInit(&replay, &log);
+    for (char c : replayOut)
+    {
+        minigdbstubReplayPutchar(&replay, c);
+    }
+    EXPECT_FALSE(minigdbstubReplayMatched(&replay));
+    EXPECT_EQ(replay.mismatchOffset, std::string(output.begin(), output.end()).find("abab"));
+
+    minigdbstubSessionFree(&log);
+    freeDynCharBuffer(&input);
+    remove(path.c_str());
+}
+
+TEST(minigdbstub, test_replay_eof)
+{
+    mgdbSessionLog log;
+    memset(&log, 0, sizeof(log));
+    GTEST_FAIL_IF_ERR(initDynCharBuffer(&log.input, MGDB_PKT_SIZE));
+    GTEST_FAIL_IF_ERR(initDynCharBuffer(&log.output, MGDB_PKT_SIZE));
+    GTEST_FAIL_IF_ERR(minigdbstubReplayAppendPacket(&log.input, "g"));
+
+    // Input past the end of the recording is a kill packet
+    mgdbReplay replay;
+    minigdbstubReplayInit(&replay, &log);
+    std::string fed;
+    for (size_t i = 0; i < log.input.used + strlen(MGDB_REPLAY_EOF_PACKET); ++i)
+    {
+        fed += minigdbstubReplayGetchar(&replay);
+    }
+    EXPECT_EQ(fed, "$g#67" MGDB_REPLAY_EOF_PACKET);
+    EXPECT_TRUE(minigdbstubReplayDone(&replay));
+    minigdbstubSessionFree(&log);
+}
+
+TEST(minigdbstub, test_replay_bad_file)
+{
+    std::string path = testing::TempDir() + "mgdb_test_bad.rec";
+    FILE *file       = fopen(path.c_str(), "wb");
+    ASSERT_NE(file, nullptr);
+    fputs("NOTAREC!", file);
+    fclose(file);
+
+    mgdbSessionLog log;
+    EXPECT_EQ(minigdbstubSessionLoad(&log, path.c_str()), MGDB_BAD_FORMAT);
+    EXPECT_EQ(minigdbstubSessionLoad(&log, "/nonexistent/mgdb.rec"), MGDB_IO_FAILED);
+    remove(path.c_str());
+}
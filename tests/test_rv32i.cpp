@@ -0,0 +1,81 @@
+#include <memory>
+
+#include "gtest/gtest.h"
+#include "examples/rv32i/rv32i.h"
+
+// --- Tests ---
+
+TEST(minigdbstub, test_rv32i_demo)
+{
+    std::unique_ptr<rv32iCpu> cpu(new rv32iCpu);
+    rv32iReset(cpu.get());
+    EXPECT_EQ(cpu->regs.pc, (uint32_t)RV32I_DEMO_BASE);
+
+    // lui sp + li a0 + jal func
+    for (int i = 0; i < 3; ++i)
+    {
+        ASSERT_EQ(rv32iStep(cpu.get()), RV32I_OK);
+    }
+    EXPECT_EQ(cpu->regs.x[2], (uint32_t)RV32I_DEMO_STACK_TOP);
+    EXPECT_EQ(cpu->regs.x[1], (uint32_t)RV32I_DEMO_BASE + 0xc);
+    EXPECT_EQ(cpu->regs.pc, (uint32_t)RV32I_DEMO_FUNC);
+
+    // Run func three times - every call stores a0 * 2 and returns with the stack balanced
+    for (uint32_t call = 0; call < 3; ++call)
+    {
+        while (cpu->regs.pc != RV32I_DEMO_BASE + 0xc)
+        {
+            ASSERT_EQ(rv32iStep(cpu.get()), RV32I_OK);
+        }
+        EXPECT_EQ(rv32iLoad(cpu.get(), RV32I_DEMO_DATA, 4), call * 2);
+        EXPECT_EQ(rv32iLoad(cpu.get(), RV32I_DEMO_STACK_TOP - 4, 4), RV32I_DEMO_BASE + 0xc);
+        EXPECT_EQ(cpu->regs.x[2], (uint32_t)RV32I_DEMO_STACK_TOP);
+        EXPECT_EQ(cpu->regs.x[5], 0U);  // Countdown loop ran to the end
+        ASSERT_EQ(rv32iStep(cpu.get()), RV32I_OK);  // addi a0, a0, 1
+        ASSERT_EQ(rv32iStep(cpu.get()), RV32I_OK);  // j loop
+        ASSERT_EQ(rv32iStep(cpu.get()), RV32I_OK);  // jal func
+    }
+}
+
+TEST(minigdbstub, test_rv32i_insns)
+{
+    std::unique_ptr<rv32iCpu> cpu(new rv32iCpu);
+    rv32iReset(cpu.get());
+    uint32_t program[] = {
+        0xfff00093,  // li ra, -1
+        0x0010d113,  // srli sp, ra, 1
+        0x4010d193,  // srai gp, ra, 1
+        0x0020a233,  // slt tp, ra, sp
+        0x0020b2b3,  // sltu t0, ra, sp
+        0x00108323,  // sb ra, 6(ra) - 5 after the wrap
+        0x00500383,  // lb t2, 5(zero)
+        0x00504403,  // lbu s0, 5(zero)
+        0x00000517,  // auipc a0, 0
+        0x00100073,  // ebreak
+    };
+    cpu->regs.pc = 0x200;
+    for (size_t i = 0; i < sizeof(program) / sizeof(program[0]); ++i)
+    {
+        rv32iStore(cpu.get(), 0x200 + (uint32_t)(i * 4), 4, program[i]);
+    }
+    for (size_t i = 0; i < 9; ++i)
+    {
+        ASSERT_EQ(rv32iStep(cpu.get()), RV32I_OK);
+    }
+    EXPECT_EQ(cpu->regs.x[2], 0x7fffffffU);
+    EXPECT_EQ(cpu->regs.x[3], 0xffffffffU);
+    EXPECT_EQ(cpu->regs.x[4], 1U);
+    EXPECT_EQ(cpu->regs.x[5], 0U);
+    EXPECT_EQ(cpu->regs.x[7], 0xffffffffU);
+    EXPECT_EQ(cpu->regs.x[8], 0xffU);
+    EXPECT_EQ(cpu->regs.x[10], 0x220U);
+
+    // Traps leave pc on the instruction
+    EXPECT_EQ(rv32iStep(cpu.get()), RV32I_EBREAK);
+    EXPECT_EQ(cpu->regs.pc, 0x224U);
+    cpu->regs.pc = RV32I_MEM_SIZE;
+    EXPECT_EQ(rv32iStep(cpu.get()), RV32I_FAULT);
+    rv32iStore(cpu.get(), 0x300, 4, 0x02208033);  // mul - M extension
+    cpu->regs.pc = 0x300;
+    EXPECT_EQ(rv32iStep(cpu.get()), RV32I_ILLEGAL);
+}
@@ -0,0 +1,262 @@
+#include <signal.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#define MGDB_SNAP_PAGE_SHIFT 8  // Small pages keep the test's memory small
+#include "minigdbstub.h"
+#include "test_common.hpp"
+
+#define SNAP_MEM_SIZE 0x400  // 4 pages
+
+// Deterministic toy target - each instruction adds 3 to r0 and stores it at r0 * stride
+static unsigned int g_snapRegs[2];  // r0, pc
+static size_t g_snapStride;
+
+typedef struct
+{
+    unsigned int regs[2];
+    std::vector<unsigned char> mem;
+} snapState;
+
+static void snapExec(mgdbProcObj *mgdbObj)
+{
+    g_snapRegs[0] += 3;
+    size_t addr = (g_snapRegs[0] * g_snapStride) % SNAP_MEM_SIZE;
+    minigdbstubSnapshotWrite(mgdbObj, addr, 1);
+    (*g_memHandle)[addr] = (unsigned char)g_snapRegs[0];
+    g_snapRegs[1] += 4;
+}
+
+// Execute up to n instructions the way a target loop would - returns the instructions executed
+// before the snapshots stopped it
+static size_t snapRun(mgdbProcObj *mgdbObj, size_t n, std::vector<snapState> *history)
+{
+    size_t executed = 0;
+    while (executed < n)
+    {
+        int ret = minigdbstubSnapshotStep(mgdbObj, g_snapRegs[1]);
+        if (ret == MGDB_SNAP_STOP)
+        {
+            break;
+        }
+        if (ret == MGDB_SNAP_REWOUND)
+        {
+            continue;
+        }
+        snapExec(mgdbObj);
+        ++executed;
+        if (history)
+        {
+            history->push_back({{g_snapRegs[0], g_snapRegs[1]}, *g_memHandle});
+        }
+    }
+    return executed;
+}
+
+// bs/bc - the target only runs if the stub handed control back to it, otherwise returns the reply
+static std::string snapReverse(mgdbProcObj *mgdbObj, const char *payload)
+{
+    std::string reply = runPkt(mgdbObj, payload);
+    if (reply.empty())
+    {
+        snapRun(mgdbObj, 1000, NULL);
+    }
+    return reply;
+}
+
+static void snapExpectState(const snapState &state)
+{
+    EXPECT_EQ(g_snapRegs[0], state.regs[0]);
+    EXPECT_EQ(g_snapRegs[1], state.regs[1]);
+    EXPECT_EQ(*g_memHandle, state.mem);
+}
+
+// --- Tests ---
+
+TEST(minigdbstub, test_snapshot_pages)
+{
+    static unsigned char arena[0x4000];
+    unsigned char bits[MGDB_SNAP_BITS_SIZE(SNAP_MEM_SIZE)];
+    mgdbSnapshots snap;
+    minigdbstubSnapshotInit(&snap, arena, sizeof(arena), bits, SNAP_MEM_SIZE, 16);
+    std::vector<unsigned char> mem(SNAP_MEM_SIZE);
+    g_memHandle = &mem;
+
+    mgdbProcObj mgdbObj = {0};
+    mgdbObj.regs        = (char *)g_snapRegs;
+    mgdbObj.regsSize    = sizeof(g_snapRegs);
+    mgdbObj.regsCount   = 2;
+    mgdbObj.snapshots   = &snap;
+    EXPECT_EQ(runPkt(&mgdbObj, "qSupported:multiprocess+"),
+              makePkt("ReverseStep+;ReverseContinue+"));
+
+    // A single page written - one page record per checkpoint, however many stores
+    memset(g_snapRegs, 0, sizeof(g_snapRegs));
+    g_snapStride = 0;
+    EXPECT_EQ(snapRun(&mgdbObj, 100, NULL), 100U);
+    EXPECT_EQ(snap.checkpoints, 7U);
+    EXPECT_EQ(snap.pagesSaved, 7U);
+
+    // Stores all over memory - every page, once per checkpoint
+    minigdbstubSnapshotInit(&snap, arena, sizeof(arena), bits, SNAP_MEM_SIZE, 16);
+    g_snapStride = 0x55;
+    EXPECT_EQ(snapRun(&mgdbObj, 100, NULL), 100U);
+    EXPECT_EQ(snap.checkpoints, 7U);
+    EXPECT_GT(snap.pagesSaved, 7U);
+    EXPECT_LE(snap.pagesSaved, 7U * 4);
+}
+
+TEST(minigdbstub, test_snapshot_reverse_step)
+{
+    static unsigned char arena[0x4000];
+    unsigned char bits[MGDB_SNAP_BITS_SIZE(SNAP_MEM_SIZE)];
+    mgdbSnapshots snap;
+    minigdbstubSnapshotInit(&snap, arena, sizeof(arena), bits, SNAP_MEM_SIZE, 8);
+    std::vector<unsigned char> mem(SNAP_MEM_SIZE);
+    g_memHandle = &mem;
+    memset(g_snapRegs, 0, sizeof(g_snapRegs));
+    g_snapStride = 0x55;
+
+    mgdbProcObj mgdbObj = {0};
+    mgdbObj.regs        = (char *)g_snapRegs;
+    mgdbObj.regsSize    = sizeof(g_snapRegs);
+    mgdbObj.regsCount   = 2;
+    mgdbObj.snapshots   = &snap;
+
+    std::vector<snapState> history = {{{0, 0}, mem}};
+    EXPECT_EQ(snapRun(&mgdbObj, 20, &history), 20U);
+
+    // Each bs lands on the previous instruction - registers and memory both
+    for (size_t i = 19; i >= 15; --i)
+    {
+        std::string reply = snapReverse(&mgdbObj, "bs");
+        EXPECT_TRUE(reply.empty() || (reply == makePkt("S05")));
+        EXPECT_EQ(snap.icount, i);
+        snapExpectState(history[i]);
+    }
+    EXPECT_GT(snap.pagesRestored, 0U);
+
+    // Going forward again re-records the same history
+    EXPECT_EQ(runPkt(&mgdbObj, "c"), "");
+    EXPECT_EQ(snapRun(&mgdbObj, 5, NULL), 5U);
+    snapExpectState(history[20]);
+
+    // Back to the start of the recording - GDB is told there's no more history
+    while (snap.icount > 0)
+    {
+        snapReverse(&mgdbObj, "bs");
+    }
+    snapExpectState(history[0]);
+    EXPECT_EQ(runPkt(&mgdbObj, "bs"), makePkt("T05replaylog:begin;"));
+}
+
+TEST(minigdbstub, test_snapshot_reverse_continue)
+{
+    static unsigned char arena[0x4000];
+    unsigned char bits[MGDB_SNAP_BITS_SIZE(SNAP_MEM_SIZE)];
+    mgdbSnapshots snap;
+    minigdbstubSnapshotInit(&snap, arena, sizeof(arena), bits, SNAP_MEM_SIZE, 8);
+    std::vector<unsigned char> mem(SNAP_MEM_SIZE);
+    g_memHandle = &mem;
+    memset(g_snapRegs, 0, sizeof(g_snapRegs));
+    g_snapStride = 0x55;
+
+    mgdbBreakpoint entries[2];
+    mgdbBreakpointTable table;
+    minigdbstubBreakpointInit(&table, entries, 2);
+    testBreak breakObj  = {{0}};
+    mgdbProcObj mgdbObj = {0};
+    mgdbObj.usrData     = &breakObj;
+    mgdbObj.regs        = (char *)g_snapRegs;
+    mgdbObj.regsSize    = sizeof(g_snapRegs);
+    mgdbObj.regsCount   = 2;
+    mgdbObj.breakpoints = &table;
+    mgdbObj.snapshots   = &snap;
+
+    std::vector<snapState> history = {{{0, 0}, mem}};
+    EXPECT_EQ(snapRun(&mgdbObj, 40, &history), 40U);
+
+    // Breakpoints at instructions 5 and 30, the second one only while r0 < 50 (it's 90 there)
+    EXPECT_EQ(runPkt(&mgdbObj, "Z0,14,4"), MGDB_OK_PACKET);
+    EXPECT_EQ(runPkt(&mgdbObj, "Z0,78,4;X7,26000022321427"), MGDB_OK_PACKET);
+    EXPECT_EQ(snapReverse(&mgdbObj, "bc"), "");
+    EXPECT_EQ(snap.icount, 5U);
+    snapExpectState(history[5]);
+
+    // Nothing before it - the target stops at the start of the recording
+    EXPECT_EQ(snapReverse(&mgdbObj, "bc"), "");
+    EXPECT_EQ(snap.icount, 0U);
+    snapExpectState(history[0]);
+    std::vector<char> out;
+    g_putcharPktHandle = &out;
+    mgdbObj.signalNum  = SIGTRAP;
+    minigdbstubSendSignal(&mgdbObj);
+    EXPECT_EQ(std::string(out.begin(), out.end()), makePkt("T05replaylog:begin;"));
+}
+
+TEST(minigdbstub, test_snapshot_scan_evicted)
+{
+    static unsigned char arena[0x4000];
+    unsigned char bits[MGDB_SNAP_BITS_SIZE(SNAP_MEM_SIZE)];
+    mgdbSnapshots snap;
+    minigdbstubSnapshotInit(&snap, arena, sizeof(arena), bits, SNAP_MEM_SIZE, 8);
+    std::vector<unsigned char> mem(SNAP_MEM_SIZE);
+    g_memHandle = &mem;
+    memset(g_snapRegs, 0, sizeof(g_snapRegs));
+    g_snapStride = 0x55;
+
+    testBreak breakObj  = {{0}};
+    mgdbProcObj mgdbObj = {0};
+    mgdbObj.usrData     = &breakObj;
+    mgdbObj.regs        = (char *)g_snapRegs;
+    mgdbObj.regsSize    = sizeof(g_snapRegs);
+    mgdbObj.regsCount   = 2;
+    mgdbObj.snapshots   = &snap;
+    EXPECT_EQ(snapRun(&mgdbObj, 20, NULL), 20U);
+
+    // The checkpoints before the scanned interval are gone by the time it ends - stop there
+    EXPECT_EQ(runPkt(&mgdbObj, "bc"), "");
+    snap.checkpoints = 0;
+    EXPECT_EQ(snapRun(&mgdbObj, 1000, NULL), 4U);
+    EXPECT_EQ(snap.icount, 20U);
+    EXPECT_EQ(snap.atBegin, 1);
+    EXPECT_EQ(snap.mode, MGDB_SNAP_RECORDING);
+}
+
+TEST(minigdbstub, test_snapshot_wrap)
+{
+    // Room for three intervals that write every page - older history is dropped as the target runs
+    unsigned char arena[3 * (sizeof(mgdbSnapRecord) * 5 + 8 + 4 * 256)];
+    unsigned char bits[MGDB_SNAP_BITS_SIZE(SNAP_MEM_SIZE)];
+    mgdbSnapshots snap;
+    minigdbstubSnapshotInit(&snap, arena, sizeof(arena), bits, SNAP_MEM_SIZE, 4);
+    std::vector<unsigned char> mem(SNAP_MEM_SIZE);
+    g_memHandle = &mem;
+    memset(g_snapRegs, 0, sizeof(g_snapRegs));
+    g_snapStride = 0x55;
+
+    mgdbProcObj mgdbObj = {0};
+    mgdbObj.regs        = (char *)g_snapRegs;
+    mgdbObj.regsSize    = sizeof(g_snapRegs);
+    mgdbObj.regsCount   = 2;
+    mgdbObj.snapshots   = &snap;
+
+    std::vector<snapState> history = {{{0, 0}, mem}};
+    EXPECT_EQ(snapRun(&mgdbObj, 200, &history), 200U);
+    EXPECT_GE(snap.checkpoints, 1U);
+    EXPECT_LE(snap.checkpoints, 3U);
+    EXPECT_LE(snap.head - snap.tail, sizeof(arena));
+
+    // Whatever is left still replays exactly
+    size_t steps = 0;
+    while (snapReverse(&mgdbObj, "bs") != makePkt("T05replaylog:begin;"))
+    {
+        snapExpectState(history[snap.icount]);
+        ++steps;
+    }
+    EXPECT_GE(steps, 3U);
+    EXPECT_LT(steps, 200U);
+}
@@ -0,0 +1,539 @@
+#include <signal.h>
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+// The connection is the first member of sockTarget
+#define MGDB_SOCK_CONN(usrData) ((mgdbSockConn *)(usrData))
+#include "minigdbstub_socket.h"
+#define MGDB_TEST_OWN_HOOKS
+#include "test_common.hpp"
+
+typedef struct
+{
+    mgdbSockConn conn;
+    std::vector<unsigned char> mem;
+    int killed;
+    int continues;
+} sockTarget;
+
+// Target hooks - transport hooks come from minigdbstub_socket.h
+static unsigned char minigdbstubUsrReadMem(size_t addr, void *usrData)
+{
+    return ((sockTarget *)usrData)->mem[addr];
+}
+
+static void minigdbstubUsrWriteMem(size_t addr, unsigned char data, void *usrData)
+{
+    ((sockTarget *)usrData)->mem[addr] = data;
+}
+
+static void minigdbstubUsrContinue(void *usrData)
+{
+    ++((sockTarget *)usrData)->continues;
+}
+
+static void minigdbstubUsrStep(void *usrData) {}
+
+static void minigdbstubUsrProcessBreakpoint(int type, size_t addr, void *usrData) {}
+
+static void minigdbstubUsrKillSession(void *usrData)
+{
+    ((sockTarget *)usrData)->killed = 1;
+}
+
+static int clientConnectTcp(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons((unsigned short)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) ? fd : -1;
+}
+
+static int clientConnectUnix(const char *path)
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    return (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) ? fd : -1;
+}
+
+// Send a packet and wait for the ack plus a full reply packet
+static std::string clientTransact(int fd, const std::string &pkt, bool expectReply)
+{
+    std::string reply;
+    char buf[1024];
+    EXPECT_EQ(write(fd, pkt.c_str(), pkt.size()), (ssize_t)pkt.size());
+    while (1)
+    {
+        size_t hash = reply.find('#');
+        if (!expectReply ? !reply.empty() : (hash != std::string::npos && reply.size() >= hash + 3))
+        {
+            break;
+        }
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0)
+        {
+            break;
+        }
+        reply.append(buf, n);
+    }
+    return reply;
+}
+
+static void runServerSession(mgdbSockServer *server, sockTarget *target)
+{
+    ASSERT_EQ(minigdbstubSockAccept(server, &target->conn), MGDB_SUCCESS);
+    mgdbProcObj mgdbObj = {0};
+    mgdbObj.usrData     = target;
+    minigdbstubProcess(&mgdbObj);
+    EXPECT_EQ(mgdbObj.err, MGDB_SUCCESS);
+}
+
+// --- Tests ---
+
+TEST(minigdbstub, test_socket_tcp)
+{
+    mgdbSockServer server;
+    ASSERT_EQ(minigdbstubSockListenTcp(&server, "127.0.0.1", 0), MGDB_SUCCESS);
+    ASSERT_GT(server.port, 0);
+
+    sockTarget target;
+    target.mem.assign(16, 0);
+    target.mem[1]    = 0x5a;
+    target.killed    = 0;
+    target.continues = 0;
+
+    std::string memReply, killReply;
+    std::thread client([&]() {
+        int fd = clientConnectTcp(server.port);
+        ASSERT_GE(fd, 0);
+        memReply  = clientTransact(fd, makePkt("m0,4"), true);
+        killReply = clientTransact(fd, makePkt("k"), false);
+        close(fd);
+    });
+    runServerSession(&server, &target);
+    client.join();
+
+    EXPECT_EQ(memReply, "+" + makePkt("005a0000"));
+    EXPECT_EQ(killReply, "+");
+    EXPECT_EQ(target.killed, 1);
+
+    // Ack + reply go out in one writev, the final ack in another
+    EXPECT_EQ(target.conn.writes, 2U);
+    int noDelay      = 0;
+    socklen_t optLen = sizeof(noDelay);
+    getsockopt(target.conn.fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, &optLen);
+    EXPECT_EQ(noDelay, 1);
+
+    minigdbstubSockClose(&server, &target.conn);
+    minigdbstubSockServerClose(&server);
+}
+
+TEST(minigdbstub, test_socket_unix_ring_wrap)
+{
+    std::string path = testing::TempDir() + "mgdb_test.sock";
+    mgdbSockServer server;
+    ASSERT_EQ(minigdbstubSockListenUnix(&server, path.c_str()), MGDB_SUCCESS);
+
+    sockTarget target;
+    target.mem.assign(MGDB_SOCK_RX_SIZE, 0);
+    target.killed    = 0;
+    target.continues = 0;
+
+    // Pipeline enough M packets to wrap both rings several times, then read memory back
+    std::string replies;
+    std::thread client([&]() {
+        int fd = clientConnectUnix(path.c_str());
+        ASSERT_GE(fd, 0);
+        std::string pkts;
+        for (size_t addr = 0; addr < MGDB_SOCK_RX_SIZE; addr += 64)
+        {
+            char hdr[32];
+            snprintf(hdr, sizeof(hdr), "M%zx,40:", addr);
+            std::string payload = hdr;
+            for (size_t i = 0; i < 64; ++i)
+            {
+                char hex[3];
+                snprintf(hex, sizeof(hex), "%02x", (unsigned char)(addr + i));
+                payload += hex;
+            }
+            pkts += makePkt(payload);
+        }
+        EXPECT_EQ(write(fd, pkts.c_str(), pkts.size()), (ssize_t)pkts.size());
+
+        // Drain the acks and OK replies so that only the read's reply is left to wait for
+        std::string okReplies;
+        size_t expected = (MGDB_SOCK_RX_SIZE / 64) * strlen("+" MGDB_OK_PACKET);
+        char buf[1024];
+        while (okReplies.size() < expected)
+        {
+            ssize_t n = read(fd, buf, sizeof(buf));
+            if (n <= 0)
+            {
+                break;
+            }
+            okReplies.append(buf, n);
+        }
+        replies = clientTransact(fd, makePkt("m100,4"), true);
+        close(fd);
+    });
+    runServerSession(&server, &target);
+    client.join();
+
+    for (size_t i = 0; i < target.mem.size(); ++i)
+    {
+        EXPECT_EQ(target.mem[i], (unsigned char)i);
+    }
+    std::string memReply = "+" + makePkt("00010203");
+    ASSERT_GE(replies.size(), memReply.size());
+    EXPECT_EQ(replies.substr(replies.size() - memReply.size()), memReply);
+
+    // Client hung up without 'k' - the session still ended, detached rather than killed
+    EXPECT_EQ(target.conn.err, MGDB_IO_FAILED);
+    EXPECT_EQ(target.killed, 0);
+    minigdbstubSockClose(&server, &target.conn);
+    minigdbstubSockServerClose(&server);
+    unlink(path.c_str());
+}
+
+typedef struct
+{
+    sockTarget targets[3];
+    mgdbProcObj objs[3];
+    int used[3];
+    int closed;
+    int interrupts;
+} muxSlots;
+
+static mgdbSockConn *muxOnAccept(void *ctx)
+{
+    muxSlots *slots = (muxSlots *)ctx;
+    for (int i = 0; i < 3; ++i)
+    {
+        if (!slots->used[i])
+        {
+            slots->used[i]                 = 1;
+            slots->objs[i]                 = mgdbProcObj();
+            slots->objs[i].usrData         = &slots->targets[i];
+            slots->targets[i].conn.mgdbObj = &slots->objs[i];
+            return &slots->targets[i].conn;
+        }
+    }
+    return NULL;
+}
+
+static void muxOnClose(mgdbSockConn *conn, void *ctx)
+{
+    muxSlots *slots = (muxSlots *)ctx;
+    for (int i = 0; i < 3; ++i)
+    {
+        if (&slots->targets[i].conn == conn)
+        {
+            slots->used[i] = 0;
+            ++slots->closed;
+        }
+    }
+}
+
+static void muxOnInterrupt(mgdbSockConn *conn, void *ctx)
+{
+    ++((muxSlots *)ctx)->interrupts;
+    minigdbstubMuxReportStop(conn, SIGINT);
+}
+
+TEST(minigdbstub, test_socket_mux)
+{
+    static muxSlots slots;
+    for (int i = 0; i < 3; ++i)
+    {
+        slots.targets[i].mem.assign(16, (unsigned char)(0x10 * (i + 1)));
+        slots.used[i] = 0;
+    }
+    slots.closed = 0;
+
+    mgdbSockMux mux;
+    memset(&mux, 0, sizeof(mux));
+    ASSERT_EQ(minigdbstubSockListenTcp(&mux.server, "127.0.0.1", 0), MGDB_SUCCESS);
+    mux.onAccept = muxOnAccept;
+    mux.onClose  = muxOnClose;
+    mux.ctx      = &slots;
+
+    // Three GDBs talk to three independent sessions, interleaved, from one client thread
+    std::vector<std::string> replies(3);
+    std::atomic<int> clientDone(0);
+    std::thread client([&]() {
+        int fds[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            fds[i] = clientConnectTcp(mux.server.port);
+            ASSERT_GE(fds[i], 0);
+        }
+        for (int i = 2; i >= 0; --i)
+        {
+            replies[i] = clientTransact(fds[i], makePkt("m0,2"), true);
+        }
+        for (int i = 0; i < 3; ++i)
+        {
+            close(fds[i]);
+        }
+        clientDone = 1;
+    });
+    while (!clientDone || slots.closed < 3)
+    {
+        minigdbstubMuxPoll(&mux, 10);
+    }
+    client.join();
+
+    EXPECT_EQ(replies[0], "+" + makePkt("1010"));
+    EXPECT_EQ(replies[1], "+" + makePkt("2020"));
+    EXPECT_EQ(replies[2], "+" + makePkt("3030"));
+    EXPECT_EQ(mux.packets, 3U);
+    EXPECT_EQ(mux.sessions, 0U);
+    minigdbstubSockServerClose(&mux.server);
+}
+
+TEST(minigdbstub, test_socket_mux_oversized)
+{
+    static muxSlots slots;
+    for (int i = 0; i < 3; ++i)
+    {
+        slots.targets[i].mem.assign(16, (unsigned char)(0x10 * (i + 1)));
+        slots.used[i] = 0;
+    }
+    slots.closed = 0;
+
+    mgdbSockMux mux;
+    memset(&mux, 0, sizeof(mux));
+    ASSERT_EQ(minigdbstubSockListenTcp(&mux.server, "127.0.0.1", 0), MGDB_SUCCESS);
+    mux.onAccept = muxOnAccept;
+    mux.onClose  = muxOnClose;
+    mux.ctx      = &slots;
+
+    // The first GDB sends a packet bigger than the rx ring and stalls half way through it - the
+    // second one is still served meanwhile
+    std::string big = makePkt("M0,900:" + std::string(0x900 * 2, '0'));
+    std::string stalledReply, otherReply, rejectReply, nextReply;
+    std::atomic<int> clientDone(0);
+    std::thread client([&]() {
+        int fds[2];
+        for (int i = 0; i < 2; ++i)
+        {
+            fds[i] = clientConnectTcp(mux.server.port);
+            ASSERT_GE(fds[i], 0);
+            struct timeval timeout = {5, 0};
+            setsockopt(fds[i], SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        }
+        ASSERT_EQ(write(fds[0], big.c_str(), big.size() - 3), (ssize_t)big.size() - 3);
+        otherReply  = clientTransact(fds[1], makePkt("m0,2"), true);
+        rejectReply = clientTransact(fds[0], big.substr(big.size() - 3), true);
+        nextReply   = clientTransact(fds[0], makePkt("m0,2"), true);
+        for (int i = 0; i < 2; ++i)
+        {
+            close(fds[i]);
+        }
+        clientDone = 1;
+    });
+    while (!clientDone || (mux.sessions > 0))
+    {
+        minigdbstubMuxPoll(&mux, 10);
+    }
+    client.join();
+
+    EXPECT_EQ(otherReply, "+" + makePkt("2020"));
+    EXPECT_EQ(rejectReply, "+" MGDB_ERROR_PACKET);
+    EXPECT_EQ(nextReply, "+" + makePkt("1010"));
+    EXPECT_EQ(slots.targets[0].mem[0], 0x10);
+    EXPECT_EQ(mux.packets, 2U);
+    EXPECT_EQ(mux.sessions, 0U);
+    minigdbstubSockServerClose(&mux.server);
+}
+
+TEST(minigdbstub, test_socket_mux_stalled_reader)
+{
+    static muxSlots slots;
+    for (int i = 0; i < 3; ++i)
+    {
+        slots.targets[i].mem.assign(0x800, (unsigned char)(0x10 * (i + 1)));
+        slots.used[i] = 0;
+    }
+    slots.closed = 0;
+
+    mgdbSockMux mux;
+    memset(&mux, 0, sizeof(mux));
+    ASSERT_EQ(minigdbstubSockListenTcp(&mux.server, "127.0.0.1", 0), MGDB_SUCCESS);
+    mux.onAccept = muxOnAccept;
+    mux.onClose  = muxOnClose;
+    mux.ctx      = &slots;
+
+    // The first GDB pipelines far more reads than the socket holds and doesn't read the replies -
+    // the second one is still served while the first session's replies wait for EPOLLOUT
+    const int reads = 2000;  // Replies well beyond what the socket buffers hold
+    std::string hex, expected, pending, otherReply;
+    for (int i = 0; i < 0x800; ++i)
+    {
+        hex += "10";
+    }
+    for (int i = 0; i < reads; ++i)
+    {
+        expected += "+" + makePkt(hex);
+    }
+    std::atomic<int> clientDone(0);
+    std::thread client([&]() {
+        int fds[2];
+        for (int i = 0; i < 2; ++i)
+        {
+            fds[i] = clientConnectTcp(mux.server.port);
+            ASSERT_GE(fds[i], 0);
+            struct timeval timeout = {5, 0};
+            setsockopt(fds[i], SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        }
+        std::string flood;
+        for (int i = 0; i < reads; ++i)
+        {
+            flood += makePkt("m0,800");
+        }
+        ASSERT_EQ(write(fds[0], flood.c_str(), flood.size()), (ssize_t)flood.size());
+        for (int i = 0; (i < 5000) && !__atomic_load_n(&slots.targets[0].conn.txArmed,
+                                                        __ATOMIC_ACQUIRE); ++i)
+        {
+            usleep(1000);
+        }
+        EXPECT_TRUE(__atomic_load_n(&slots.targets[0].conn.txArmed, __ATOMIC_ACQUIRE));
+        otherReply = clientTransact(fds[1], makePkt("m0,2"), true);
+
+        char buf[65536];
+        ssize_t n;
+        while ((pending.size() < expected.size()) && ((n = read(fds[0], buf, sizeof(buf))) > 0))
+        {
+            pending.append(buf, n);
+        }
+        for (int i = 0; i < 2; ++i)
+        {
+            close(fds[i]);
+        }
+        clientDone = 1;
+    });
+    while (!clientDone || (mux.sessions > 0))
+    {
+        minigdbstubMuxPoll(&mux, 10);
+    }
+    client.join();
+
+    EXPECT_EQ(otherReply, "+" + makePkt("2020"));
+    EXPECT_TRUE(pending == expected);
+    EXPECT_EQ(mux.packets, (size_t)reads + 1);
+    minigdbstubSockServerClose(&mux.server);
+}
+
+TEST(minigdbstub, test_socket_mux_interrupt)
+{
+    static muxSlots slots;
+    for (int i = 0; i < 3; ++i)
+    {
+        slots.targets[i].mem.assign(16, (unsigned char)(0x10 * (i + 1)));
+        slots.targets[i].continues = 0;
+        slots.used[i]              = 0;
+    }
+    slots.closed     = 0;
+    slots.interrupts = 0;
+
+    mgdbSockMux mux;
+    memset(&mux, 0, sizeof(mux));
+    ASSERT_EQ(minigdbstubSockListenTcp(&mux.server, "127.0.0.1", 0), MGDB_SUCCESS);
+    mux.onAccept = muxOnAccept;
+    mux.onClose  = muxOnClose;
+    mux.ctx      = &slots;
+
+    // GDB resumes the target and interrupts it with ^C - once through onInterrupt, once without
+    std::string stopReplies[2], memReply;
+    std::atomic<int> clientDone(0);
+    std::atomic<int> hooked(1);
+    std::thread client([&]() {
+        int fd = clientConnectTcp(mux.server.port);
+        ASSERT_GE(fd, 0);
+        struct timeval timeout = {5, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        for (int i = 0; i < 2; ++i)
+        {
+            hooked = (i == 0);
+            EXPECT_EQ(clientTransact(fd, makePkt("c"), false), "+");
+            stopReplies[i] = clientTransact(fd, "\x03", true);
+        }
+        memReply = clientTransact(fd, makePkt("m0,2"), true);
+        close(fd);
+        clientDone = 1;
+    });
+    while (!clientDone || (mux.sessions > 0))
+    {
+        mux.onInterrupt = hooked ? muxOnInterrupt : NULL;
+        minigdbstubMuxPoll(&mux, 10);
+    }
+    client.join();
+
+    EXPECT_EQ(stopReplies[0], makePkt("S02"));
+    EXPECT_EQ(stopReplies[1], makePkt("S02"));
+    EXPECT_EQ(memReply, "+" + makePkt("1010"));
+    EXPECT_EQ(slots.interrupts, 1);
+    EXPECT_EQ(slots.targets[0].continues, 3);  // Both 'c's, then the hang-up resumes it
+    EXPECT_EQ(mux.packets, 3U);
+    minigdbstubSockServerClose(&mux.server);
+}
+
+TEST(minigdbstub, test_socket_mux_drop_running)
+{
+    static muxSlots slots;
+    for (int i = 0; i < 3; ++i)
+    {
+        slots.targets[i].mem.assign(16, 0);
+        slots.targets[i].continues = 0;
+        slots.used[i]              = 0;
+    }
+    slots.closed = 0;
+
+    mgdbSockMux mux;
+    memset(&mux, 0, sizeof(mux));
+    ASSERT_EQ(minigdbstubSockListenTcp(&mux.server, "127.0.0.1", 0), MGDB_SUCCESS);
+    mux.onAccept = muxOnAccept;
+    mux.onClose  = muxOnClose;
+    mux.ctx      = &slots;
+
+    // One GDB hangs up while its target is stopped, the other after resuming it with 'c'
+    std::atomic<int> clientDone(0);
+    std::thread client([&]() {
+        int fds[2];
+        for (int i = 0; i < 2; ++i)
+        {
+            fds[i] = clientConnectTcp(mux.server.port);
+            ASSERT_GE(fds[i], 0);
+        }
+        clientTransact(fds[0], makePkt("m0,2"), true);
+        clientTransact(fds[1], makePkt("c"), false);
+        for (int i = 0; i < 2; ++i)
+        {
+            close(fds[i]);
+        }
+        clientDone = 1;
+    });
+    while (!clientDone || (mux.sessions > 0))
+    {
+        minigdbstubMuxPoll(&mux, 10);
+    }
+    client.join();
+
+    // The stopped target is resumed on the hang-up, the running one isn't resumed a second time
+    EXPECT_EQ(slots.targets[0].continues, 1);
+    EXPECT_EQ(slots.targets[1].continues, 1);
+    EXPECT_EQ(slots.objs[0].detached, 1);
+    EXPECT_EQ(slots.objs[1].detached, 1);
+    minigdbstubSockServerClose(&mux.server);
+}
@@ -0,0 +1,80 @@
+#include <signal.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+// Only mgdb::Stub targets in this file - no minigdbstubUsr* hooks
+#define MGDB_NO_USR_HOOKS
+#include "minigdbstub.hpp"
+#define MGDB_TEST_OWN_HOOKS
+#include "test_common.hpp"
+
+// Scripted GDB side shared by the test targets
+struct ScriptedIo
+{
+    std::string in, out;
+    size_t inPos = 0;
+    int flushes  = 0;
+
+    void putChar(char data) { out += data; }
+    char getChar() { return in[inPos++]; }
+    void cont() {}
+    void step() {}
+    void processBreakpoint(int type, size_t addr) {}
+    void killSession() {}
+};
+
+// Flat RAM target with a flush hook
+struct RamTarget : ScriptedIo
+{
+    unsigned char mem[16];
+
+    void writeMem(size_t addr, unsigned char data) { mem[addr] = data; }
+    unsigned char readMem(size_t addr) { return mem[addr]; }
+    void flush() { ++flushes; }
+};
+
+// Target whose memory is computed from the address - no flush hook
+struct PatternTarget : ScriptedIo
+{
+    size_t lastWrite = 0;
+
+    void writeMem(size_t addr, unsigned char data) { lastWrite = addr; }
+    unsigned char readMem(size_t addr) { return (unsigned char)(0xa0 + addr); }
+};
+
+// --- Tests ---
+
+TEST(minigdbstub, test_cpp_stub)
+{
+    RamTarget ram;
+    memset(ram.mem, 0, sizeof(ram.mem));
+    unsigned int ramRegs[2] = {0x11223344, 0x55667788};
+    ram.in = makePkt("M2,2:beef") + "+" + makePkt("m1,3") + "+" + makePkt("g") + "+" + makePkt("k");
+    mgdb::Stub<RamTarget> ramStub(ram, ramRegs, sizeof(ramRegs), 2);
+    ramStub.process();
+    EXPECT_EQ(ramStub.err(), MGDB_SUCCESS);
+    EXPECT_EQ(ram.mem[2], 0xbe);
+    EXPECT_EQ(ram.mem[3], 0xef);
+    EXPECT_EQ(ram.out, std::string("+" MGDB_OK_PACKET "+") + makePkt("00beef") + "+" +
+                           makePkt("4433221188776655") + "+");
+    EXPECT_GT(ram.flushes, 0);
+
+    // A second target type in the same binary
+    PatternTarget pattern;
+    unsigned char patternRegs[1] = {0x7f};
+    pattern.in = makePkt("m4,2") + "+" + makePkt("p0") + "+" + makePkt("M9,1:00") + "+" +
+                 makePkt("c");
+    mgdb::Stub<PatternTarget> patternStub(pattern, patternRegs, sizeof(patternRegs), 1);
+    patternStub.process();
+    EXPECT_EQ(patternStub.err(), MGDB_SUCCESS);
+    EXPECT_EQ(pattern.out,
+              "+" + makePkt("a4a5") + "+" + makePkt("7f") + "+" MGDB_OK_PACKET "+");
+    EXPECT_EQ(pattern.lastWrite, 9U);
+
+    // Stop reply once the target halts again
+    patternStub.sendSignal(SIGTRAP);
+    EXPECT_EQ(pattern.out.substr(pattern.out.size() - 7), makePkt("S05"));
+}
@@ -0,0 +1,146 @@
+#include <signal.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Capture logs instead of printing them - trace logs are compiled out at this level
+static std::string g_logSink;
+#define MGDB_LOG_LEVEL MGDB_LOG_LEVEL_WARN
+#define MGDB_LOG_SINK(level, ...)                      \
+    do                                                 \
+    {                                                  \
+        char logBuf[256];                              \
+        snprintf(logBuf, sizeof(logBuf), __VA_ARGS__); \
+        g_logSink += logBuf;                           \
+    } while (0)
+
+#include "gtest/gtest.h"
+#include "minigdbstub.h"
+#include "test_common.hpp"
+
+static void collectRecord(const mgdbTraceRecord *record, void *ctx)
+{
+    std::vector<mgdbTraceRecord> *records = (std::vector<mgdbTraceRecord> *)ctx;
+    records->push_back(*record);
+}
+
+// --- Tests ---
+
+TEST(minigdbstub, test_log_level)
+{
+    g_logSink.clear();
+    MGDB_LOG_W("warn %d\n", 1);
+    MGDB_LOG_I("info %d\n", 2);
+    MGDB_LOG_TRACE("trace %d\n", 3);
+    EXPECT_NE(g_logSink.find("warn 1"), std::string::npos);
+    EXPECT_EQ(g_logSink.find("info 2"), std::string::npos);
+    EXPECT_EQ(g_logSink.find("trace 3"), std::string::npos);
+}
+
+TEST(minigdbstub, test_trace_ring)
+{
+    const char *packet = "+$m8,4#05";
+    std::vector<char> getcharBuf(packet, packet + strlen(packet));
+    g_getcharPktHandle = &getcharBuf;
+    g_getcharPktIndex  = 0;
+    std::vector<char> putcharBuf;
+    g_putcharPktHandle = &putcharBuf;
+
+    mgdbTraceRecord records[4];
+    mgdbTraceRing ring;
+    minigdbstubTraceInit(&ring, records, 4);
+
+    g_logSink.clear();
+    mgdbProcObj procObj          = {0};
+    procObj.opts.o_enableLogging = 1;
+    procObj.traceRing            = &ring;
+    gdbPacket gdbPkt;
+    GTEST_FAIL_IF_ERR(initDynCharBuffer(&gdbPkt.pktData, MGDB_PKT_SIZE));
+    minigdbstubRecv(&procObj, &gdbPkt);
+    GTEST_FAIL_IF_ERR(procObj.err);
+    freeDynCharBuffer(&gdbPkt.pktData);
+    EXPECT_TRUE(g_logSink.empty());
+
+    // Received packet followed by the ACK
+    std::vector<mgdbTraceRecord> dumped;
+    minigdbstubTraceDump(&ring, collectRecord, &dumped);
+    ASSERT_EQ(dumped.size(), 2U);
+    EXPECT_EQ(dumped[0].dir, MGDB_TRACE_RECV);
+    EXPECT_EQ(std::string(dumped[0].data, dumped[0].length), "m8,4");
+    EXPECT_EQ(dumped[1].dir, MGDB_TRACE_SEND);
+    EXPECT_EQ(std::string(dumped[1].data, dumped[1].length), MGDB_ACK_PACKET);
+    EXPECT_LE(dumped[0].timestamp, dumped[1].timestamp);
+}
+
+TEST(minigdbstub, test_trace_ring_wrap)
+{
+    std::vector<char> putcharBuf;
+    g_putcharPktHandle = &putcharBuf;
+
+    mgdbTraceRecord records[4];
+    mgdbTraceRing ring;
+    minigdbstubTraceInit(&ring, records, 4);
+    mgdbProcObj procObj = {0};
+    procObj.traceRing   = &ring;
+
+    const char *packets[] = {"$a#61", "$b#62", "$c#63", "$d#64", "$e#65", "$f#66"};
+    for (auto pkt : packets)
+    {
+        minigdbstubSend(pkt, &procObj);
+    }
+
+    // Only the newest records survive, oldest first
+    std::vector<mgdbTraceRecord> dumped;
+    minigdbstubTraceDump(&ring, collectRecord, &dumped);
+    ASSERT_EQ(dumped.size(), 4U);
+    for (size_t i = 0; i < dumped.size(); ++i)
+    {
+        EXPECT_EQ(std::string(dumped[i].data, dumped[i].length), packets[i + 2]);
+        EXPECT_EQ(dumped[i].seq, (i + 3) * 2);
+    }
+}
+
+TEST(minigdbstub, test_trace_ring_truncate)
+{
+    std::vector<char> putcharBuf;
+    g_putcharPktHandle = &putcharBuf;
+
+    mgdbTraceRecord records[2];
+    mgdbTraceRing ring;
+    minigdbstubTraceInit(&ring, records, 2);
+    mgdbProcObj procObj = {0};
+    procObj.traceRing   = &ring;
+
+    std::string longPkt = "$" + std::string(MGDB_TRACE_RECORD_SIZE * 2, 'a') + "#00";
+    minigdbstubSend(longPkt.c_str(), &procObj);
+
+    std::vector<mgdbTraceRecord> dumped;
+    minigdbstubTraceDump(&ring, collectRecord, &dumped);
+    ASSERT_EQ(dumped.size(), 1U);
+    EXPECT_EQ(dumped[0].length, longPkt.size());
+    EXPECT_EQ(std::string(dumped[0].data, MGDB_TRACE_RECORD_SIZE),
+              longPkt.substr(0, MGDB_TRACE_RECORD_SIZE));
+}
+
+TEST(minigdbstub, test_trace_ring_claimed_slot)
+{
+    mgdbTraceRecord records[2];
+    mgdbTraceRing ring;
+    minigdbstubTraceInit(&ring, records, 2);
+    minigdbstubTraceRecord(&ring, MGDB_TRACE_RECV, "$a#61", 5);
+    minigdbstubTraceRecord(&ring, MGDB_TRACE_RECV, "$b#62", 5);
+
+    // A slot a writer still holds (odd seq) is skipped by readers
+    records[1].seq |= 1;
+    std::vector<mgdbTraceRecord> dumped;
+    minigdbstubTraceDump(&ring, collectRecord, &dumped);
+    ASSERT_EQ(dumped.size(), 1U);
+    EXPECT_EQ(std::string(dumped[0].data, dumped[0].length), "$a#61");
+
+    // A writer that was lapped never overwrites the newer record in its slot
+    records[1].seq = 6;
+    ring.head      = 1;
+    minigdbstubTraceRecord(&ring, MGDB_TRACE_SEND, "$c#63", 5);
+    EXPECT_EQ(records[1].seq, 6U);
+    EXPECT_EQ(std::string(records[1].data, records[1].length), "$b#62");
+}
@@ -0,0 +1,199 @@
+#include <signal.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "minigdbstub.h"
+#include "test_common.hpp"
+
+// --- Tests ---
+
+TEST(minigdbstub, test_tracepoint_collect)
+{
+    std::vector<unsigned char> mem(0x100, 0);
+    g_memHandle          = &mem;
+    unsigned int regs[4] = {0x10, 0x20, 0x30, 0x400};
+
+    mgdbTracepoint defs[4];
+    unsigned char frames[512];
+    mgdbTracepoints tp;
+    minigdbstubTracepointInit(&tp, defs, 4, frames, sizeof(frames));
+
+    testBreak breakObj  = {{0}};
+    mgdbProcObj procObj = {0};
+    procObj.usrData     = &breakObj;
+    procObj.regs        = (char *)regs;
+    procObj.regsSize    = sizeof(regs);
+    procObj.regsCount   = 4;
+    procObj.tracepoints = &tp;
+
+    EXPECT_EQ(runPkt(&procObj, "qTStatus").substr(0, 13), "$T0;tnotrun:0");
+    EXPECT_EQ(runPkt(&procObj, "QTinit"), MGDB_OK_PACKET);
+    EXPECT_EQ(runPkt(&procObj, "QTDP:1:400:E:0:0-"), MGDB_OK_PACKET);
+    EXPECT_EQ(runPkt(&procObj, "QTDP:-1:400:Rf-"), MGDB_OK_PACKET);
+    EXPECT_EQ(runPkt(&procObj, "QTDP:-1:400:M-1,10,4-"), MGDB_OK_PACKET);
+    EXPECT_EQ(runPkt(&procObj, "QTDP:-1:400:M0,20,2-"), MGDB_OK_PACKET);
+    // reg 1, trace_quick 4, end
+    EXPECT_EQ(runPkt(&procObj, "QTDP:-1:400:X6,2600010d0427"), MGDB_OK_PACKET);
+    EXPECT_EQ(runPkt(&procObj, "QTDP:-7:400:R1"), MGDB_ERROR_PACKET);  // Undefined
+    EXPECT_EQ(runPkt(&procObj, "QTBuffer:circular:0"), MGDB_OK_PACKET);
+    ASSERT_EQ(tp.defCount, 1U);
+    EXPECT_EQ(defs[0].memCount, 2U);
+    EXPECT_EQ(defs[0].mem[0].baseReg, -1);
+    EXPECT_EQ(defs[0].exprCount, 1U);
+
+    EXPECT_EQ(runPkt(&procObj, "QTStart"), MGDB_OK_PACKET);
+    EXPECT_EQ(breakObj.addr, 0x400U);
+    EXPECT_EQ(breakObj.bits.softBreak, 1U);
+    EXPECT_EQ(breakObj.bits.isSet, 1U);
+
+    // Tracepoint-only locations don't stop the target, anything else still does
+    for (unsigned char k = 0; k < 3; ++k)
+    {
+        regs[3]       = 0x400 + k;
+        mem[0x10]     = k;
+        mem[0x30]     = 0xa0 + k;
+        mem[0x20 + k] = 0xee;
+        EXPECT_EQ(minigdbstubBreakpointHit(&procObj, 0x400), 0);
+    }
+    EXPECT_EQ(minigdbstubBreakpointHit(&procObj, 0x500), 1);
+    EXPECT_EQ(runPkt(&procObj, "qTStatus").substr(0, 41),
+              "$T1;tframes:3;tcreated:3;tsize:200;tfree:");
+    EXPECT_EQ(runPkt(&procObj, "QTStop"), MGDB_OK_PACKET);
+    EXPECT_EQ(breakObj.bits.isClear, 1U);
+    EXPECT_EQ(runPkt(&procObj, "qTStatus").substr(0, 22), "$T0;tstop::0;tframes:3");
+
+    // tfind 1 - registers and memory come from the frame
+    regs[3] = 0;
+    EXPECT_EQ(runPkt(&procObj, "QTFrame:1"), makePkt("F1T1"));
+    EXPECT_EQ(runPkt(&procObj, "g"), makePkt("10000000200000003000000001040000"));
+    EXPECT_EQ(runPkt(&procObj, "p3"), makePkt("01040000"));
+    EXPECT_EQ(runPkt(&procObj, "m10,4"), makePkt("01000000"));
+    EXPECT_EQ(runPkt(&procObj, "m30,2"), makePkt("a100"));
+    EXPECT_EQ(runPkt(&procObj, "m20,4"), makePkt("eeee0000"));
+    EXPECT_EQ(runPkt(&procObj, "m12,8"), makePkt("0000"));  // Trimmed to the block
+    EXPECT_EQ(runPkt(&procObj, "m80,1"), MGDB_ERROR_PACKET);  // Not collected
+
+    // tfind pc - searches after the selected frame
+    EXPECT_EQ(runPkt(&procObj, "QTFrame:pc:400"), makePkt("F2T1"));
+    EXPECT_EQ(runPkt(&procObj, "m10,1"), makePkt("02"));
+    EXPECT_EQ(runPkt(&procObj, "QTFrame:pc:400"), makePkt("F-1"));
+    EXPECT_EQ(runPkt(&procObj, "QTFrame:range:0:400"), makePkt("F0T1"));
+
+    // tfind none - back to the live target
+    EXPECT_EQ(runPkt(&procObj, "QTFrame:ffffffff"), MGDB_OK_PACKET);
+    EXPECT_EQ(runPkt(&procObj, "p3"), makePkt("00000000"));
+}
+
+TEST(minigdbstub, test_tracepoint_tracenz_unmapped)
+{
+    std::vector<unsigned char> mem(0x100, 0x55);
+    g_memHandle = &mem;
+    static const mgdbMemRegion regions[] = {{0x00, 0x100, MGDB_MEM_RAM}};
+    static const mgdbMemMap map           = MGDB_MEM_MAP(regions);
+
+    mgdbTracepoint defs[1];
+    unsigned char frames[256];
+    mgdbTracepoints tp;
+    minigdbstubTracepointInit(&tp, defs, 1, frames, sizeof(frames));
+
+    testBreak breakObj  = {{0}};
+    mgdbProcObj procObj = {0};
+    procObj.usrData     = &breakObj;
+    procObj.memMap      = &map;
+    procObj.tracepoints = &tp;
+
+    // const8 f0, const8 40, tracenz, const8 0, end - the string runs off the end of the map
+    EXPECT_EQ(runPkt(&procObj, "QTDP:1:400:E:0:0-"), MGDB_OK_PACKET);
+    EXPECT_EQ(runPkt(&procObj, "QTDP:-1:400:X8,22f022402f220027"), MGDB_OK_PACKET);
+    EXPECT_EQ(runPkt(&procObj, "QTStart"), MGDB_OK_PACKET);
+    EXPECT_EQ(minigdbstubBreakpointHit(&procObj, 0x400), 0);
+    EXPECT_EQ(runPkt(&procObj, "QTStop"), MGDB_OK_PACKET);
+
+    // Collection stopped at the last mapped byte
+    EXPECT_EQ(runPkt(&procObj, "QTFrame:0"), makePkt("F0T1"));
+    EXPECT_EQ(runPkt(&procObj, "mf0,40"), makePkt(std::string(0x10 * 2, '5')));
+}
+
+TEST(minigdbstub, test_tracepoint_circular)
+{
+    std::vector<unsigned char> mem(0x10, 0);
+    g_memHandle          = &mem;
+    unsigned int regs[2] = {0, 0};
+
+    // Room for exactly three frames of one 4 byte memory block
+    mgdbTracepoint defs[1];
+    unsigned char frames[3 * (sizeof(mgdbTraceFrameHdr) + sizeof(mgdbTraceBlock) + 4)];
+    mgdbTracepoints tp;
+    minigdbstubTracepointInit(&tp, defs, 1, frames, sizeof(frames));
+
+    testBreak breakObj  = {{0}};
+    mgdbProcObj procObj = {0};
+    procObj.usrData     = &breakObj;
+    procObj.regs        = (char *)regs;
+    procObj.regsSize    = sizeof(regs);
+    procObj.regsCount   = 2;
+    procObj.tracepoints = &tp;
+
+    // Pass count 5, condition "$r0" (reg 0, end), collect *(int *)0
+    EXPECT_EQ(runPkt(&procObj, "QTinit"), MGDB_OK_PACKET);
+    EXPECT_EQ(runPkt(&procObj, "QTDP:2:600:E:0:5:X4,26000027-"), MGDB_OK_PACKET);
+    EXPECT_EQ(runPkt(&procObj, "QTDP:-2:600:M-1,0,4"), MGDB_OK_PACKET);
+    EXPECT_EQ(runPkt(&procObj, "QTDP:3:700:E:0:0"), MGDB_ERROR_PACKET);  // Table full
+    EXPECT_EQ(runPkt(&procObj, "QTStart"), MGDB_OK_PACKET);
+
+    EXPECT_EQ(minigdbstubBreakpointHit(&procObj, 0x600), 0);  // Condition false - no frame
+    regs[0] = 1;
+    for (unsigned char k = 0; k < 5; ++k)
+    {
+        mem[0] = k;
+        EXPECT_EQ(minigdbstubBreakpointHit(&procObj, 0x600), 0);
+    }
+    EXPECT_EQ(breakObj.bits.isClear, 1U);  // Pass count reached - tracepoints removed
+    EXPECT_EQ(runPkt(&procObj, "qTStatus"),
+              makePkt("T0;tpasscount:2;tframes:3;tcreated:5;tsize:9c;tfree:0;circular:1"));
+
+    // The two oldest frames were overwritten
+    EXPECT_EQ(runPkt(&procObj, "QTFrame:0"), makePkt("F-1"));
+    EXPECT_EQ(runPkt(&procObj, "QTFrame:tdp:2"), makePkt("F2T2"));
+    EXPECT_EQ(runPkt(&procObj, "m0,4"), makePkt("02000000"));
+    EXPECT_EQ(runPkt(&procObj, "QTFrame:tdp:2"), makePkt("F3T2"));
+    EXPECT_EQ(runPkt(&procObj, "m0,4"), makePkt("03000000"));
+
+    // Registers weren't collected
+    EXPECT_EQ(runPkt(&procObj, "g"), makePkt("xxxxxxxxxxxxxxxx"));
+    EXPECT_EQ(runPkt(&procObj, "p1"), makePkt("xxxxxxxx"));
+    EXPECT_EQ(runPkt(&procObj, "QTFrame:outside:0:5ff"), makePkt("F4T2"));
+    EXPECT_EQ(runPkt(&procObj, "QTFrame:outside:0:5ff"), makePkt("F-1"));
+}
+
+TEST(minigdbstub, test_tracepoint_breakpoint_no_table)
+{
+    unsigned int regs[2] = {0, 0};
+    mgdbTracepoint defs[2];
+    unsigned char frames[256];
+    mgdbTracepoints tp;
+    minigdbstubTracepointInit(&tp, defs, 2, frames, sizeof(frames));
+
+    testBreak breakObj  = {{0}};
+    mgdbProcObj procObj = {0};
+    procObj.usrData     = &breakObj;
+    procObj.regs        = (char *)regs;
+    procObj.regsSize    = sizeof(regs);
+    procObj.regsCount   = 2;
+    procObj.tracepoints = &tp;
+
+    EXPECT_EQ(runPkt(&procObj, "QTinit"), MGDB_OK_PACKET);
+    EXPECT_EQ(runPkt(&procObj, "QTDP:1:400:E:0:0"), MGDB_OK_PACKET);
+    EXPECT_EQ(runPkt(&procObj, "QTStart"), MGDB_OK_PACKET);
+    EXPECT_EQ(minigdbstubBreakpointHit(&procObj, 0x400), 0);  // Tracepoint only
+
+    // Z0 at a tracepoint address, no table - GDB's breakpoint still stops the target
+    EXPECT_EQ(runPkt(&procObj, "Z0,400,4"), MGDB_OK_PACKET);
+    EXPECT_EQ(breakObj.addr, 0x400U);
+    EXPECT_EQ(minigdbstubBreakpointHit(&procObj, 0x400), 1);
+    EXPECT_EQ(runPkt(&procObj, "z0,400,4"), MGDB_OK_PACKET);
+    EXPECT_EQ(minigdbstubBreakpointHit(&procObj, 0x400), 0);
+    EXPECT_EQ(runPkt(&procObj, "qTStatus").substr(0, 15), "$T1;tframes:3;t");
+}